@@ -0,0 +1,648 @@
+#include "backtest.h"
+#include "trade_execution.h"
+#include "websocket_handler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+constexpr int64_t kNsPerMs = 1000000;
+
+std::vector<std::string> split(const std::string& text, char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, delimiter)) parts.push_back(part);
+    return parts;
+}
+
+const char* directionName(OrderSide side) {
+    return side == OrderSide::Buy ? "buy" : "sell";
+}
+
+void appendLevels(std::vector<LevelUpdate>& out, BookSide side, const json& levels) {
+    for (const auto& level : levels) {
+        // ["new"|"change"|"delete", price, amount] or [price, amount]
+        if (level.size() >= 3 && level[0].is_string()) {
+            double size = level[0] == "delete" ? 0.0 : level[2].get<double>();
+            out.push_back(LevelUpdate{side, level[1].get<double>(), size});
+        } else if (level.size() >= 2) {
+            out.push_back(LevelUpdate{side, level[0].get<double>(), level[1].get<double>()});
+        }
+    }
+}
+
+// Exchange and client of one backtest run. Stands in for the wire under
+// TradeExecution: order entry arrives through the OrderTransport interface
+// and market data, fills and replies are delivered on a simulated clock.
+class Simulation : public OrderTransport {
+public:
+    Simulation(const MarketData& data, const BacktestConfig& config, BacktestStrategy& strategy)
+        : data_(data),
+          config_(config),
+          strategy_(strategy),
+          rng_(config.seed),
+          // Never connected; TradeExecution only needs it to exist
+          websocket_(std::make_shared<WebSocketHandler>(idle_ioc_, "backtest", "0", "/")),
+          trade_(*websocket_) {
+        trade_.setOrderTransport(this);
+    }
+
+    ~Simulation() override {
+        trade_.setOrderTransport(nullptr);
+    }
+
+    const char* name() const override { return "backtest"; }
+
+    json placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) override {
+        Event event{};
+        event.kind = Event::Kind::Place;
+        event.order = order;
+        return call(request_id, std::move(event), tracer);
+    }
+
+    json cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) override {
+        Event event{};
+        event.kind = Event::Kind::Cancel;
+        event.order_id = order_id;
+        return call(request_id, std::move(event), tracer);
+    }
+
+    json modifyOrder(int request_id, const std::string& order_id, double new_price, double new_amount,
+                     OrderTracer& tracer) override {
+        Event event{};
+        event.kind = Event::Kind::Modify;
+        event.order_id = order_id;
+        event.order.price = new_price;
+        event.order.amount = new_amount;
+        return call(request_id, std::move(event), tracer);
+    }
+
+    BacktestResult run() {
+        auto started = std::chrono::steady_clock::now();
+        while (true) {
+            if (!deferred_.empty()) {
+                Event event = std::move(deferred_.front());
+                deferred_.pop_front();
+                deliver(event);
+                continue;
+            }
+            if (!step()) break;
+        }
+
+        result_.simulated_ns = now_ - (data_.events().empty() ? 0 : data_.events().front().exchange_ns);
+        for (const auto& entry : positions_) {
+            const OrderBook* book = engine_.book(entry.first);
+            double mid = 0.0;
+            if (book && book->depth(BookSide::Bid) > 0 && book->depth(BookSide::Ask) > 0) {
+                mid = 0.5 * (book->bestPrice(BookSide::Bid) + book->bestPrice(BookSide::Ask));
+            }
+            result_.position += entry.second.position;
+            result_.pnl += entry.second.cash + entry.second.position * mid;
+        }
+        result_.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result_;
+    }
+
+private:
+    struct Event {
+        enum class Kind { Place, Cancel, Modify, DeliverMarket, DeliverFills, DeliverReply };
+
+        int64_t at = 0;
+        uint64_t sequence = 0;
+        Kind kind = Kind::DeliverReply;
+        int request_id = 0;
+        NewOrder order{};               // Place; price and amount for Modify
+        std::string order_id;           // Cancel and Modify
+        std::size_t market_index = 0;   // DeliverMarket
+        std::vector<SimFill> fills;     // DeliverFills
+        json reply;                     // DeliverReply
+    };
+
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.at != b.at ? a.at > b.at : a.sequence > b.sequence;
+        }
+    };
+
+    struct Position {
+        double position = 0.0;
+        double cash = 0.0;
+    };
+
+    // Each leg is FIFO: a message never arrives before the one sent ahead of it
+    int64_t arrival(int64_t& last, int64_t sent, const LatencyDistribution& latency) {
+        last = std::max(last, sent + latency.sampleNs(rng_));
+        return last;
+    }
+
+    void schedule(Event event) {
+        event.sequence = next_sequence_++;
+        queue_.push_back(std::move(event));
+        std::push_heap(queue_.begin(), queue_.end(), Later());
+    }
+
+    // Process the next event in time order; false when nothing is left.
+    // Market events win ties so the exchange sees data before orders sent
+    // at the same instant.
+    bool step() {
+        const auto& events = data_.events();
+        if (cursor_ < events.size() && (queue_.empty() || events[cursor_].exchange_ns <= queue_.front().at)) {
+            onMarketEvent(cursor_++);
+            return true;
+        }
+        if (queue_.empty()) return false;
+
+        std::pop_heap(queue_.begin(), queue_.end(), Later());
+        Event event = std::move(queue_.back());
+        queue_.pop_back();
+        now_ = std::max(now_, event.at);
+
+        switch (event.kind) {
+            case Event::Kind::Place:
+            case Event::Kind::Cancel:
+            case Event::Kind::Modify:
+                onOrderAtExchange(event);
+                break;
+            case Event::Kind::DeliverReply:
+                replies_[event.request_id] = std::move(event.reply);
+                break;
+            case Event::Kind::DeliverMarket:
+            case Event::Kind::DeliverFills:
+                // The strategy is blocked in an order call; it sees these after it returns
+                if (call_depth_ > 0) {
+                    deferred_.push_back(std::move(event));
+                } else {
+                    deliver(event);
+                }
+                break;
+        }
+        return true;
+    }
+
+    void onMarketEvent(std::size_t index) {
+        const MarketEvent& market = data_.events()[index];
+        now_ = std::max(now_, market.exchange_ns);
+        ++result_.market_events;
+
+        std::vector<SimFill> fills;
+        if (market.is_trade) {
+            engine_.applyTrades(market.instrument_name, market.trades, now_, fills);
+        } else {
+            engine_.applyBook(market.instrument_name, market.snapshot, market.levels, now_, fills);
+        }
+
+        Event delivery{};
+        delivery.kind = Event::Kind::DeliverMarket;
+        delivery.market_index = index;
+        delivery.at = arrival(last_inbound_, now_, config_.latency.market_data);
+        schedule(std::move(delivery));
+        scheduleFills(std::move(fills));
+    }
+
+    void onOrderAtExchange(Event& event) {
+        std::vector<SimFill> fills;
+        Event reply{};
+        reply.kind = Event::Kind::DeliverReply;
+        reply.request_id = event.request_id;
+        switch (event.kind) {
+            case Event::Kind::Place:
+                reply.reply = engine_.place(event.order, now_, fills);
+                break;
+            case Event::Kind::Cancel:
+                reply.reply = engine_.cancel(event.order_id);
+                break;
+            default:
+                reply.reply = engine_.modify(event.order_id, event.order.price, event.order.amount, now_, fills);
+                break;
+        }
+        reply.reply["jsonrpc"] = "2.0";
+        reply.reply["id"] = event.request_id;
+        reply.at = arrival(last_inbound_, now_, config_.latency.wire_in);
+        schedule(std::move(reply));
+        scheduleFills(std::move(fills));
+    }
+
+    void scheduleFills(std::vector<SimFill> fills) {
+        if (fills.empty()) return;
+        Event delivery{};
+        delivery.kind = Event::Kind::DeliverFills;
+        delivery.fills = std::move(fills);
+        delivery.at = arrival(last_inbound_, now_, config_.latency.wire_in);
+        schedule(std::move(delivery));
+    }
+
+    // Client side: hand the message to TradeExecution, then to the strategy
+    void deliver(const Event& event) {
+        if (event.kind == Event::Kind::DeliverMarket) {
+            const MarketEvent& market = data_.events()[event.market_index];
+            trade_.handleSubscriptionMessage(market.notification);
+            if (!market.is_trade) strategy_.onBookUpdate(trade_, market.instrument_name, now_);
+            return;
+        }
+
+        json data = json::array();
+        for (const auto& fill : event.fills) {
+            data.push_back({
+                {"trade_id", "SIM-T" + std::to_string(fill.trade_id)},
+                {"order_id", fill.order_id},
+                {"instrument_name", fill.instrument_name},
+                {"direction", directionName(fill.side)},
+                {"price", fill.price},
+                {"amount", fill.amount},
+                {"liquidity", fill.maker ? "M" : "T"},
+                {"timestamp", fill.exchange_ns / kNsPerMs}
+            });
+        }
+        json notification = {
+            {"jsonrpc", "2.0"},
+            {"method", "subscription"},
+            {"params", {{"channel", "user.trades.any.any.raw"}, {"data", std::move(data)}}}
+        };
+        trade_.handleSubscriptionMessage(notification);
+
+        for (const auto& fill : event.fills) {
+            Position& position = positions_[fill.instrument_name];
+            double signed_amount = fill.side == OrderSide::Buy ? fill.amount : -fill.amount;
+            position.position += signed_amount;
+            position.cash -= signed_amount * fill.price;
+            ++result_.fills;
+            result_.filled_amount += fill.amount;
+            strategy_.onFill(trade_, fill, now_);
+        }
+    }
+
+    // Blocking order entry: run the simulation until the reply comes back
+    json call(int request_id, Event event, OrderTracer& tracer) {
+        tracer.stamp(request_id, OrderStage::Encoded);
+        ++result_.orders;
+        event.request_id = request_id;
+        int64_t received = arrival(last_outbound_, now_, config_.latency.wire_out);
+        event.at = arrival(last_exchange_, received, config_.latency.exchange);
+        schedule(std::move(event));
+        tracer.stamp(request_id, OrderStage::Written);
+
+        ++call_depth_;
+        while (replies_.find(request_id) == replies_.end() && step()) {}
+        --call_depth_;
+
+        auto it = replies_.find(request_id);
+        if (it == replies_.end()) {
+            throw std::runtime_error("Backtest ended before request " + std::to_string(request_id) + " was answered");
+        }
+        json reply = std::move(it->second);
+        replies_.erase(it);
+        tracer.stamp(request_id, OrderStage::AckReceived);
+        return reply;
+    }
+
+    const MarketData& data_;
+    const BacktestConfig& config_;
+    BacktestStrategy& strategy_;
+    std::mt19937_64 rng_;
+    MatchingEngine engine_;
+
+    boost::asio::io_context idle_ioc_;
+    std::shared_ptr<WebSocketHandler> websocket_;
+    TradeExecution trade_;
+
+    int64_t now_ = 0;
+    std::size_t cursor_ = 0;
+    std::vector<Event> queue_;          // min-heap on (at, sequence)
+    uint64_t next_sequence_ = 0;
+    std::deque<Event> deferred_;
+    int call_depth_ = 0;
+    std::unordered_map<int, json> replies_;
+    int64_t last_outbound_ = 0;
+    int64_t last_exchange_ = 0;
+    int64_t last_inbound_ = 0;
+
+    std::map<std::string, Position> positions_;
+    BacktestResult result_;
+};
+
+} // namespace
+
+int64_t LatencyDistribution::sampleNs(std::mt19937_64& rng) const {
+    double us = a_us;
+    switch (kind) {
+        case Kind::Constant:
+            break;
+        case Kind::Uniform:
+            us = std::uniform_real_distribution<double>(a_us, b_us)(rng);
+            break;
+        case Kind::Normal:
+            us = std::normal_distribution<double>(a_us, b_us)(rng);
+            break;
+        case Kind::LogNormal:
+            us = a_us * std::exp(b_us * std::normal_distribution<double>(0.0, 1.0)(rng));
+            break;
+    }
+    return static_cast<int64_t>(std::max(us, 0.0) * 1000.0);
+}
+
+std::string LatencyDistribution::describe() const {
+    std::ostringstream out;
+    switch (kind) {
+        case Kind::Constant: out << "const:" << a_us; break;
+        case Kind::Uniform: out << "uniform:" << a_us << ":" << b_us; break;
+        case Kind::Normal: out << "normal:" << a_us << ":" << b_us; break;
+        case Kind::LogNormal: out << "lognormal:" << a_us << ":" << b_us; break;
+    }
+    return out.str();
+}
+
+LatencyDistribution LatencyDistribution::parse(const std::string& spec) {
+    std::vector<std::string> parts = split(spec, ':');
+    LatencyDistribution latency;
+    try {
+        if (parts.size() == 1) {
+            latency.a_us = std::stod(parts[0]);
+        } else if (parts.size() == 2 && (parts[0] == "const" || parts[0] == "constant")) {
+            latency.a_us = std::stod(parts[1]);
+        } else if (parts.size() == 3) {
+            if (parts[0] == "uniform") {
+                latency.kind = Kind::Uniform;
+            } else if (parts[0] == "normal") {
+                latency.kind = Kind::Normal;
+            } else if (parts[0] == "lognormal") {
+                latency.kind = Kind::LogNormal;
+            } else {
+                throw std::invalid_argument(parts[0]);
+            }
+            latency.a_us = std::stod(parts[1]);
+            latency.b_us = std::stod(parts[2]);
+        } else {
+            throw std::invalid_argument(spec);
+        }
+    }
+    catch (const std::logic_error&) {
+        throw std::invalid_argument("Bad latency spec: " + spec);
+    }
+    if (latency.a_us < 0.0 || latency.b_us < 0.0
+        || (latency.kind == Kind::Uniform && latency.b_us < latency.a_us)) {
+        throw std::invalid_argument("Bad latency spec: " + spec);
+    }
+    return latency;
+}
+
+void LatencyModel::set(const std::string& assignment) {
+    auto equals = assignment.find('=');
+    if (equals == std::string::npos) {
+        throw std::invalid_argument("Expected LEG=SPEC, got " + assignment);
+    }
+    std::string leg = assignment.substr(0, equals);
+    LatencyDistribution latency = LatencyDistribution::parse(assignment.substr(equals + 1));
+    if (leg == "md") {
+        market_data = latency;
+    } else if (leg == "out") {
+        wire_out = latency;
+    } else if (leg == "exchange") {
+        exchange = latency;
+    } else if (leg == "in") {
+        wire_in = latency;
+    } else if (leg == "wire") {
+        wire_out = latency;
+        wire_in = latency;
+    } else {
+        throw std::invalid_argument("Unknown latency leg: " + leg);
+    }
+}
+
+std::string LatencyModel::describe() const {
+    return "md=" + market_data.describe() + " out=" + wire_out.describe()
+        + " exchange=" + exchange.describe() + " in=" + wire_in.describe();
+}
+
+bool MarketData::add(const json& notification) {
+    if (!notification.contains("params")) return false;
+    const json& params = notification["params"];
+    if (!params.contains("channel") || !params.contains("data")) return false;
+    const std::string& channel = params["channel"].get_ref<const std::string&>();
+    const json& data = params["data"];
+
+    MarketEvent event{};
+    if (channel.rfind("book.", 0) == 0) {
+        if (!data.contains("instrument_name")) return false;
+        event.instrument_name = data["instrument_name"].get<std::string>();
+        event.snapshot = !data.contains("prev_change_id") || (data.contains("type") && data["type"] == "snapshot");
+        event.exchange_ns = data.value("timestamp", int64_t{0}) * kNsPerMs;
+        if (data.contains("bids")) appendLevels(event.levels, BookSide::Bid, data["bids"]);
+        if (data.contains("asks")) appendLevels(event.levels, BookSide::Ask, data["asks"]);
+    } else if (channel.rfind("trades.", 0) == 0) {
+        if (!data.is_array() || data.empty()) return false;
+        event.is_trade = true;
+        event.instrument_name = data[0]["instrument_name"].get<std::string>();
+        event.exchange_ns = data[0].value("timestamp", int64_t{0}) * kNsPerMs;
+        for (const auto& trade : data) {
+            event.trades.push_back(TradePrint{trade["price"].get<double>(), trade["amount"].get<double>(),
+                                              trade.value("direction", std::string()) == "buy" ? OrderSide::Buy
+                                                                                               : OrderSide::Sell});
+        }
+    } else {
+        return false;
+    }
+    event.notification = notification;
+    events_.push_back(std::move(event));
+    return true;
+}
+
+MarketData MarketData::loadRecording(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open recording " + path);
+    }
+    MarketData data;
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty()) continue;
+        try {
+            data.add(json::parse(line));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Skipping line " << line_number << " of " << path << ": " << e.what() << std::endl;
+        }
+    }
+    // Timestamps are milliseconds; a stable sort keeps the recorded order within one
+    std::stable_sort(data.events_.begin(), data.events_.end(),
+                     [](const MarketEvent& a, const MarketEvent& b) { return a.exchange_ns < b.exchange_ns; });
+    return data;
+}
+
+MarketData MarketData::synthetic(const SyntheticMarketConfig& config) {
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> lots(1, 50);
+    std::exponential_distribution<double> gap(1.0 / std::max<int64_t>(config.mean_step_ns, 1));
+    auto randomSize = [&]() { return 10.0 * lots(rng); };
+
+    const std::string& name = config.instrument_name;
+    const std::size_t depth = std::max<std::size_t>(config.depth, 1);
+    int64_t best_bid = std::llround(config.start_price / config.tick);
+    auto price = [&](int64_t ticks) { return ticks * config.tick; };
+
+    // Sizes outward from the touch: bids at best_bid - i, asks at best_bid + 1 + i
+    std::deque<double> bids, asks;
+    for (std::size_t i = 0; i < depth; ++i) {
+        bids.push_back(randomSize());
+        asks.push_back(randomSize());
+    }
+
+    MarketData data;
+    int64_t now_ns = int64_t{1700000000000} * kNsPerMs;
+    int64_t change_id = 1;
+    uint64_t trade_seq = 1;
+
+    auto emitBook = [&](const char* type, json bid_levels, json ask_levels) {
+        json book = {
+            {"type", type},
+            {"timestamp", now_ns / kNsPerMs},
+            {"instrument_name", name},
+            {"change_id", change_id},
+            {"bids", std::move(bid_levels)},
+            {"asks", std::move(ask_levels)}
+        };
+        if (change_id > 1) book["prev_change_id"] = change_id - 1;
+        ++change_id;
+        data.add({
+            {"jsonrpc", "2.0"},
+            {"method", "subscription"},
+            {"params", {{"channel", "book." + name + ".raw"}, {"data", std::move(book)}}}
+        });
+    };
+
+    json bid_levels = json::array();
+    json ask_levels = json::array();
+    for (std::size_t i = 0; i < depth; ++i) {
+        bid_levels.push_back({"new", price(best_bid - static_cast<int64_t>(i)), bids[i]});
+        ask_levels.push_back({"new", price(best_bid + 1 + static_cast<int64_t>(i)), asks[i]});
+    }
+    emitBook("snapshot", std::move(bid_levels), std::move(ask_levels));
+
+    for (std::size_t step = 0; step < config.steps; ++step) {
+        now_ns += static_cast<int64_t>(gap(rng)) + 1;
+        bid_levels = json::array();
+        ask_levels = json::array();
+
+        if (unit(rng) < config.trade_probability) {
+            bool buy = unit(rng) < 0.5;
+            std::deque<double>& touch = buy ? asks : bids;
+            json& touch_levels = buy ? ask_levels : bid_levels;
+            int64_t touch_tick = buy ? best_bid + 1 : best_bid;
+            double traded = std::min(10.0 * lots(rng), touch.front());
+
+            data.add({
+                {"jsonrpc", "2.0"},
+                {"method", "subscription"},
+                {"params", {{"channel", "trades." + name + ".raw"}, {"data", json::array({{
+                    {"trade_seq", trade_seq},
+                    {"trade_id", std::to_string(trade_seq)},
+                    {"timestamp", now_ns / kNsPerMs},
+                    {"price", price(touch_tick)},
+                    {"amount", traded},
+                    {"direction", buy ? "buy" : "sell"},
+                    {"instrument_name", name}
+                }})}}}
+            });
+            ++trade_seq;
+
+            if (traded < touch.front()) {
+                touch.front() -= traded;
+                touch_levels.push_back({"change", price(touch_tick), touch.front()});
+            } else if (buy) {
+                // Offer cleared: the price ticks up and a new bid joins at the old offer
+                ask_levels.push_back({"delete", price(touch_tick), 0.0});
+                asks.pop_front();
+                bid_levels.push_back({"delete", price(best_bid - static_cast<int64_t>(depth) + 1), 0.0});
+                bids.pop_back();
+                ++best_bid;
+                bids.push_front(randomSize());
+                bid_levels.push_back({"new", price(best_bid), bids.front()});
+                asks.push_back(randomSize());
+                ask_levels.push_back({"new", price(best_bid + static_cast<int64_t>(depth)), asks.back()});
+            } else {
+                bid_levels.push_back({"delete", price(touch_tick), 0.0});
+                bids.pop_front();
+                ask_levels.push_back({"delete", price(best_bid + static_cast<int64_t>(depth)), 0.0});
+                asks.pop_back();
+                --best_bid;
+                asks.push_front(randomSize());
+                ask_levels.push_back({"new", price(best_bid + 1), asks.front()});
+                bids.push_back(randomSize());
+                bid_levels.push_back({"new", price(best_bid - static_cast<int64_t>(depth) + 1), bids.back()});
+            }
+        } else {
+            // Resting size churns, more often near the touch
+            bool bid = unit(rng) < 0.5;
+            std::size_t level = static_cast<std::size_t>(depth * unit(rng) * unit(rng));
+            std::deque<double>& sizes = bid ? bids : asks;
+            sizes[level] = randomSize();
+            int64_t tick = bid ? best_bid - static_cast<int64_t>(level) : best_bid + 1 + static_cast<int64_t>(level);
+            (bid ? bid_levels : ask_levels).push_back({"change", price(tick), sizes[level]});
+        }
+        emitBook("change", std::move(bid_levels), std::move(ask_levels));
+    }
+    return data;
+}
+
+BacktestResult runBacktest(const MarketData& data, const BacktestConfig& config, BacktestStrategy& strategy) {
+    Simulation simulation(data, config, strategy);
+    return simulation.run();
+}
+
+void QuoteStrategy::onBookUpdate(TradeExecution& trade, const std::string& instrument_name, int64_t) {
+    if (!quotes_) {
+        QuoteManagerConfig config;
+        // A partly filled quote keeps its place until the touch moves away
+        config.size_tolerance = params_.size;
+        quotes_.reset(new QuoteManager(trade, config));
+        quotes_->setFillHandler([this](const std::string&, OrderSide side, double amount) {
+            position_ += side == OrderSide::Buy ? amount : -amount;
+        });
+    }
+
+    const OrderBook* book = trade.orderBooks().book(instrument_name);
+    if (!book || !trade.orderBooks().inSync(instrument_name)
+        || book->depth(BookSide::Bid) == 0 || book->depth(BookSide::Ask) == 0) {
+        return;
+    }
+    std::vector<ManagedOrder> live = quotes_->orders(instrument_name);
+    QuoteLadder ladder;
+    if (std::abs(position_ + params_.size) <= params_.max_position + 1e-9) {
+        ladder.bids.push_back(QuoteLevel{quotePrice(OrderSide::Buy, book->bestPrice(BookSide::Bid), live), params_.size});
+    }
+    if (std::abs(position_ - params_.size) <= params_.max_position + 1e-9) {
+        ladder.asks.push_back(QuoteLevel{quotePrice(OrderSide::Sell, book->bestPrice(BookSide::Ask), live), params_.size});
+    }
+    quotes_->setQuotes(instrument_name, std::move(ladder));
+}
+
+// Stay where the live quote is until the touch is requote_ticks away
+double QuoteStrategy::quotePrice(OrderSide side, double touch, const std::vector<ManagedOrder>& orders) const {
+    for (const auto& order : orders) {
+        if (order.side == side && std::abs(touch - order.price) < params_.requote_ticks * params_.tick - 1e-9) {
+            return order.price;
+        }
+    }
+    return touch;
+}
+
+void QuoteStrategy::onFill(TradeExecution&, const SimFill& fill, int64_t) {
+    if (!quotes_) return;
+    quotes_->onFill(fill.order_id, "SIM-T" + std::to_string(fill.trade_id), fill.side, fill.amount);
+}
+
+QuoteManagerStats QuoteStrategy::quoteStats() const {
+    return quotes_ ? quotes_->stats() : QuoteManagerStats{};
+}
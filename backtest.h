@@ -0,0 +1,151 @@
+#ifndef BACKTEST_H
+#define BACKTEST_H
+
+#include "matching_engine.h"
+#include "quote_manager.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+class TradeExecution;
+
+using json = nlohmann::json;
+
+// One leg of the latency model, in microseconds. Parsed from
+// "const:US", "uniform:MIN:MAX", "normal:MEAN:STDDEV" or
+// "lognormal:MEDIAN:SIGMA"; a bare number means const.
+struct LatencyDistribution {
+    enum class Kind { Constant, Uniform, Normal, LogNormal };
+
+    Kind kind = Kind::Constant;
+    double a_us = 0.0;      // value, minimum, mean or median
+    double b_us = 0.0;      // maximum, standard deviation or log sigma
+
+    int64_t sampleNs(std::mt19937_64& rng) const;
+    std::string describe() const;
+    // Throws std::invalid_argument on a malformed spec
+    static LatencyDistribution parse(const std::string& spec);
+};
+
+// Where simulated time goes: exchange to client for market data, client to
+// exchange for orders, matching inside the exchange, and exchange to client
+// for replies and fills. Each leg is FIFO, so a sample never overtakes the
+// message sent before it.
+struct LatencyModel {
+    LatencyDistribution market_data{LatencyDistribution::Kind::LogNormal, 400.0, 0.3};
+    LatencyDistribution wire_out{LatencyDistribution::Kind::LogNormal, 300.0, 0.3};
+    LatencyDistribution exchange{LatencyDistribution::Kind::Uniform, 50.0, 150.0};
+    LatencyDistribution wire_in{LatencyDistribution::Kind::LogNormal, 300.0, 0.3};
+
+    // "LEG=SPEC" with LEG one of md, out, exchange, in, or wire for out and in
+    void set(const std::string& assignment);
+    std::string describe() const;
+};
+
+// A book.* or trades.* notification as the exchange published it
+struct MarketEvent {
+    int64_t exchange_ns;
+    std::string instrument_name;
+    bool is_trade;
+    bool snapshot;
+    std::vector<LevelUpdate> levels;
+    std::vector<TradePrint> trades;
+    json notification;      // handed to TradeExecution on delivery
+};
+
+struct SyntheticMarketConfig {
+    std::string instrument_name = "SYNTH-PERPETUAL";
+    uint64_t seed = 1;
+    std::size_t steps = 100000;
+    double start_price = 60000.0;
+    double tick = 0.5;
+    std::size_t depth = 20;
+    int64_t mean_step_ns = 5000000;     // exponential gaps between events
+    double trade_probability = 0.3;
+};
+
+// Time-ordered market events for a backtest, either replayed from a recording
+// or generated. Immutable once built, so parallel runs can share one.
+class MarketData {
+public:
+    // JSON lines of subscription notifications as received from Deribit;
+    // lines that are not book.* or trades.* notifications are skipped
+    static MarketData loadRecording(const std::string& path);
+    // Random walk with a one tick spread: trades eat into the touch and move
+    // the price when they clear it, and resting size churns in between
+    static MarketData synthetic(const SyntheticMarketConfig& config);
+
+    // False if the notification is not book.* or trades.*
+    bool add(const json& notification);
+    const std::vector<MarketEvent>& events() const { return events_; }
+
+private:
+    std::vector<MarketEvent> events_;
+};
+
+// Strategy under test. Called on the simulation's only thread with the
+// TradeExecution it should trade through; blocking order calls return once
+// the simulated reply arrives, and anything delivered meanwhile is held back
+// until the callback returns.
+class BacktestStrategy {
+public:
+    virtual ~BacktestStrategy() = default;
+
+    virtual void onBookUpdate(TradeExecution& trade, const std::string& instrument_name, int64_t now_ns) = 0;
+    virtual void onFill(TradeExecution&, const SimFill&, int64_t) {}
+};
+
+struct BacktestConfig {
+    LatencyModel latency;
+    uint64_t seed = 1;
+};
+
+struct BacktestResult {
+    uint64_t market_events = 0;
+    uint64_t orders = 0;            // place, cancel and modify requests
+    uint64_t fills = 0;
+    double filled_amount = 0.0;
+    double position = 0.0;
+    double pnl = 0.0;               // linear: cash plus position marked to the final mid, no fees
+    int64_t simulated_ns = 0;
+    double wall_seconds = 0.0;
+};
+
+// Replay data through a MatchingEngine and a fresh TradeExecution whose order
+// entry is simulated. Single threaded, and the same data, config and strategy
+// always give the same result.
+BacktestResult runBacktest(const MarketData& data, const BacktestConfig& config, BacktestStrategy& strategy);
+
+// Example market maker: joins the best bid and offer with a fixed size and
+// moves a quote once the touch is requote_ticks away from it. Stops quoting
+// the side that would take the position past max_position. Quotes go through
+// a QuoteManager bound to the first run's TradeExecution, so use one instance
+// per run.
+class QuoteStrategy : public BacktestStrategy {
+public:
+    struct Params {
+        double size = 10.0;
+        double tick = 0.5;
+        int requote_ticks = 1;
+        double max_position = 100.0;
+    };
+
+    explicit QuoteStrategy(Params params) : params_(params) {}
+
+    void onBookUpdate(TradeExecution& trade, const std::string& instrument_name, int64_t now_ns) override;
+    void onFill(TradeExecution& trade, const SimFill& fill, int64_t now_ns) override;
+
+    QuoteManagerStats quoteStats() const;
+
+private:
+    double quotePrice(OrderSide side, double touch, const std::vector<ManagedOrder>& orders) const;
+
+    Params params_;
+    std::unique_ptr<QuoteManager> quotes_;
+    double position_ = 0.0;     // from fills in replies as soon as they arrive, then notifications
+};
+
+#endif // BACKTEST_H
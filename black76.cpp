@@ -0,0 +1,327 @@
+#include "black76.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if SIMD_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace black76 {
+
+namespace {
+
+constexpr int kMaxIterations = 32;
+constexpr double kMinVol = 1e-4;
+constexpr double kMaxVol = 5.0;
+constexpr double kDefaultVol = 0.5;
+constexpr double kRelativeTolerance = 1e-12;   // price tolerance as a fraction of forward
+constexpr double kInvSqrt2Pi = 0.3989422804014327;
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Hart's double precision approximation (as given by West, 2005). Takes
+// e = exp(-x^2 / 2) so callers that also need the density share the exp.
+double cdfFromExp(double x, double e) {
+    double ax = std::fabs(x);
+    double c;
+    if (ax < 7.07106781186547) {
+        double num = 3.52624965998911e-02 * ax + 0.700383064443688;
+        num = num * ax + 6.37396220353165;
+        num = num * ax + 33.912866078383;
+        num = num * ax + 112.079291497871;
+        num = num * ax + 221.213596169931;
+        num = num * ax + 220.206867912376;
+        double den = 8.83883476483184e-02 * ax + 1.75566716318264;
+        den = den * ax + 16.064177579207;
+        den = den * ax + 86.7807322029461;
+        den = den * ax + 296.564248779674;
+        den = den * ax + 637.333633378831;
+        den = den * ax + 793.826512519948;
+        den = den * ax + 440.413735824752;
+        c = e * num / den;
+    } else {
+        double cf = ax + 0.65;
+        cf = ax + 4.0 / cf;
+        cf = ax + 3.0 / cf;
+        cf = ax + 2.0 / cf;
+        cf = ax + 1.0 / cf;
+        c = e / cf / 2.506628274631;
+    }
+    return x > 0.0 ? 1.0 - c : c;
+}
+
+bool outsideBounds(double forward, double strike, double expiry_years, double call_sign, double target) {
+    if (!(expiry_years > 0.0) || !(forward > 0.0) || !(strike > 0.0)) return true;
+    double intrinsic = std::max(call_sign * (forward - strike), 0.0);
+    double upper = call_sign > 0.0 ? forward : strike;
+    return !(target > intrinsic) || !(target < upper);
+}
+
+double impliedVolScalar(double forward, double strike, double expiry_years, double call_sign,
+                        double target, double seed) {
+    if (outsideBounds(forward, strike, expiry_years, call_sign, target)) return kNaN;
+
+    const double sqrt_t = std::sqrt(expiry_years);
+    const double log_fk = std::log(forward / strike);
+    const double tolerance = kRelativeTolerance * forward;
+    double lo = kMinVol;
+    double hi = kMaxVol;
+    double sigma = seed > 0.0 ? std::min(std::max(seed, lo), hi) : kDefaultVol;
+
+    // Newton steps, falling back to bisection whenever a step leaves the
+    // bracket, so deep OTM strikes with tiny vega still converge.
+    for (int i = 0; i < kMaxIterations; ++i) {
+        double vt = sigma * sqrt_t;
+        double d1 = log_fk / vt + 0.5 * vt;
+        double d2 = d1 - vt;
+        double e1 = std::exp(-0.5 * d1 * d1);
+        double e2 = std::exp(-0.5 * d2 * d2);
+        double model = call_sign * (forward * cdfFromExp(call_sign * d1, e1)
+                                    - strike * cdfFromExp(call_sign * d2, e2));
+        double vega = forward * e1 * kInvSqrt2Pi * sqrt_t;
+        double diff = model - target;
+        if (std::fabs(diff) <= tolerance) break;
+
+        if (diff > 0.0) hi = sigma; else lo = sigma;
+        double step = sigma - diff / vega;
+        sigma = (vega > 0.0 && step > lo && step < hi) ? step : 0.5 * (lo + hi);
+    }
+    return sigma;
+}
+
+void greeksScalar(double forward, double strike, double expiry_years, double call_sign, double sigma,
+                  double& delta, double& gamma, double& vega) {
+    double sqrt_t = std::sqrt(expiry_years);
+    double vt = sigma * sqrt_t;
+    double d1 = std::log(forward / strike) / vt + 0.5 * vt;
+    double e1 = std::exp(-0.5 * d1 * d1);
+    double pdf = e1 * kInvSqrt2Pi;
+    delta = call_sign * cdfFromExp(call_sign * d1, e1);
+    gamma = pdf / (forward * vt);
+    vega = forward * pdf * sqrt_t / 100.0;
+}
+
+#if SIMD_HAVE_AVX2
+
+SIMD_TARGET_AVX2 inline __m256d set(double v) { return _mm256_set1_pd(v); }
+
+SIMD_TARGET_AVX2 inline __m256d absPd(__m256d x) {
+    return _mm256_andnot_pd(set(-0.0), x);
+}
+
+// exp(x) = 2^n * exp(r) with |r| <= ln2/2, Taylor series to r^13
+SIMD_TARGET_AVX2 __m256d exp4(__m256d x) {
+    x = _mm256_max_pd(_mm256_min_pd(x, set(708.0)), set(-708.0));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, set(1.4426950408889634)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, set(6.93147180369123816490e-01)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, set(1.90821492927058770002e-10)));
+
+    __m256d p = set(1.0 / 6227020800.0);
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 479001600.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 39916800.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 3628800.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 362880.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 40320.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 5040.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 720.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 120.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 24.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0 / 6.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(0.5));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0));
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), set(1.0));
+
+    // 2^n: adding 1.5 * 2^52 leaves n in the low mantissa bits
+    const __m256d magic = set(6755399441055744.0);
+    __m256i ni = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)),
+                                  _mm256_castpd_si256(magic));
+    __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(ni, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+}
+
+// log(x) for positive normal x: split exponent and mantissa, then the atanh
+// series log(m) = 2s(1 + s^2/3 + s^4/5 + ...) with s = (m - 1) / (m + 1)
+SIMD_TARGET_AVX2 __m256d log4(__m256d x) {
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256i exponent = _mm256_srli_epi64(bits, 52);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+        _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    const __m256d two52 = set(4503599627370496.0);
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(exponent, _mm256_castpd_si256(two52))), two52);
+    e = _mm256_sub_pd(e, set(1023.0));
+
+    __m256d big = _mm256_cmp_pd(m, set(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, set(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, set(1.0)));
+
+    __m256d s = _mm256_div_pd(_mm256_sub_pd(m, set(1.0)), _mm256_add_pd(m, set(1.0)));
+    __m256d s2 = _mm256_mul_pd(s, s);
+    __m256d p = set(1.0 / 23.0);
+    for (double k : {21.0, 19.0, 17.0, 15.0, 13.0, 11.0, 9.0, 7.0, 5.0, 3.0, 1.0}) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, s2), set(1.0 / k));
+    }
+    __m256d log_m = _mm256_mul_pd(_mm256_mul_pd(set(2.0), s), p);
+    return _mm256_add_pd(_mm256_mul_pd(e, set(0.6931471805599453)), log_m);
+}
+
+SIMD_TARGET_AVX2 __m256d cdfFromExp4(__m256d x, __m256d e) {
+    __m256d ax = absPd(x);
+
+    __m256d num = _mm256_add_pd(_mm256_mul_pd(set(3.52624965998911e-02), ax), set(0.700383064443688));
+    num = _mm256_add_pd(_mm256_mul_pd(num, ax), set(6.37396220353165));
+    num = _mm256_add_pd(_mm256_mul_pd(num, ax), set(33.912866078383));
+    num = _mm256_add_pd(_mm256_mul_pd(num, ax), set(112.079291497871));
+    num = _mm256_add_pd(_mm256_mul_pd(num, ax), set(221.213596169931));
+    num = _mm256_add_pd(_mm256_mul_pd(num, ax), set(220.206867912376));
+    __m256d den = _mm256_add_pd(_mm256_mul_pd(set(8.83883476483184e-02), ax), set(1.75566716318264));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(16.064177579207));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(86.7807322029461));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(296.564248779674));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(637.333633378831));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(793.826512519948));
+    den = _mm256_add_pd(_mm256_mul_pd(den, ax), set(440.413735824752));
+    __m256d near = _mm256_div_pd(_mm256_mul_pd(e, num), den);
+
+    __m256d cf = _mm256_add_pd(ax, set(0.65));
+    cf = _mm256_add_pd(ax, _mm256_div_pd(set(4.0), cf));
+    cf = _mm256_add_pd(ax, _mm256_div_pd(set(3.0), cf));
+    cf = _mm256_add_pd(ax, _mm256_div_pd(set(2.0), cf));
+    cf = _mm256_add_pd(ax, _mm256_div_pd(set(1.0), cf));
+    __m256d tail = _mm256_div_pd(_mm256_div_pd(e, cf), set(2.506628274631));
+
+    __m256d c = _mm256_blendv_pd(near, tail, _mm256_cmp_pd(ax, set(7.07106781186547), _CMP_GE_OQ));
+    return _mm256_blendv_pd(c, _mm256_sub_pd(set(1.0), c), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ));
+}
+
+SIMD_TARGET_AVX2 void impliedVolAvx2(const double* forward, const double* strike, const double* expiry_years,
+                                     const double* call_sign, const double* price, double* iv, std::size_t n) {
+    for (std::size_t i = 0; i + 4 <= n; i += 4) {
+        __m256d f = _mm256_loadu_pd(forward + i);
+        __m256d k = _mm256_loadu_pd(strike + i);
+        __m256d t = _mm256_loadu_pd(expiry_years + i);
+        __m256d s = _mm256_loadu_pd(call_sign + i);
+        __m256d target = _mm256_loadu_pd(price + i);
+        __m256d seed = _mm256_loadu_pd(iv + i);
+
+        // Lanes outside the arbitrage bounds are done from the start and end up NaN
+        alignas(32) double valid_lanes[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            std::size_t j = i + lane;
+            valid_lanes[lane] = outsideBounds(forward[j], strike[j], expiry_years[j], call_sign[j], price[j])
+                ? 0.0 : 1.0;
+        }
+        __m256d valid = _mm256_cmp_pd(_mm256_load_pd(valid_lanes), set(0.5), _CMP_GT_OQ);
+        __m256d done = _mm256_xor_pd(valid, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)));
+
+        __m256d sqrt_t = _mm256_sqrt_pd(t);
+        __m256d log_fk = log4(_mm256_div_pd(f, k));
+        __m256d tolerance = _mm256_mul_pd(f, set(kRelativeTolerance));
+        __m256d lo = set(kMinVol);
+        __m256d hi = set(kMaxVol);
+        __m256d sigma = _mm256_blendv_pd(set(kDefaultVol), _mm256_min_pd(_mm256_max_pd(seed, lo), hi),
+                                         _mm256_cmp_pd(seed, _mm256_setzero_pd(), _CMP_GT_OQ));
+
+        for (int it = 0; it < kMaxIterations && _mm256_movemask_pd(done) != 0xF; ++it) {
+            __m256d vt = _mm256_mul_pd(sigma, sqrt_t);
+            __m256d d1 = _mm256_add_pd(_mm256_div_pd(log_fk, vt), _mm256_mul_pd(set(0.5), vt));
+            __m256d d2 = _mm256_sub_pd(d1, vt);
+            __m256d e1 = exp4(_mm256_mul_pd(set(-0.5), _mm256_mul_pd(d1, d1)));
+            __m256d e2 = exp4(_mm256_mul_pd(set(-0.5), _mm256_mul_pd(d2, d2)));
+            __m256d model = _mm256_mul_pd(s, _mm256_sub_pd(
+                _mm256_mul_pd(f, cdfFromExp4(_mm256_mul_pd(s, d1), e1)),
+                _mm256_mul_pd(k, cdfFromExp4(_mm256_mul_pd(s, d2), e2))));
+            __m256d vega = _mm256_mul_pd(_mm256_mul_pd(f, e1), _mm256_mul_pd(set(kInvSqrt2Pi), sqrt_t));
+            __m256d diff = _mm256_sub_pd(model, target);
+
+            done = _mm256_or_pd(done, _mm256_cmp_pd(absPd(diff), tolerance, _CMP_LE_OQ));
+
+            __m256d too_high = _mm256_cmp_pd(diff, _mm256_setzero_pd(), _CMP_GT_OQ);
+            __m256d new_hi = _mm256_blendv_pd(hi, sigma, too_high);
+            __m256d new_lo = _mm256_blendv_pd(sigma, lo, too_high);
+            __m256d step = _mm256_sub_pd(sigma, _mm256_div_pd(diff, vega));
+            __m256d use_newton = _mm256_and_pd(
+                _mm256_cmp_pd(vega, _mm256_setzero_pd(), _CMP_GT_OQ),
+                _mm256_and_pd(_mm256_cmp_pd(step, new_lo, _CMP_GT_OQ), _mm256_cmp_pd(step, new_hi, _CMP_LT_OQ)));
+            __m256d next = _mm256_blendv_pd(
+                _mm256_mul_pd(set(0.5), _mm256_add_pd(new_lo, new_hi)), step, use_newton);
+
+            sigma = _mm256_blendv_pd(next, sigma, done);
+            lo = _mm256_blendv_pd(new_lo, lo, done);
+            hi = _mm256_blendv_pd(new_hi, hi, done);
+        }
+        _mm256_storeu_pd(iv + i, _mm256_blendv_pd(set(kNaN), sigma, valid));
+    }
+}
+
+SIMD_TARGET_AVX2 void greeksAvx2(const double* forward, const double* strike, const double* expiry_years,
+                                 const double* call_sign, const double* iv,
+                                 double* delta, double* gamma, double* vega, std::size_t n) {
+    for (std::size_t i = 0; i + 4 <= n; i += 4) {
+        __m256d f = _mm256_loadu_pd(forward + i);
+        __m256d s = _mm256_loadu_pd(call_sign + i);
+        __m256d sqrt_t = _mm256_sqrt_pd(_mm256_loadu_pd(expiry_years + i));
+        __m256d vt = _mm256_mul_pd(_mm256_loadu_pd(iv + i), sqrt_t);
+        __m256d d1 = _mm256_add_pd(
+            _mm256_div_pd(log4(_mm256_div_pd(f, _mm256_loadu_pd(strike + i))), vt),
+            _mm256_mul_pd(set(0.5), vt));
+        __m256d e1 = exp4(_mm256_mul_pd(set(-0.5), _mm256_mul_pd(d1, d1)));
+        __m256d pdf = _mm256_mul_pd(e1, set(kInvSqrt2Pi));
+
+        _mm256_storeu_pd(delta + i, _mm256_mul_pd(s, cdfFromExp4(_mm256_mul_pd(s, d1), e1)));
+        _mm256_storeu_pd(gamma + i, _mm256_div_pd(pdf, _mm256_mul_pd(f, vt)));
+        _mm256_storeu_pd(vega + i, _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(f, pdf), sqrt_t), set(100.0)));
+    }
+}
+
+#endif // SIMD_HAVE_AVX2
+
+} // namespace
+
+double normCdf(double x) {
+    return cdfFromExp(x, std::exp(-0.5 * x * x));
+}
+
+double price(double forward, double strike, double expiry_years, double sigma, double call_sign) {
+    if (!(expiry_years > 0.0) || !(sigma > 0.0)) {
+        return std::max(call_sign * (forward - strike), 0.0);
+    }
+    double vt = sigma * std::sqrt(expiry_years);
+    double d1 = std::log(forward / strike) / vt + 0.5 * vt;
+    double d2 = d1 - vt;
+    return call_sign * (forward * normCdf(call_sign * d1) - strike * normCdf(call_sign * d2));
+}
+
+void impliedVolBatch(const double* forward, const double* strike, const double* expiry_years,
+                     const double* call_sign, const double* price, double* iv, std::size_t n) {
+    std::size_t done = 0;
+#if SIMD_HAVE_AVX2
+    if (simd::hasAvx2()) {
+        impliedVolAvx2(forward, strike, expiry_years, call_sign, price, iv, n);
+        done = n - n % 4;
+    }
+#endif
+    for (std::size_t i = done; i < n; ++i) {
+        iv[i] = impliedVolScalar(forward[i], strike[i], expiry_years[i], call_sign[i], price[i], iv[i]);
+    }
+}
+
+void greeksBatch(const double* forward, const double* strike, const double* expiry_years,
+                 const double* call_sign, const double* iv,
+                 double* delta, double* gamma, double* vega, std::size_t n) {
+    std::size_t done = 0;
+#if SIMD_HAVE_AVX2
+    if (simd::hasAvx2()) {
+        greeksAvx2(forward, strike, expiry_years, call_sign, iv, delta, gamma, vega, n);
+        done = n - n % 4;
+    }
+#endif
+    for (std::size_t i = done; i < n; ++i) {
+        greeksScalar(forward[i], strike[i], expiry_years[i], call_sign[i], iv[i], delta[i], gamma[i], vega[i]);
+    }
+}
+
+} // namespace black76
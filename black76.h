@@ -0,0 +1,28 @@
+#ifndef BLACK76_H
+#define BLACK76_H
+
+#include <cstddef>
+
+// Black-76 pricing on the forward with zero rates, which is how Deribit marks
+// its options. Batch functions take structure-of-arrays inputs and run four
+// options per AVX2 instruction when available, with a scalar fallback.
+//
+// call_sign is +1 for calls and -1 for puts. Vega is per 1 vol point (1%).
+namespace black76 {
+
+double normCdf(double x);
+double price(double forward, double strike, double expiry_years, double sigma, double call_sign);
+
+// Solve implied vol for each option. iv holds the starting guess on entry
+// (anything <= 0 uses a default) and the result on exit; prices outside the
+// no-arbitrage bounds give NaN.
+void impliedVolBatch(const double* forward, const double* strike, const double* expiry_years,
+                     const double* call_sign, const double* price, double* iv, std::size_t n);
+
+void greeksBatch(const double* forward, const double* strike, const double* expiry_years,
+                 const double* call_sign, const double* iv,
+                 double* delta, double* gamma, double* vega, std::size_t n);
+
+} // namespace black76
+
+#endif // BLACK76_H
@@ -0,0 +1,105 @@
+#include "book_analytics.h"
+#include "simd_kernels.h"
+#include <algorithm>
+
+BookAnalytics::BookAnalytics(std::size_t max_levels)
+    : max_levels_(max_levels) {
+    for (Cumulative* side : {&bids_, &asks_}) {
+        side->size.resize(max_levels_);
+        side->notional.resize(max_levels_);
+    }
+}
+
+void BookAnalytics::refresh(OrderBook& book) {
+    // A different book invalidates everything we cached
+    if (book_ != &book) {
+        bids_.count = 0;
+        asks_.count = 0;
+    }
+    refreshSide(book, BookSide::Bid);
+    refreshSide(book, BookSide::Ask);
+    book_ = &book;
+    book.markClean();
+}
+
+void BookAnalytics::refreshSide(const OrderBook& book, BookSide side) {
+    Cumulative& cum = cumulative(side);
+    std::size_t count = std::min(book.depth(side), max_levels_);
+    std::size_t from = book_ == &book ? std::min(book.dirtyFrom(side), cum.count) : 0;
+
+    // Levels below max_levels_ that the delta did not reach keep their sums
+    if (from < count) {
+        double size_carry = from > 0 ? cum.size[from - 1] : 0.0;
+        double notional_carry = from > 0 ? cum.notional[from - 1] : 0.0;
+        simd::prefixSum(book.sizes(side) + from, cum.size.data() + from, count - from, size_carry);
+        simd::prefixSumProducts(book.prices(side) + from, book.sizes(side) + from,
+                                cum.notional.data() + from, count - from, notional_carry);
+    }
+    cum.count = count;
+}
+
+double BookAnalytics::microprice() const {
+    if (!book_ || bids_.count == 0 || asks_.count == 0) return 0.0;
+    double bid = book_->bestPrice(BookSide::Bid);
+    double ask = book_->bestPrice(BookSide::Ask);
+    double bid_size = book_->bestSize(BookSide::Bid);
+    double ask_size = book_->bestSize(BookSide::Ask);
+    double total = bid_size + ask_size;
+    if (total <= 0.0) return (bid + ask) / 2.0;
+    // Weight each side's price by the opposite side's size
+    return (bid * ask_size + ask * bid_size) / total;
+}
+
+double BookAnalytics::imbalance(std::size_t levels) const {
+    double bid_size = cumulativeSize(BookSide::Bid, levels);
+    double ask_size = cumulativeSize(BookSide::Ask, levels);
+    double total = bid_size + ask_size;
+    return total > 0.0 ? (bid_size - ask_size) / total : 0.0;
+}
+
+double BookAnalytics::cumulativeSize(BookSide side, std::size_t levels) const {
+    const Cumulative& cum = cumulative(side);
+    std::size_t n = std::min(levels, cum.count);
+    return n > 0 ? cum.size[n - 1] : 0.0;
+}
+
+DepthFill BookAnalytics::depthToNotional(BookSide side, double notional) const {
+    return walk(side, notional, true);
+}
+
+DepthFill BookAnalytics::fillSize(BookSide side, double size) const {
+    return walk(side, size, false);
+}
+
+DepthFill BookAnalytics::walk(BookSide side, double target, bool by_notional) const {
+    DepthFill fill;
+    const Cumulative& cum = cumulative(side);
+    if (!book_ || cum.count == 0 || target <= 0.0) return fill;
+
+    const std::vector<double>& running = by_notional ? cum.notional : cum.size;
+    const double* prices = book_->prices(side);
+    std::size_t k = static_cast<std::size_t>(
+        std::lower_bound(running.begin(), running.begin() + cum.count, target) - running.begin());
+
+    if (k == cum.count) {
+        fill.size = cum.size[k - 1];
+        fill.notional = cum.notional[k - 1];
+        fill.worst_price = prices[k - 1];
+        fill.levels = k;
+        return fill;
+    }
+
+    double prev_size = k > 0 ? cum.size[k - 1] : 0.0;
+    double prev_notional = k > 0 ? cum.notional[k - 1] : 0.0;
+    if (by_notional) {
+        fill.notional = target;
+        fill.size = prev_size + (target - prev_notional) / prices[k];
+    } else {
+        fill.size = target;
+        fill.notional = prev_notional + (target - prev_size) * prices[k];
+    }
+    fill.worst_price = prices[k];
+    fill.levels = k + 1;
+    fill.complete = true;
+    return fill;
+}
@@ -0,0 +1,64 @@
+#ifndef BOOK_ANALYTICS_H
+#define BOOK_ANALYTICS_H
+
+#include "order_book.h"
+#include <cstddef>
+#include <vector>
+
+// Result of walking one side of the book
+struct DepthFill {
+    double size = 0.0;          // contracts consumed
+    double notional = 0.0;      // sum of price * size consumed
+    double worst_price = 0.0;   // deepest price touched
+    std::size_t levels = 0;     // levels touched, including a partial one
+    bool complete = false;      // false when the visible book ran out
+
+    double vwap() const { return size > 0.0 ? notional / size : 0.0; }
+};
+
+// Signal analytics over an OrderBook's level arrays: microprice, top-N
+// imbalance, depth to a notional and VWAP to fill a size. refresh() keeps
+// cumulative size/notional arrays (computed with the SIMD prefix kernels) and
+// only recomputes them from the shallowest level a delta touched, so queries
+// afterwards are O(1) or O(log levels).
+class BookAnalytics {
+public:
+    explicit BookAnalytics(std::size_t max_levels = 100);
+
+    // Bring the cumulative arrays up to date with book and mark it clean. The
+    // book must outlive the queries made against this refresh.
+    void refresh(OrderBook& book);
+
+    double microprice() const;
+
+    // (bid size - ask size) / (bid size + ask size) over the top levels, in [-1, 1]
+    double imbalance(std::size_t levels) const;
+    double cumulativeSize(BookSide side, std::size_t levels) const;
+
+    // Walk side until notional (price * size) is reached
+    DepthFill depthToNotional(BookSide side, double notional) const;
+
+    // Walk side to fill size; buying consumes the asks, selling the bids
+    DepthFill fillSize(BookSide side, double size) const;
+
+    std::size_t levels(BookSide side) const { return cumulative(side).count; }
+
+private:
+    struct Cumulative {
+        std::vector<double> size;
+        std::vector<double> notional;
+        std::size_t count = 0;
+    };
+
+    Cumulative& cumulative(BookSide side) { return side == BookSide::Bid ? bids_ : asks_; }
+    const Cumulative& cumulative(BookSide side) const { return side == BookSide::Bid ? bids_ : asks_; }
+    void refreshSide(const OrderBook& book, BookSide side);
+    DepthFill walk(BookSide side, double target, bool by_notional) const;
+
+    std::size_t max_levels_;
+    Cumulative bids_;
+    Cumulative asks_;
+    const OrderBook* book_ = nullptr;
+};
+
+#endif // BOOK_ANALYTICS_H
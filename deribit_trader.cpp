@@ -2,6 +2,15 @@
 #include "websocket_handler.h"
 #include "trade_execution.h"
 #include "latency_module.h"
+#include "order_trace.h"
+#include "metrics_server.h"
+#include "fix_session.h"
+#include "fix_acceptor_stub.h"
+#include "backtest.h"
+#include "tick_store.h"
+#include "order_flow.h"
+#include "feed_monitor.h"
+#include "feed_pipeline.h"
 #include <iostream>
 #include <string>
 #include <exception>
@@ -10,9 +19,115 @@
 #include <future>
 #include <vector>
 #include <thread>
-#include <immintrin.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// Command line options
+struct CliOptions {
+    std::string trace_file;     // dump the per-order trace here on exit
+    int metrics_port = -1;      // serve Prometheus metrics on this port (0 = any free port)
+    bool latency_log = true;    // print LatencyModule lines to stdout
+    std::string fix_address;    // HOST:PORT of a FIX acceptor for order entry
+    int fix_stub_port = -1;     // run a local FIX acceptor stub and route orders to it
+    bool standby = false;       // keep a second authenticated connection for failover
+    std::string tick_store_root;            // record top of book and trades under this directory
+    std::string book_checkpoint;            // restore order books from and checkpoint them to this file
+    bool order_flow = false;                // run order_flow_spec instead of the menu
+    OrderFlowSpec order_flow_spec;
+    bool feed_monitor = false;              // watch for stalled channels and an unresponsive connection
+    FeedMonitorConfig feed_monitor_config;
+    bool pipeline = false;                  // parse and apply market data on worker threads
+    FeedPipelineConfig pipeline_config;
+    DeflateConfig deflate;                  // permessage-deflate offer
+    std::string deflate_bench_source;       // recording or synthetic[:SEED[:STEPS]]
+    std::string backtest_source;            // recording path or synthetic[:SEED[:STEPS]]
+    std::vector<std::string> bt_latency;    // LEG=SPEC latency overrides
+    uint64_t bt_seed = 1;
+    int bt_requote_ticks = 1;
+    int sweep_points = 0;                   // wire latencies to sweep (0 = single run)
+};
+
+// A decimal number in [low, high] spanning all of value. stoull alone takes
+// a sign, leading blanks and trailing junk.
+template <typename T>
+bool parseNumber(const std::string& value, T low, T high, T& out) {
+    if (value.empty() || !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    try {
+        unsigned long long parsed = std::stoull(value);
+        if (parsed < static_cast<unsigned long long>(low) || parsed > static_cast<unsigned long long>(high)) {
+            return false;
+        }
+        out = static_cast<T>(parsed);
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;   // out of range for unsigned long long
+    }
+}
+
+// parseNumber for a command line flag, saying what was expected when it fails
+template <typename T>
+bool parseFlag(const char* flag, const std::string& value, T low, T high, T& out) {
+    if (parseNumber(value, low, high, out)) return true;
+    std::cerr << "Invalid " << flag << " " << value << " (expected " << low << "-" << high << ")" << std::endl;
+    return false;
+}
+
+// Hand the subscribed feed to a reader on the io_context until 'q', then
+// unsubscribe and wait for the socket to come back. With a pipeline the
+// reader only copies frames to the workers, which parse and apply them, so
+// on_message is not called; otherwise it gets every message on the IO
+// thread, parsed into the per-message arena and released when it returns.
+void runFeedUntilQuit(TradeExecution* trade, const std::shared_ptr<WebSocketHandler>& websocket,
+                      const CliOptions& options, const std::string& subscription,
+                      std::function<void(const arena_json&)> on_message) {
+    std::unique_ptr<FeedPipeline> pipeline;
+    if (options.pipeline) {
+        pipeline.reset(new FeedPipeline(options.pipeline_config,
+                                        [trade](const arena_json& message) {
+                                            trade->handleSubscriptionMessage(message);
+                                        },
+                                        [trade](const char* data, std::size_t size) {
+                                            trade->handleDroppedFrame(data, size);
+                                        }));
+        pipeline->start();
+        trade->startFeed([&pipeline](const char* data, std::size_t size) {
+            pipeline->push(data, size);
+        });
+    } else {
+        trade->startFeed([websocket, on_message = std::move(on_message)](const char* data, std::size_t size) {
+            websocket->parse_frame(data, size, on_message);
+        });
+    }
+
+    char input;
+    while (std::cin.get(input) && input != 'q') {
+    }
+    trade->unsubscribeFromOrderBook(subscription);
+    trade->stopFeed();
+    if (pipeline) {
+        pipeline->stop();
+        pipeline->stats().print(std::cout);
+    }
+
+    ArenaStats arena = websocket->arenaStats();
+    std::cout << "Message arena: " << arena.messages << " messages, "
+              << arena.allocations << " allocations, "
+              << arena.heap_blocks << " heap blocks, peak "
+              << arena.peak_message_bytes << " bytes per message\n";
+}
 
-void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSocketHandler> websocket) {
+void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSocketHandler> websocket,
+                      const CliOptions& options) {
     std::string instrument_name, order_id;
     double amount, price;
 
@@ -31,7 +146,8 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                         std::cout << "Order thread ID: " << std::this_thread::get_id() << std::endl;
                         auto order_start = LatencyModule::start();
                         auto result = trade->placeBuyOrder(instrument_name, amount, price);
-                        LatencyModule::end(order_start, "Order Placement");
+                        static const LatencyModule::Action order_latency("Order Placement");
+                        LatencyModule::end(order_start, order_latency);
                         return result;
                     });
                 std::cout << "Main thread continues immediately..." << std::endl;
@@ -54,7 +170,8 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                         std::cout << "Cancel Order thread ID: " << std::this_thread::get_id() << std::endl;
                         auto cancel_start = LatencyModule::start();
                         auto result = trade->cancelOrder(order_id);
-                        LatencyModule::end(cancel_start, "Cancel Order");
+                        static const LatencyModule::Action cancel_latency("Cancel Order");
+                        LatencyModule::end(cancel_start, cancel_latency);
                         return result;
                     });
 
@@ -81,7 +198,8 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                         std::cout << "Modify Order thread ID: " << std::this_thread::get_id() << std::endl;
                         auto modify_start = LatencyModule::start();
                         auto result = trade->modifyOrder(order_id, price, amount);
-                        LatencyModule::end(modify_start, "Modify Order");
+                        static const LatencyModule::Action modify_latency("Modify Order");
+                        LatencyModule::end(modify_start, modify_latency);
                         return result;
                     });
 
@@ -105,7 +223,8 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                         auto orderbook_start = LatencyModule::start();
                         std::cout << "Order book thread ID: " << std::this_thread::get_id() << std::endl;
                         auto result = trade->getOrderBook(instrument_name);
-                        LatencyModule::end(orderbook_start, "Order Book Fetch");
+                        static const LatencyModule::Action orderbook_latency("Order Book Fetch");
+                        LatencyModule::end(orderbook_start, orderbook_latency);
                         return result;
                     });
 
@@ -133,6 +252,15 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                                 std::cout << "Price: " << ask[0] << ", Size: " << ask[1] << "\n";
                             }
                         }
+
+                        if (const BookAnalytics* analytics = trade->orderBooks().analytics(instrument_name)) {
+                            DepthFill buy = analytics->fillSize(BookSide::Ask, analytics->cumulativeSize(BookSide::Ask, 5));
+                            DepthFill sell = analytics->fillSize(BookSide::Bid, analytics->cumulativeSize(BookSide::Bid, 5));
+                            std::cout << "\nMicroprice: " << analytics->microprice() << "\n";
+                            std::cout << "Top 5 Imbalance: " << analytics->imbalance(5) << "\n";
+                            std::cout << "VWAP to buy top 5 asks (" << buy.size << "): " << buy.vwap() << "\n";
+                            std::cout << "VWAP to sell top 5 bids (" << sell.size << "): " << sell.vwap() << "\n";
+                        }
                     }
                 } else {
                     throw std::runtime_error("Order book fetch timed out");
@@ -150,7 +278,8 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                         auto position_start = LatencyModule::start();
                         std::cout << "Position thread ID: " << std::this_thread::get_id() << std::endl;
                         auto result = trade->getPosition(instrument_name);
-                        LatencyModule::end(position_start, "Position Fetch");
+                        static const LatencyModule::Action position_latency("Position Fetch");
+                        LatencyModule::end(position_start, position_latency);
                         return result;
                     });
 
@@ -175,37 +304,74 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
                 std::cout << "Enter instrument name to subscribe (e.g., BTC-PERPETUAL): ";
                 std::cin >> instrument_name;
 
-                std::atomic<bool> running{true};
                 trade->subscribeToOrderBook(instrument_name);
+                trade->subscribeToTrades(instrument_name);
                 std::cout << "Subscribed to order book updates. Press 'q' to unsubscribe.\n";
 
-                std::thread listen_thread([&running, websocket]() {
-                    while(running) {
-                        try {
-                            json message = websocket->readMessage();
-                            if(!message.empty()) {
-                                websocket->handleOrderBookUpdate(message);
-                            }
-                        } catch (const std::exception& e) {
-                            if (running) {
-                                std::cerr << "Error reading message: " << e.what() << std::endl;
-                            }
+                // Without a pipeline every message is printed as it is applied
+                runFeedUntilQuit(trade, websocket, options, instrument_name,
+                                 [websocket, trade, instrument_name](const arena_json& message) {
+                    trade->handleSubscriptionMessage(message);
+
+                    bool is_trade = message.contains("params") && message["params"].contains("channel")
+                        && message["params"]["channel"].get_ref<const std::string&>().rfind("trades.", 0) == 0;
+                    if(is_trade) {
+                        auto stats = trade->tradeAggregator().windowStats(instrument_name);
+                        auto bar = trade->tradeAggregator().currentBar(instrument_name);
+                        std::cout << "Trades: VWAP(60s) " << stats.vwap
+                                  << ", Volume " << stats.volume
+                                  << ", Imbalance " << stats.imbalance
+                                  << " | Bar O " << bar.open << " H " << bar.high
+                                  << " L " << bar.low << " C " << bar.close
+                                  << " V " << bar.volume << std::endl;
+                    } else {
+                        websocket->handleOrderBookUpdate(message);
+                        if (const BookAnalytics* analytics = trade->orderBooks().analytics(instrument_name)) {
+                            std::cout << "Microprice: " << analytics->microprice()
+                                      << ", Top 5 Imbalance: " << analytics->imbalance(5) << std::endl;
                         }
-                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
                     }
                 });
+                break;
+            }
 
-                std::thread input_thread([&running, trade, instrument_name]() {
-                    char input;
-                    while (running && (input = std::cin.get()) != 'q') {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    }
-                    running = false;
-                    trade->unsubscribeFromOrderBook(instrument_name);
+            case 7: {  // Options Chain Analytics
+                std::string currency;
+                std::cout << "Enter underlying currency (e.g., BTC): ";
+                std::cin >> currency;
+
+                trade->loadOptionChain(currency);
+                std::vector<std::string> options_listed = trade->optionsAnalytics().instruments(currency);
+                if (options_listed.empty()) {
+                    std::cout << "No options listed for " << currency << "\n";
+                    break;
+                }
+                trade->subscribeToOptionChain(currency);
+                std::cout << "Subscribed to " << options_listed.size() << " option tickers and the "
+                          << currency << " index. Press 'q' to unsubscribe.\n";
+                runFeedUntilQuit(trade, websocket, options, currency, [trade](const arena_json& message) {
+                    trade->handleSubscriptionMessage(message);
                 });
 
-                if(listen_thread.joinable()) listen_thread.join();
-                if(input_thread.joinable()) input_thread.join();
+                // Greeks of the nearest expiry with any valued strike
+                std::cout << std::left << std::setw(26) << "Instrument" << std::right << std::setw(12) << "Forward"
+                          << std::setw(9) << "IV" << std::setw(9) << "Delta" << std::setw(12) << "Gamma"
+                          << std::setw(10) << "Vega" << "\n";
+                std::string expiry;
+                for (const std::string& name : options_listed) {
+                    std::string name_expiry = name.substr(0, name.find('-', name.find('-') + 1));
+                    if (!expiry.empty() && name_expiry != expiry) break;
+                    OptionGreeks greeks;
+                    if (!trade->optionsAnalytics().greeks(name, greeks)) continue;
+                    expiry = name_expiry;
+                    std::cout << std::left << std::setw(26) << name << std::right << std::fixed
+                              << std::setprecision(2) << std::setw(12) << greeks.forward
+                              << std::setprecision(4) << std::setw(9) << greeks.iv << std::setw(9) << greeks.delta
+                              << std::setprecision(8) << std::setw(12) << greeks.gamma
+                              << std::setprecision(4) << std::setw(10) << greeks.vega
+                              << std::defaultfloat << std::setprecision(6) << "\n";
+                }
+                if (expiry.empty()) std::cout << "No strike valued yet\n";
                 break;
             }
 
@@ -220,7 +386,7 @@ void handleMenuChoice(int choice, TradeExecution* trade, std::shared_ptr<WebSock
 }
 
 
-void executeTrades() {
+void executeTrades(const CliOptions& options) {
     try {
         // Create io_context with work guard
         asio::io_context ioc;
@@ -233,8 +399,24 @@ void executeTrades() {
         
         // Create the WebSocket handler and trade execution objects
         auto websocket = std::make_shared<WebSocketHandler>(ioc, "test.deribit.com", "443", "/ws/api/v2");
+        if (options.deflate.enabled) websocket->set_deflate(options.deflate);
         auto trade = std::make_unique<TradeExecution>(*websocket);
 
+        std::unique_ptr<TickStoreWriter> tick_store;
+        if (!options.tick_store_root.empty()) {
+            TickStoreConfig config;
+            config.root = options.tick_store_root;
+            tick_store.reset(new TickStoreWriter(config));
+            tick_store->start();
+            trade->setTickStore(tick_store.get());
+        }
+
+        std::unique_ptr<MetricsServer> metrics;
+        if (options.metrics_port >= 0) {
+            metrics.reset(new MetricsServer(static_cast<uint16_t>(options.metrics_port)));
+            if (!metrics->start()) metrics.reset();
+        }
+
         // Start the IO context in a separate thread
         std::thread ioc_thread([&ioc]() {
             try {
@@ -246,27 +428,21 @@ void executeTrades() {
             }
         });
 
-        // Connect asynchronously with timeout
+        // Connect and authenticate as one coroutine on the io_context
         auto connection_start = std::chrono::steady_clock::now();
-        websocket->async_connect([&trade, &is_connected, &is_authenticated]
-            (boost::system::error_code ec) {
-            if (!ec) {
-                is_connected = true;
-                std::cout << "Connected successfully, attempting authentication...\n";
-                
-                try {
-                    json auth_response = trade->authenticate(CLIENT_ID, CLIENT_SECRET);
-                    if (auth_response.contains("result")) {
-                        is_authenticated = true;
-                        std::cout << "Authentication successful!\n";
-                    } else {
-                        std::cerr << "Authentication failed!\n";
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Authentication error: " << e.what() << std::endl;
-                }
-            } else {
-                std::cerr << "Connection failed: " << ec.message() << std::endl;
+        asio::co_spawn(ioc, [&]() -> asio::awaitable<void> {
+            co_await websocket->co_connect();
+            is_connected = true;
+            std::cout << "Connected successfully, attempting authentication...\n";
+            co_await trade->asyncAuthenticate(CLIENT_ID, CLIENT_SECRET);
+            is_authenticated = true;
+            std::cout << "Authentication successful!\n";
+        }, [](std::exception_ptr e) {
+            if (!e) return;
+            try {
+                std::rethrow_exception(e);
+            } catch (const std::exception& err) {
+                std::cerr << "Connection/Authentication error: " << err.what() << std::endl;
             }
         });
 
@@ -283,6 +459,93 @@ void executeTrades() {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         
+        if (!should_exit && options.deflate.enabled) {
+            std::cout << "permessage-deflate " << (websocket->compression_stats().negotiated ? "negotiated" : "declined")
+                      << " (" << options.deflate.describe() << ")\n";
+        }
+
+        if (!should_exit && !options.book_checkpoint.empty()) {
+            // Warm restart: books younger than ten minutes bridge to the live
+            // feed once subscribed (menu option 6), if their change_id chain
+            // still connects
+            auto restored = trade->restoreBookCheckpoint(options.book_checkpoint, 10 * 60 * 1000);
+            std::cout << "Restored " << restored.size() << " order books from " << options.book_checkpoint << "\n";
+            trade->enableBookCheckpoints(options.book_checkpoint, std::chrono::seconds(5));
+        }
+
+        // Fills time the last stage of each traced order
+        if (!should_exit && !options.trace_file.empty()) {
+            trade->subscribeToUserTrades();
+        }
+
+        // Stall events arrive on the monitor's thread; a quoting strategy would
+        // pull its quotes here (QuoteManager::cancelAll) and requote on resume.
+        // The monitor and heartbeats only run while the order book listener
+        // (menu option 6) reads the socket.
+        std::unique_ptr<FeedMonitor> feed_monitor;
+        if (!should_exit && options.feed_monitor) {
+            feed_monitor.reset(new FeedMonitor(options.feed_monitor_config));
+            feed_monitor->setEventHandler([](const FeedEvent& event) {
+                std::cerr << "Feed " << feedEventName(event.kind)
+                          << (event.channel.empty() ? "" : ": " + event.channel) << " after "
+                          << event.silence.count() / 1000.0 << " ms (threshold "
+                          << event.threshold.count() / 1000.0 << " ms)" << std::endl;
+            });
+            trade->setFeedMonitor(feed_monitor.get());
+        }
+
+        if (!should_exit && options.standby) {
+            if (trade->prepareStandbyConnection(CLIENT_ID, CLIENT_SECRET)) {
+                std::cout << "Standby connection ready\n";
+            } else {
+                std::cerr << "Continuing without a standby connection\n";
+            }
+        }
+
+        // Optional FIX order entry; market data stays on the WebSocket
+        std::unique_ptr<FixAcceptorStub> fix_stub;
+        std::unique_ptr<FixSession> fix_session;
+        std::unique_ptr<FixOrderTransport> fix_transport;
+        if (!should_exit && (!options.fix_address.empty() || options.fix_stub_port >= 0)) {
+            FixSessionConfig config;
+            config.client_id = CLIENT_ID;
+            config.client_secret = CLIENT_SECRET;
+            if (options.fix_stub_port >= 0) {
+                fix_stub.reset(new FixAcceptorStub(static_cast<uint16_t>(options.fix_stub_port), CLIENT_SECRET));
+                if (fix_stub->start()) {
+                    config.host = "127.0.0.1";
+                    config.port = std::to_string(fix_stub->port());
+                }
+            } else {
+                std::size_t colon = options.fix_address.rfind(':');
+                config.host = options.fix_address.substr(0, colon);
+                config.port = colon == std::string::npos ? "9881" : options.fix_address.substr(colon + 1);
+            }
+
+            fix_session.reset(new FixSession(config));
+            if (!config.host.empty() && fix_session->logon()) {
+                fix_transport.reset(new FixOrderTransport(*fix_session));
+                trade->setOrderTransport(fix_transport.get());
+            } else {
+                std::cerr << "FIX unavailable, orders stay on JSON-RPC\n";
+            }
+            std::cout << "Order entry via " << trade->orderTransportName() << "\n";
+        }
+
+        // Headless load test of the order path, over whichever transport was chosen
+        if (!should_exit && options.order_flow) {
+            std::cout << "Order flow: " << options.order_flow_spec.describe() << "\n";
+            try {
+                OrderFlowDriver driver(*trade, options.order_flow_spec);
+                auto report = asio::co_spawn(ioc, driver.run(), asio::use_future);
+                report.get().print(std::cout);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Order flow failed: " << e.what() << std::endl;
+            }
+            should_exit = true;
+        }
+
         if (!should_exit) {
             std::cout << "\nConnected and authenticated successfully!\n";
             
@@ -295,7 +558,8 @@ void executeTrades() {
                 std::cout << "4. Get Order Book\n";
                 std::cout << "5. View Current Positions\n";
                 std::cout << "6. Subscribe to Order Book Updates\n";
-                std::cout << "7. Exit\n";
+                std::cout << "7. Options Chain Analytics\n";
+                std::cout << "8. Exit\n";
                 std::cout << "Enter your choice: ";
                 
                 int choice;
@@ -306,14 +570,14 @@ void executeTrades() {
                     continue;
                 }
 
-                if (choice == 7) {
+                if (choice == 8) {
                     should_exit = true;
                     break;
                 }
 
                 // Handle menu choices with proper error handling
                 try {
-                    handleMenuChoice(choice, trade.get(), websocket);
+                    handleMenuChoice(choice, trade.get(), websocket, options);
                 } catch (const std::exception& e) {
                     std::cerr << "Error processing menu choice: " << e.what() << std::endl;
                 }
@@ -322,6 +586,31 @@ void executeTrades() {
 
         // Cleanup
         std::cout << "Cleaning up...\n";
+        if (feed_monitor) {
+            feed_monitor->stop();
+            trade->setFeedMonitor(nullptr);
+            RttStats ping = feed_monitor->pingRtt();
+            RttStats heartbeat = feed_monitor->heartbeatRtt();
+            std::cout << "RTT ping: " << ping.samples << " samples, smoothed " << ping.smoothed_us << " us, min "
+                      << ping.min_us << " us, max " << ping.max_us << " us; heartbeat: " << heartbeat.samples
+                      << " samples, smoothed " << heartbeat.smoothed_us << " us\n";
+            for (const auto& channel : feed_monitor->channels()) {
+                std::cout << "  " << channel.channel << ": " << channel.updates << " updates, " << channel.stalls
+                          << " stalls, expected " << channel.expected_ms << " ms, threshold "
+                          << channel.threshold_ms << " ms\n";
+            }
+        }
+        trade->setOrderTransport(nullptr);
+        fix_transport.reset();
+        fix_session.reset();
+        fix_stub.reset();
+        if (!options.trace_file.empty()) {
+            if (trade->orderTracer().dumpToFile(options.trace_file)) {
+                std::cout << "Order trace written to " << options.trace_file << "\n";
+            } else {
+                std::cerr << "Failed to write order trace to " << options.trace_file << "\n";
+            }
+        }
         work.reset(); // Allow io_context to stop
         websocket->close();
         ioc.stop();
@@ -329,6 +618,25 @@ void executeTrades() {
         if (ioc_thread.joinable()) {
             ioc_thread.join();
         }
+        if (metrics) metrics->stop();
+        CompressionStats compression = websocket->compression_stats();
+        if (compression.messages > 0) {
+            std::cout << "Inbound: " << compression.messages << " messages, " << compression.payload_bytes
+                      << " payload bytes over " << compression.wire_bytes << " TLS bytes (ratio "
+                      << std::setprecision(3) << compression.ratio() << ")";
+            if (compression.cpu_messages > 0) {
+                std::cout << ", " << compression.read_cpu_seconds * 1e6 / compression.cpu_messages
+                          << " us CPU per blocking read";
+            }
+            std::cout << "\n";
+        }
+        if (!options.book_checkpoint.empty() && trade->saveBookCheckpoint()) {
+            std::cout << "Order books checkpointed to " << options.book_checkpoint << "\n";
+        }
+        if (tick_store) {
+            trade->setTickStore(nullptr);
+            tick_store->stop();
+        }
         
         std::cout << "Cleanup complete. Exiting...\n";
     }
@@ -339,9 +647,337 @@ void executeTrades() {
 
 
 
-int main() {
+// Order entry cost per message on each wire format: build and serialise a
+// limit order, then parse the exchange's acknowledgement
+void runCodecBenchmark(int iterations) {
+    using clock = std::chrono::steady_clock;
+    const std::string json_reply = R"({"jsonrpc":"2.0","id":42,"result":{"order":{"order_id":"ETH-1234567",)"
+        R"("instrument_name":"BTC-PERPETUAL","direction":"buy","amount":10.0,"price":65000.5,)"
+        R"("filled_amount":0.0,"average_price":0.0,"order_state":"open"},"trades":[]}})";
+
+    FixEncoder reply_encoder;
+    reply_encoder.begin(fix::kExecutionReport, "DERIBITSERVER", "DERIBIT_TRADER", 42, 1700000000000);
+    reply_encoder.field(fix::kOrderID, "ETH-1234567").field(fix::kClOrdID, int64_t{42})
+                 .field(fix::kExecType, '0').field(fix::kOrdStatus, '0').field(fix::kSymbol, "BTC-PERPETUAL")
+                 .field(fix::kSide, '1').field(fix::kOrderQty, 10.0).field(fix::kPrice, 65000.5)
+                 .field(fix::kCumQty, 0.0).field(fix::kLeavesQty, 10.0).field(fix::kAvgPx, 0.0);
+    const std::string fix_reply(reply_encoder.finish());
+
+    std::size_t sink = 0;
+    auto json_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", i},
+            {"method", "private/buy"},
+            {"params", {{"instrument_name", "BTC-PERPETUAL"}, {"amount", 10.0}, {"type", "limit"}, {"price", 65000.5}}}
+        };
+        sink += request.dump().size();
+        json reply = json::parse(json_reply);
+        sink += reply["result"]["order"]["order_id"].get_ref<const std::string&>().size();
+    }
+    auto json_ns = std::chrono::duration<double, std::nano>(clock::now() - json_start).count();
+
+    FixEncoder encoder;
+    FixMessage message;
+    auto fix_start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        encoder.begin(fix::kNewOrderSingle, "DERIBIT_TRADER", "DERIBITSERVER", static_cast<uint64_t>(i) + 1,
+                      1700000000000);
+        encoder.field(fix::kClOrdID, static_cast<int64_t>(i)).field(fix::kSide, '1').field(fix::kOrderQty, 10.0)
+               .field(fix::kPrice, 65000.5).field(fix::kOrdType, '2').field(fix::kSymbol, "BTC-PERPETUAL");
+        sink += encoder.finish().size();
+        message.parse(fix_reply.data(), fix_reply.size());
+        sink += message.get(fix::kOrderID).size();
+    }
+    auto fix_ns = std::chrono::duration<double, std::nano>(clock::now() - fix_start).count();
+
+    int n = std::max(iterations, 1);
+    std::cout << "JSON-RPC encode + decode: " << json_ns / n << " ns/order\n"
+              << "FIX 4.4  encode + decode: " << fix_ns / n << " ns/order\n"
+              << "(checksum " << sink << ")\n";
+}
+
+// A recording path, or synthetic[:SEED[:STEPS]]
+MarketData loadMarketData(const std::string& source) {
+    if (source.rfind("synthetic", 0) != 0) return MarketData::loadRecording(source);
+    SyntheticMarketConfig synthetic;
+    std::stringstream spec(source);
+    std::string part;
+    std::getline(spec, part, ':');
+    if (part != "synthetic") throw std::invalid_argument("Expected synthetic[:SEED[:STEPS]], got '" + source + "'");
+    if (std::getline(spec, part, ':') && !parseNumber(part, uint64_t{0}, UINT64_MAX, synthetic.seed)) {
+        throw std::invalid_argument("Invalid synthetic seed '" + part + "'");
+    }
+    if (std::getline(spec, part, ':') && !parseNumber(part, std::size_t{1}, std::size_t{100000000}, synthetic.steps)) {
+        throw std::invalid_argument("Invalid synthetic step count '" + part + "' (expected 1-100000000)");
+    }
+    if (std::getline(spec, part, ':')) throw std::invalid_argument("Expected synthetic[:SEED[:STEPS]], got '" + source + "'");
+    return MarketData::synthetic(synthetic);
+}
+
+// Compare permessage-deflate settings with sending uncompressed, on recorded
+// server messages (one per line, as received) or a synthetic tape. Deflate
+// plays the server, whose real compression level is its own choice. Links
+// slower than the break-even speed receive compressed messages sooner; on
+// faster ones the CPU costs more than the bytes saved.
+int runDeflateBenchmark(const std::string& source, const DeflateConfig& requested) {
+    std::vector<std::string> messages;
+    if (source.rfind("synthetic", 0) == 0) {
+        MarketData data = loadMarketData(source);
+        for (const auto& event : data.events()) messages.push_back(event.notification.dump());
+    } else {
+        std::ifstream in(source);
+        if (!in) throw std::runtime_error("Cannot open " + source);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) messages.push_back(line);
+        }
+    }
+    if (messages.empty()) throw std::runtime_error("No messages in " + source);
+
+    std::vector<DeflateConfig> configs = requested.enabled ? std::vector<DeflateConfig>{requested} : deflateBenchGrid();
+    uint64_t raw_bytes = 0;
+    for (const auto& message : messages) raw_bytes += message.size();
+    std::cout << messages.size() << " messages, " << raw_bytes << " bytes, "
+              << raw_bytes / messages.size() << " bytes on average\n";
+    std::cout << std::left << std::setw(88) << "setting" << std::right << std::setw(8) << "ratio"
+              << std::setw(14) << "bytes" << std::setw(13) << "deflate us" << std::setw(13) << "inflate us"
+              << std::setw(18) << "break-even Mbit/s" << "\n";
+    std::cout << std::left << std::setw(88) << "off" << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << 1.0 << std::setw(14) << raw_bytes << std::setw(13) << 0.0 << std::setw(13) << 0.0
+              << std::setw(18) << "-" << "\n";
+    for (const auto& config : configs) {
+        DeflateBenchResult result = benchmarkDeflate(messages, config);
+        double n = static_cast<double>(result.messages);
+        std::cout << std::left << std::setw(88) << config.describe() << std::right
+                  << std::setw(8) << result.ratio() << std::setw(14) << result.compressed_bytes
+                  << std::setw(13) << result.deflate_seconds * 1e6 / n << std::setw(13) << result.inflate_seconds * 1e6 / n
+                  << std::setw(18) << result.breakEvenBitsPerSecond() / 1e6 << "\n";
+    }
+    std::cout << "Offer compression on connections slower than the break-even speed of the chosen setting\n";
+    return 0;
+}
+
+// Replay a recording or a synthetic tape through the quoting example. With
+// --sweep, runs a grid of wire latencies and requote thresholds; runs are
+// independent and deterministic, so batches go out on std::async and the
+// results print in grid order.
+int runBacktestCommand(const CliOptions& options) {
+    MarketData data = loadMarketData(options.backtest_source);
+
+    BacktestConfig base;
+    base.seed = options.bt_seed;
+    for (const auto& assignment : options.bt_latency) {
+        base.latency.set(assignment);
+    }
+
+    struct Run {
+        BacktestConfig config;
+        QuoteStrategy::Params params;
+        BacktestResult result;
+    };
+    std::vector<Run> runs;
+    QuoteStrategy::Params params;
+    params.requote_ticks = options.bt_requote_ticks;
+    if (options.sweep_points <= 0) {
+        runs.push_back(Run{base, params, {}});
+    } else {
+        // Log-spaced from 10us to 100ms
+        for (int i = 0; i < options.sweep_points; ++i) {
+            double exponent = options.sweep_points > 1 ? 4.0 * i / (options.sweep_points - 1) : 0.0;
+            LatencyDistribution wire{LatencyDistribution::Kind::LogNormal, 10.0 * std::pow(10.0, exponent), 0.25};
+            for (int ticks : {1, 2, 4, 8}) {
+                Run run{base, params, {}};
+                run.config.latency.wire_out = wire;
+                run.config.latency.wire_in = wire;
+                run.params.requote_ticks = ticks;
+                runs.push_back(run);
+            }
+        }
+    }
+
+    std::cout << data.events().size() << " market events, " << runs.size() << " run(s), latency "
+              << base.latency.describe() << "\n";
+    auto started = std::chrono::steady_clock::now();
+    std::size_t batch = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t first = 0; first < runs.size(); first += batch) {
+        std::size_t last = std::min(runs.size(), first + batch);
+        std::vector<std::future<BacktestResult>> futures;
+        for (std::size_t i = first; i < last; ++i) {
+            futures.push_back(std::async(std::launch::async, [&data, &run = runs[i]]() {
+                QuoteStrategy strategy(run.params);
+                return runBacktest(data, run.config, strategy);
+            }));
+        }
+        for (std::size_t i = first; i < last; ++i) {
+            runs[i].result = futures[i - first].get();
+        }
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << std::left << std::setw(26) << "wire" << std::right << std::setw(8) << "requote"
+              << std::setw(9) << "orders" << std::setw(8) << "fills" << std::setw(12) << "filled"
+              << std::setw(10) << "position" << std::setw(14) << "pnl" << std::setw(10) << "sim s"
+              << std::setw(9) << "wall s" << "\n";
+    for (const auto& run : runs) {
+        const BacktestResult& r = run.result;
+        std::cout << std::left << std::setw(26) << run.config.latency.wire_out.describe() << std::right
+                  << std::setw(8) << run.params.requote_ticks << std::setw(9) << r.orders
+                  << std::setw(8) << r.fills << std::setw(12) << r.filled_amount
+                  << std::setw(10) << r.position << std::setw(14) << std::fixed << std::setprecision(2) << r.pnl
+                  << std::setw(10) << std::setprecision(1) << r.simulated_ns / 1e9
+                  << std::setw(9) << std::setprecision(3) << r.wall_seconds << std::defaultfloat
+                  << std::setprecision(6) << "\n";
+    }
+    std::cout << "Total wall time " << wall << " s\n";
+    return 0;
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --trace-file PATH      write per-order stage timestamps to PATH on exit\n"
+              << "  --trace-summary PATH   print stage latency percentiles from a trace file and exit\n"
+              << "  --metrics-port PORT    serve Prometheus metrics on 127.0.0.1:PORT/metrics\n"
+              << "  --no-latency-log       stop printing per-call latency lines to stdout\n"
+              << "  --standby              keep a pre-authenticated standby connection for failover\n"
+              << "  --fix HOST:PORT        send orders over a FIX 4.4 session instead of JSON-RPC\n"
+              << "  --fix-stub PORT        start a local FIX acceptor stub on PORT and send orders to it\n"
+              << "  --codec-bench N        check FIX float field encoding, time N JSON-RPC vs FIX order encodes and\n"
+              << "                         reply decodes, then exit\n"
+              << "  --tick-store DIR       record top of book and trades as columnar files under DIR\n"
+              << "  --tick-summary FILE    print row counts and column summaries of a tick store file and exit\n"
+              << "  --deflate SPEC         offer permessage-deflate: on, or window=N,client_window=N,server_window=N,\n"
+              << "                         level=N,mem=N,no_takeover,client_no_takeover,server_no_takeover\n"
+              << "  --deflate-bench SOURCE compare deflate settings with uncompressed on SOURCE (one message per\n"
+              << "                         line, or synthetic[:SEED[:STEPS]]), then exit; with --deflate, that setting only\n"
+              << "  --book-checkpoint PATH restore order books from PATH on start, save them every 5s and on exit\n"
+              << "  --order-flow SPEC      send a generated or scripted order flow instead of showing the menu, report\n"
+              << "                         throughput and ack latency, then exit. SPEC is comma separated rate=N,\n"
+              << "                         duration=S, count=N, open_loop, poisson, in_flight=N, instrument=NAME[:W[:TICK]],\n"
+              << "                         mix=PLACE:MODIFY:CANCEL, amount=N, distance=PERCENT, tick=N, price=N, seed=N,\n"
+              << "                         script=PATH\n"
+              << "  --feed-monitor SPEC    while subscribed (menu option 6), ping the exchange, time heartbeats and\n"
+              << "                         report stalled channels: on, or\n"
+              << "                         ping=MS,pong_timeout=MS,check=MS,min_silence=MS,factor=X,heartbeat=S,\n"
+              << "                         channel=NAME:MS (repeatable)\n"
+              << "  --pipeline SPEC        parse and apply subscribed market data on worker threads partitioned by\n"
+              << "                         instrument: N workers, or workers=N,queue=FRAMES,spin=POLLS,stall=US\n"
+              << "  --backtest SOURCE      replay SOURCE (a recording, or synthetic[:SEED[:STEPS]]) through the\n"
+              << "                         simulated exchange with the quoting example, then exit\n"
+              << "  --bt-latency LEG=SPEC  latency of md, out, exchange, in or wire (out and in); SPEC is US,\n"
+              << "                         const:US, uniform:MIN:MAX, normal:MEAN:SD or lognormal:MEDIAN:SIGMA\n"
+              << "  --bt-seed N            seed for latency sampling\n"
+              << "  --bt-requote TICKS     move a quote once the touch is TICKS away\n"
+              << "  --sweep N              sweep N wire latencies (10us-100ms) x requote 1,2,4,8\n";
+}
+
+int main(int argc, char* argv[]) {
+    CliOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace-file" && i + 1 < argc) {
+            options.trace_file = argv[++i];
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            if (!parseFlag("--metrics-port", argv[++i], 0, 65535, options.metrics_port)) return 1;
+        } else if (arg == "--no-latency-log") {
+            options.latency_log = false;
+        } else if (arg == "--standby") {
+            options.standby = true;
+        } else if (arg == "--fix" && i + 1 < argc) {
+            options.fix_address = argv[++i];
+        } else if (arg == "--fix-stub" && i + 1 < argc) {
+            if (!parseFlag("--fix-stub", argv[++i], 0, 65535, options.fix_stub_port)) return 1;
+        } else if (arg == "--codec-bench" && i + 1 < argc) {
+            int iterations = 0;
+            if (!parseFlag("--codec-bench", argv[++i], 1, 100000000, iterations)) return 1;
+            runCodecBenchmark(iterations);
+            return 0;
+        } else if (arg == "--tick-store" && i + 1 < argc) {
+            options.tick_store_root = argv[++i];
+        } else if (arg == "--deflate" && i + 1 < argc) {
+            try {
+                options.deflate = DeflateConfig::parse(argv[++i]);
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--deflate-bench" && i + 1 < argc) {
+            options.deflate_bench_source = argv[++i];
+        } else if (arg == "--order-flow" && i + 1 < argc) {
+            try {
+                options.order_flow_spec = OrderFlowSpec::parse(argv[++i]);
+                options.order_flow = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--feed-monitor" && i + 1 < argc) {
+            try {
+                options.feed_monitor_config = FeedMonitorConfig::parse(argv[++i]);
+                options.feed_monitor = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            try {
+                options.pipeline_config = FeedPipelineConfig::parse(argv[++i]);
+                options.pipeline = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--book-checkpoint" && i + 1 < argc) {
+            options.book_checkpoint = argv[++i];
+        } else if (arg == "--tick-summary" && i + 1 < argc) {
+            return TickStoreReader::summarise(argv[++i], std::cout) ? 0 : 1;
+        } else if (arg == "--backtest" && i + 1 < argc) {
+            options.backtest_source = argv[++i];
+        } else if (arg == "--bt-latency" && i + 1 < argc) {
+            options.bt_latency.push_back(argv[++i]);
+        } else if (arg == "--bt-seed" && i + 1 < argc) {
+            if (!parseFlag("--bt-seed", argv[++i], uint64_t{0}, UINT64_MAX, options.bt_seed)) return 1;
+        } else if (arg == "--bt-requote" && i + 1 < argc) {
+            if (!parseFlag("--bt-requote", argv[++i], 1, 1000000, options.bt_requote_ticks)) return 1;
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            if (!parseFlag("--sweep", argv[++i], 0, 10000, options.sweep_points)) return 1;
+        } else if (arg == "--trace-summary" && i + 1 < argc) {
+            return OrderTracer::summarise(argv[++i], std::cout) ? 0 : 1;
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    LatencyModule::setConsoleOutput(options.latency_log);
+
+    if (!options.deflate_bench_source.empty()) {
+        try {
+            return runDeflateBenchmark(options.deflate_bench_source, options.deflate);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Deflate benchmark failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.backtest_source.empty()) {
+        try {
+            return runBacktestCommand(options);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Backtest failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     try {
-        executeTrades();
+        executeTrades(options);
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -0,0 +1,368 @@
+#include "feed_monitor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kLearnAfter = 8;      // gaps seen before a learned threshold is trusted
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// "book.BTC-PERPETUAL.100ms" -> 100ms; raw and agg2 have no fixed interval
+int64_t namedIntervalNs(const std::string& channel) {
+    std::size_t dot = channel.rfind('.');
+    if (dot == std::string::npos || channel.size() < dot + 4) return 0;
+    std::string last = channel.substr(dot + 1);
+    if (last.compare(last.size() - 2, 2, "ms") != 0) return 0;
+    std::string digits = last.substr(0, last.size() - 2);
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) return 0;
+    return std::stoll(digits) * 1000000;
+}
+
+} // namespace
+
+const char* feedEventName(FeedEvent::Kind kind) {
+    switch (kind) {
+        case FeedEvent::Kind::ChannelStalled: return "channel stalled";
+        case FeedEvent::Kind::ChannelResumed: return "channel resumed";
+        case FeedEvent::Kind::ConnectionStalled: return "connection stalled";
+        case FeedEvent::Kind::ConnectionResumed: return "connection resumed";
+    }
+    return "unknown";
+}
+
+FeedMonitorConfig FeedMonitorConfig::parse(const std::string& spec) {
+    FeedMonitorConfig config;
+    if (spec == "on") return config;
+
+    auto number = [&spec](const std::string& value, double low, double high) {
+        std::size_t used = 0;
+        double parsed = 0.0;
+        try {
+            parsed = std::stod(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != value.size() || !(parsed >= low && parsed <= high)) {
+            throw std::invalid_argument("Bad feed monitor setting in '" + spec + "'");
+        }
+        return parsed;
+    };
+    auto millis = [&number](const std::string& value, double low) {
+        return std::chrono::milliseconds(static_cast<int64_t>(number(value, low, 3600000.0)));
+    };
+
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : item.substr(equals + 1);
+        if (key == "ping") {
+            config.ping_interval = millis(value, 0.0);
+        } else if (key == "pong_timeout") {
+            config.pong_timeout = millis(value, 1.0);
+        } else if (key == "check") {
+            config.check_interval = millis(value, 1.0);
+        } else if (key == "min_silence") {
+            config.min_silence = millis(value, 1.0);
+        } else if (key == "factor") {
+            config.stall_factor = number(value, 1.0, 1000.0);
+        } else if (key == "heartbeat") {
+            config.heartbeat_seconds = static_cast<int>(number(value, 0.0, 3600.0));
+            if (config.heartbeat_seconds > 0 && config.heartbeat_seconds < 10) {
+                throw std::invalid_argument("Deribit heartbeats are at least 10 seconds apart");
+            }
+        } else if (key == "channel") {
+            std::size_t colon = value.rfind(':');
+            if (colon == std::string::npos || colon == 0) {
+                throw std::invalid_argument("channel wants NAME:MS, got '" + value + "'");
+            }
+            config.expected[value.substr(0, colon)] = millis(value.substr(colon + 1), 1.0);
+        } else {
+            throw std::invalid_argument("Unknown feed monitor setting '" + item + "'");
+        }
+    }
+    return config;
+}
+
+FeedMonitor::FeedMonitor(FeedMonitorConfig config)
+    : config_(std::move(config)),
+      ping_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_feed_rtt_seconds", "Round trip time to the exchange", "source=\"ping\"")),
+      heartbeat_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_feed_rtt_seconds", "Round trip time to the exchange", "source=\"heartbeat\"")),
+      channel_stalls_(MetricsRegistry::instance().counter(
+          "deribit_feed_stalls_total", "Feed stalls detected", "scope=\"channel\"")),
+      connection_stalls_(MetricsRegistry::instance().counter(
+          "deribit_feed_stalls_total", "Feed stalls detected", "scope=\"connection\"")),
+      stalled_gauge_(MetricsRegistry::instance().gauge(
+          "deribit_feed_stalled_channels", "Watched channels currently stalled")) {}
+
+FeedMonitor::~FeedMonitor() {
+    stop();
+}
+
+void FeedMonitor::start() {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    if (running_) return;
+    running_ = true;
+    next_ping_ns_ = 0;
+    watchdog_ = std::thread(&FeedMonitor::run, this);
+}
+
+void FeedMonitor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(run_mutex_);
+        running_ = false;
+    }
+    run_cv_.notify_all();
+    if (watchdog_.joinable()) watchdog_.join();
+}
+
+void FeedMonitor::watch(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channels_.count(channel)) return;
+    Channel& state = channels_[channel];
+    auto configured = config_.expected.find(channel);
+    if (configured != config_.expected.end()) {
+        state.fixed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(configured->second).count();
+    } else if (channel.rfind("book.", 0) == 0) {
+        state.floor_ns = namedIntervalNs(channel);
+    } else if (channel.rfind("ticker.", 0) == 0) {
+        state.fixed_ns = namedIntervalNs(channel);
+    } else {
+        state.event_driven = true;
+    }
+}
+
+void FeedMonitor::unwatch(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channel);
+    if (it == channels_.end()) return;
+    if (it->second.stalled) {
+        stalled_gauge_.add(-1);
+        --stalled_channels_;
+    }
+    channels_.erase(it);
+}
+
+void FeedMonitor::unwatchAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : channels_) {
+        if (entry.second.stalled) {
+            stalled_gauge_.add(-1);
+            --stalled_channels_;
+        }
+    }
+    channels_.clear();
+    // No subscriptions, so nobody need be reading pongs any more
+    oldest_unanswered_ns_.store(0);
+}
+
+// Gaps are learned as TCP learns round trips (RFC 6298): the mean moves an
+// eighth and the deviation a quarter of the way to each new sample. The gap
+// that ends a stall is not learned, or one outage would teach patience.
+void FeedMonitor::onUpdate(const std::string& channel) {
+    int64_t now = nowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channel);
+    if (it == channels_.end()) return;
+    Channel& state = it->second;
+    if (state.updates > 0 && !state.stalled) {
+        int64_t gap = now - state.last_ns;
+        if (state.updates == 1) {
+            state.mean_gap_ns = gap;
+            state.gap_dev_ns = gap / 2;
+        } else {
+            int64_t error = gap - state.mean_gap_ns;
+            state.mean_gap_ns += error / 8;
+            state.gap_dev_ns += (std::abs(error) - state.gap_dev_ns) / 4;
+        }
+    }
+    state.last_ns = now;
+    ++state.updates;
+}
+
+void FeedMonitor::addSample(RttStats& stats, double us) {
+    if (stats.samples == 0) {
+        stats.smoothed_us = stats.min_us = stats.max_us = us;
+    } else {
+        stats.smoothed_us += (us - stats.smoothed_us) / 8.0;
+        stats.min_us = std::min(stats.min_us, us);
+        stats.max_us = std::max(stats.max_us, us);
+    }
+    stats.last_us = us;
+    ++stats.samples;
+}
+
+void FeedMonitor::onPong(std::chrono::nanoseconds rtt) {
+    last_pong_ns_.store(nowNs());
+    oldest_unanswered_ns_.store(0);
+    ping_seconds_.observe(rtt.count() / 1e9);
+    std::lock_guard<std::mutex> lock(mutex_);
+    addSample(ping_rtt_, rtt.count() / 1e3);
+}
+
+void FeedMonitor::onHeartbeatRtt(std::chrono::nanoseconds rtt) {
+    heartbeat_seconds_.observe(rtt.count() / 1e9);
+    std::lock_guard<std::mutex> lock(mutex_);
+    addSample(heartbeat_rtt_, rtt.count() / 1e3);
+}
+
+void FeedMonitor::setPinger(std::function<void()> pinger) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pinger_ = std::move(pinger);
+}
+
+void FeedMonitor::setEventHandler(std::function<void(const FeedEvent&)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    event_handler_ = std::move(handler);
+}
+
+int64_t FeedMonitor::thresholdNs(const Channel& state) const {
+    int64_t expected = state.fixed_ns;
+    if (expected == 0) {
+        if (state.event_driven || state.updates <= kLearnAfter) return 0;
+        expected = std::max(state.floor_ns, state.mean_gap_ns + 4 * state.gap_dev_ns);
+    }
+    int64_t floor = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.min_silence).count();
+    return std::max(floor, static_cast<int64_t>(config_.stall_factor * expected));
+}
+
+void FeedMonitor::run() {
+    const int64_t ping_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.ping_interval).count();
+    std::vector<FeedEvent> events;
+    std::unique_lock<std::mutex> run_lock(run_mutex_);
+    while (running_) {
+        run_cv_.wait_for(run_lock, config_.check_interval, [this]() { return !running_; });
+        if (!running_) break;
+        run_lock.unlock();
+
+        int64_t now = nowNs();
+        std::function<void()> pinger;
+        std::function<void(const FeedEvent&)> handler;
+        bool watching = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pinger = pinger_;
+            handler = event_handler_;
+            watching = !channels_.empty();
+        }
+        if (watching && pinger && ping_ns > 0 && now >= next_ping_ns_) {
+            next_ping_ns_ = now + ping_ns;
+            int64_t none = 0;
+            oldest_unanswered_ns_.compare_exchange_strong(none, now);
+            try {
+                pinger();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error sending ping: " << e.what() << std::endl;
+            }
+        }
+
+        events.clear();
+        check(now, events);
+        for (const auto& event : events) {
+            if (!handler) break;
+            try {
+                handler(event);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error in feed event handler: " << e.what() << std::endl;
+            }
+        }
+        run_lock.lock();
+    }
+}
+
+void FeedMonitor::check(int64_t now, std::vector<FeedEvent>& events) {
+    using std::chrono::microseconds;
+    using std::chrono::nanoseconds;
+    auto us = [](int64_t ns) { return std::chrono::duration_cast<microseconds>(nanoseconds(ns)); };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : channels_) {
+        Channel& state = entry.second;
+        if (state.updates == 0) continue;
+        int64_t threshold = thresholdNs(state);
+        int64_t silence = now - state.last_ns;
+        if (!state.stalled && threshold > 0 && silence > threshold) {
+            state.stalled = true;
+            state.stalled_since_ns = state.last_ns;
+            ++state.stalls;
+            ++stalled_channels_;
+            stalled_gauge_.add(1);
+            channel_stalls_.inc();
+            events.push_back(FeedEvent{FeedEvent::Kind::ChannelStalled, entry.first, us(silence), us(threshold)});
+        } else if (state.stalled && state.last_ns > state.stalled_since_ns) {
+            state.stalled = false;
+            --stalled_channels_;
+            stalled_gauge_.add(-1);
+            events.push_back(FeedEvent{FeedEvent::Kind::ChannelResumed, entry.first,
+                                       us(state.last_ns - state.stalled_since_ns), us(threshold)});
+        }
+    }
+
+    int64_t timeout = std::chrono::duration_cast<nanoseconds>(config_.pong_timeout).count();
+    int64_t oldest = oldest_unanswered_ns_.load();
+    bool stalled = connection_stalled_.load();
+    if (!stalled && oldest != 0 && now - oldest > timeout) {
+        connection_stalled_since_ns_ = oldest;
+        connection_stalled_.store(true, std::memory_order_release);
+        connection_stalls_.inc();
+        events.push_back(FeedEvent{FeedEvent::Kind::ConnectionStalled, std::string(), us(now - oldest), us(timeout)});
+    } else if (stalled && (oldest == 0 || oldest > connection_stalled_since_ns_)) {
+        connection_stalled_.store(false, std::memory_order_release);
+        int64_t answered = std::max(last_pong_ns_.load(), connection_stalled_since_ns_);
+        events.push_back(FeedEvent{FeedEvent::Kind::ConnectionResumed, std::string(),
+                                   us(answered - connection_stalled_since_ns_), us(timeout)});
+    }
+}
+
+bool FeedMonitor::stalled(const std::string& channel) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channel);
+    return it != channels_.end() && it->second.stalled;
+}
+
+bool FeedMonitor::anyStalled() const {
+    return connectionStalled() || stalled_channels_.load() > 0;
+}
+
+std::vector<ChannelHealth> FeedMonitor::channels() const {
+    int64_t now = nowNs();
+    std::vector<ChannelHealth> health;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : channels_) {
+        const Channel& state = entry.second;
+        ChannelHealth h;
+        h.channel = entry.first;
+        h.updates = state.updates;
+        h.stalls = state.stalls;
+        h.stalled = state.stalled;
+        h.expected_ms = (state.fixed_ns ? state.fixed_ns : std::max(state.floor_ns, state.mean_gap_ns)) / 1e6;
+        h.threshold_ms = thresholdNs(state) / 1e6;
+        h.silence_ms = state.updates ? (now - state.last_ns) / 1e6 : 0.0;
+        health.push_back(h);
+    }
+    std::sort(health.begin(), health.end(),
+              [](const ChannelHealth& a, const ChannelHealth& b) { return a.channel < b.channel; });
+    return health;
+}
+
+RttStats FeedMonitor::pingRtt() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ping_rtt_;
+}
+
+RttStats FeedMonitor::heartbeatRtt() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return heartbeat_rtt_;
+}
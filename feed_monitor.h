@@ -0,0 +1,160 @@
+#ifndef FEED_MONITOR_H
+#define FEED_MONITOR_H
+
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct FeedMonitorConfig {
+    std::chrono::milliseconds ping_interval{250};    // WebSocket ping cadence, 0 = no pings
+    std::chrono::milliseconds pong_timeout{500};     // an unanswered ping this old stalls the connection
+    std::chrono::milliseconds check_interval{1};     // watchdog resolution, so detection lags by at most this
+    std::chrono::milliseconds min_silence{50};       // no channel stalls sooner than this
+    double stall_factor = 3.0;                       // silence allowed, in expected intervals
+    int heartbeat_seconds = 10;                      // public/set_heartbeat; Deribit's minimum is 10, 0 = off
+    // Expected update interval per channel where the name does not say;
+    // anything else learns it from the gaps it sees
+    std::unordered_map<std::string, std::chrono::milliseconds> expected;
+
+    // "on", or comma separated ping=MS, pong_timeout=MS, check=MS,
+    // min_silence=MS, factor=X, heartbeat=S, channel=NAME:MS (repeatable).
+    // Throws std::invalid_argument on a malformed spec.
+    static FeedMonitorConfig parse(const std::string& spec);
+};
+
+struct FeedEvent {
+    enum class Kind { ChannelStalled, ChannelResumed, ConnectionStalled, ConnectionResumed };
+    Kind kind;
+    std::string channel;                        // empty for connection events
+    std::chrono::microseconds silence;          // how long nothing had arrived
+    std::chrono::microseconds threshold;        // what counted as too long
+};
+
+const char* feedEventName(FeedEvent::Kind kind);
+
+struct ChannelHealth {
+    std::string channel;
+    uint64_t updates = 0;
+    uint64_t stalls = 0;
+    bool stalled = false;
+    double expected_ms = 0.0;       // fixed, or the learned mean gap (at least the floor)
+    double threshold_ms = 0.0;      // 0 until the threshold is known
+    double silence_ms = 0.0;        // since the last update, 0 before the first
+};
+
+struct RttStats {
+    uint64_t samples = 0;
+    double last_us = 0.0;
+    double smoothed_us = 0.0;       // EWMA with weight 1/8, as TCP's SRTT
+    double min_us = 0.0;
+    double max_us = 0.0;
+};
+
+// Watches a market data connection for going quiet. Each subscribed channel
+// stalls once nothing has arrived for stall_factor expected intervals (never
+// less than min_silence). Ticker channels named with an interval (".100ms")
+// expect one update per interval; the config can set any channel's interval.
+// Book channels only publish when the book changes, so they and unnamed
+// ticker channels learn it like a TCP retransmit timeout, mean gap plus four
+// mean deviations, after 8 updates; a book's named interval is a floor under
+// what it learns.
+// Trades and user channels only speak when something happens, so they never
+// stall unless configured. The connection stalls when a WebSocket ping goes
+// unanswered for pong_timeout, which catches a half-open socket even when
+// every channel is quiet.
+// A watchdog thread checks every check_interval and hands FeedEvents to the
+// event handler on that thread, once per transition, so a strategy can pull
+// its quotes on a stall and resume when data flows again.
+//
+// Pings are only sent, and the connection only judged, while some channel is
+// watched: without a subscription nobody may be reading the socket, and pongs
+// are only seen by a read. onUpdate is the hot path, one uncontended lock and
+// a hash lookup.
+class FeedMonitor {
+public:
+    explicit FeedMonitor(FeedMonitorConfig config = {});
+    ~FeedMonitor();
+
+    void start();
+    void stop();
+    const FeedMonitorConfig& config() const { return config_; }
+
+    void watch(const std::string& channel);
+    void unwatch(const std::string& channel);
+    void unwatchAll();
+
+    // A notification on channel arrived now; unwatched channels are ignored
+    void onUpdate(const std::string& channel);
+    // Round trips: a WebSocket pong, or a public/test answering a heartbeat
+    void onPong(std::chrono::nanoseconds rtt);
+    void onHeartbeatRtt(std::chrono::nanoseconds rtt);
+
+    // Called from the watchdog thread every ping_interval; should send a ping
+    // whose pong ends up in onPong
+    void setPinger(std::function<void()> pinger);
+    void setEventHandler(std::function<void(const FeedEvent&)> handler);
+
+    bool connectionStalled() const { return connection_stalled_.load(std::memory_order_acquire); }
+    bool stalled(const std::string& channel) const;
+    // Any watched channel or the connection
+    bool anyStalled() const;
+    std::vector<ChannelHealth> channels() const;
+    RttStats pingRtt() const;
+    RttStats heartbeatRtt() const;
+
+private:
+    struct Channel {
+        int64_t fixed_ns = 0;       // expected interval known up front
+        int64_t floor_ns = 0;       // book channels: the named interval, at least
+        bool event_driven = false;  // trades and user channels: no stalls unless fixed_ns is set
+        int64_t last_ns = 0;
+        int64_t mean_gap_ns = 0;    // learned
+        int64_t gap_dev_ns = 0;
+        uint64_t updates = 0;
+        bool stalled = false;
+        int64_t stalled_since_ns = 0;
+        uint64_t stalls = 0;
+    };
+
+    void run();
+    void check(int64_t now, std::vector<FeedEvent>& events);
+    int64_t thresholdNs(const Channel& channel) const;
+    static void addSample(RttStats& stats, double us);
+
+    FeedMonitorConfig config_;
+    mutable std::mutex mutex_;                  // channel table, handlers and RTT stats
+    std::unordered_map<std::string, Channel> channels_;
+    std::function<void()> pinger_;
+    std::function<void(const FeedEvent&)> event_handler_;
+    RttStats ping_rtt_;
+    RttStats heartbeat_rtt_;
+
+    std::atomic<int64_t> oldest_unanswered_ns_{0};  // first ping sent since the last pong
+    std::atomic<int64_t> last_pong_ns_{0};
+    std::atomic<bool> connection_stalled_{false};
+    std::atomic<int> stalled_channels_{0};
+    // Watchdog thread only
+    int64_t next_ping_ns_ = 0;
+    int64_t connection_stalled_since_ns_ = 0;
+
+    std::mutex run_mutex_;
+    std::condition_variable run_cv_;
+    bool running_ = false;
+    std::thread watchdog_;
+
+    LatencyHistogram& ping_seconds_;
+    LatencyHistogram& heartbeat_seconds_;
+    Counter& channel_stalls_;
+    Counter& connection_stalls_;
+    Gauge& stalled_gauge_;
+};
+
+#endif // FEED_MONITOR_H
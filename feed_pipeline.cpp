@@ -0,0 +1,284 @@
+#include "feed_pipeline.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Value of the JSON string starting at begin, up to the closing quote
+std::string_view quoted(std::string_view frame, std::size_t begin) {
+    std::size_t end = frame.find('"', begin);
+    if (end == std::string_view::npos) return std::string_view();
+    return frame.substr(begin, end - begin);
+}
+
+} // namespace
+
+FeedPipelineConfig FeedPipelineConfig::parse(const std::string& spec) {
+    FeedPipelineConfig config;
+
+    auto number = [&spec](const std::string& value, long low, long high) {
+        std::size_t used = 0;
+        long parsed = 0;
+        try {
+            parsed = std::stol(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != value.size() || parsed < low || parsed > high) {
+            throw std::invalid_argument("Bad pipeline setting in '" + spec + "'");
+        }
+        return parsed;
+    };
+
+    if (spec.find('=') == std::string::npos) {
+        config.workers = static_cast<int>(number(spec, 1, 64));
+        return config;
+    }
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : item.substr(equals + 1);
+        if (key == "workers") {
+            config.workers = static_cast<int>(number(value, 1, 64));
+        } else if (key == "queue") {
+            config.queue_frames = static_cast<std::size_t>(number(value, 2, 1 << 20));
+        } else if (key == "spin") {
+            config.spin = static_cast<int>(number(value, 0, 1000000000));
+        } else if (key == "stall") {
+            config.stall_us = static_cast<int>(number(value, 0, 1000000));
+        } else {
+            throw std::invalid_argument("Unknown pipeline setting '" + item + "'");
+        }
+    }
+    return config;
+}
+
+uint64_t FeedPipelineStats::total() const {
+    uint64_t sum = 0;
+    for (uint64_t n : frames) sum += n;
+    return sum;
+}
+
+void FeedPipelineStats::print(std::ostream& out) const {
+    out << "Pipeline: " << total() << " frames over " << frames.size() << " workers (";
+    for (std::size_t i = 0; i < frames.size(); ++i) out << (i ? "/" : "") << frames[i];
+    out << "), " << parse_errors << " parse errors\n"
+        << std::fixed << std::setprecision(1)
+        << "  per frame: queued " << queue_us << " us, parse " << parse_us << " us, apply " << apply_us << " us\n"
+        << "  reader waited for room " << stalls << " times, " << stall_seconds * 1e3 << " ms in all; "
+        << dropped << " frames dropped\n";
+    out.unsetf(std::ios::fixed);
+}
+
+FeedPipeline::FeedPipeline(FeedPipelineConfig config, Handler handler, DropHandler on_drop)
+    : config_(config),
+      handler_(std::move(handler)),
+      on_drop_(std::move(on_drop)),
+      queue_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_pipeline_stage_seconds", "Time per frame in each feed pipeline stage", "stage=\"queue\"")),
+      parse_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_pipeline_stage_seconds", "Time per frame in each feed pipeline stage", "stage=\"parse\"")),
+      apply_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_pipeline_stage_seconds", "Time per frame in each feed pipeline stage", "stage=\"apply\"")),
+      parse_errors_(MetricsRegistry::instance().counter(
+          "deribit_pipeline_parse_errors_total", "Frames the feed pipeline could not parse")),
+      stalls_total_(MetricsRegistry::instance().counter(
+          "deribit_pipeline_stalls_total", "Frames the reader held back because their worker's ring was full")),
+      stall_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_pipeline_stall_seconds", "Reader wait for room in a full ring")),
+      drops_total_(MetricsRegistry::instance().counter(
+          "deribit_pipeline_dropped_frames_total", "Frames dropped because their worker's ring stayed full")) {
+    if (config_.workers < 1) throw std::invalid_argument("Feed pipeline needs at least one worker");
+    for (int i = 0; i < config_.workers; ++i) {
+        auto worker = std::make_unique<Worker>(config_.queue_frames);
+        worker->frames_total = &MetricsRegistry::instance().counter(
+            "deribit_pipeline_frames_total", "Frames handled per feed pipeline worker",
+            "worker=\"" + std::to_string(i) + "\"");
+        workers_.push_back(std::move(worker));
+    }
+}
+
+FeedPipeline::~FeedPipeline() {
+    stop();
+}
+
+void FeedPipeline::start() {
+    if (started_) return;
+    started_ = true;
+    stopping_.store(false);
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&FeedPipeline::run, this, std::ref(*worker));
+    }
+}
+
+void FeedPipeline::stop() {
+    if (!started_) return;
+    stopping_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) {
+        wakeUp(*worker);
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    started_ = false;
+}
+
+std::string_view FeedPipeline::partitionKey(std::string_view frame) {
+    static constexpr std::string_view kChannel = "\"channel\":\"";
+    static constexpr std::string_view kInstrument = "\"instrument_name\":\"";
+
+    // Deribit puts params.channel within the first hundred bytes of a notification
+    std::size_t at = frame.substr(0, 128).find(kChannel);
+    if (at != std::string_view::npos) {
+        std::string_view channel = quoted(frame, at + kChannel.size());
+        std::size_t first = channel.find('.');
+        if (first == std::string_view::npos) return channel;
+        std::size_t second = channel.find('.', first + 1);
+        return channel.substr(first + 1, second == std::string_view::npos ? second : second - first - 1);
+    }
+    at = frame.find(kInstrument);
+    if (at != std::string_view::npos) return quoted(frame, at + kInstrument.size());
+    return std::string_view();
+}
+
+std::size_t FeedPipeline::workerFor(std::string_view frame) const {
+    std::string_view key = partitionKey(frame);
+    if (key.empty()) return 0;
+    return std::hash<std::string_view>{}(key) % workers_.size();
+}
+
+void FeedPipeline::push(const char* data, std::size_t size) {
+    Worker& worker = *workers_[workerFor(std::string_view(data, size))];
+    Frame frame;
+    worker.spares.try_pop(frame.bytes);
+    frame.bytes.assign(data, size);
+    frame.read_ns = nowNs();
+
+    if (!worker.frames.try_push(std::move(frame))) {
+        // A worker already found behind gets no second wait until it catches up
+        bool queued = false;
+        if (!worker.overflowing) {
+            int64_t stall_start = nowNs();
+            int64_t give_up = stall_start + int64_t{config_.stall_us} * 1000;
+            int64_t now = stall_start;
+            do {
+                wakeUp(worker);
+                std::this_thread::yield();
+                queued = worker.frames.try_push(std::move(frame));
+                now = nowNs();
+            } while (!queued && now < give_up);
+            stalls_.fetch_add(1, std::memory_order_relaxed);
+            stall_ns_.fetch_add(now - stall_start, std::memory_order_relaxed);
+            stalls_total_.inc();
+            stall_seconds_.observe((now - stall_start) / 1e9);
+        }
+        if (!queued) {
+            worker.overflowing = true;
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            drops_total_.inc();
+            wakeUp(worker);
+            if (on_drop_) on_drop_(data, size);
+            return;
+        }
+    }
+    worker.overflowing = false;
+    // Pairs with the fence in run: either the worker sees the frame before it
+    // sleeps, or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker.sleeping.load(std::memory_order_relaxed)) wakeUp(worker);
+}
+
+void FeedPipeline::wakeUp(Worker& worker) {
+    worker.wake.fetch_add(1, std::memory_order_release);
+    worker.wake.notify_one();
+}
+
+void FeedPipeline::run(Worker& worker) {
+    Frame frame;
+    int idle = 0;
+    for (;;) {
+        if (worker.frames.try_pop(frame)) {
+            idle = 0;
+            handle(worker, frame);
+            frame.bytes.clear();
+            // A full spares ring just means this buffer is freed instead
+            worker.spares.try_push(std::move(frame.bytes));
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            if (worker.frames.empty()) break;
+            continue;
+        }
+        if (++idle < config_.spin) continue;
+
+        uint32_t seen = worker.wake.load(std::memory_order_acquire);
+        worker.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker.frames.empty() && !stopping_.load(std::memory_order_acquire)) {
+            worker.wake.wait(seen, std::memory_order_acquire);
+        }
+        worker.sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void FeedPipeline::handle(Worker& worker, Frame& frame) {
+    int64_t picked = nowNs();
+    int64_t parsed = 0;
+    {
+        ArenaScope scope(worker.arena);
+        try {
+            arena_json message = arena_json::parse(frame.bytes.data(), frame.bytes.data() + frame.bytes.size());
+            parsed = nowNs();
+            handler_(message);
+        }
+        catch (const std::exception& e) {
+            if (parsed == 0) {
+                parsed = nowNs();
+                worker.errors.fetch_add(1, std::memory_order_relaxed);
+                parse_errors_.inc();
+            }
+            std::cerr << "Error handling message: " << e.what() << std::endl;
+        }
+    }
+    int64_t applied = nowNs();
+
+    worker.handled.fetch_add(1, std::memory_order_relaxed);
+    worker.queue_ns.fetch_add(picked - frame.read_ns, std::memory_order_relaxed);
+    worker.parse_ns.fetch_add(parsed - picked, std::memory_order_relaxed);
+    worker.apply_ns.fetch_add(applied - parsed, std::memory_order_relaxed);
+    worker.frames_total->inc();
+    queue_seconds_.observe((picked - frame.read_ns) / 1e9);
+    parse_seconds_.observe((parsed - picked) / 1e9);
+    apply_seconds_.observe((applied - parsed) / 1e9);
+}
+
+FeedPipelineStats FeedPipeline::stats() const {
+    FeedPipelineStats stats;
+    int64_t queue_ns = 0, parse_ns = 0, apply_ns = 0;
+    for (const auto& worker : workers_) {
+        stats.frames.push_back(worker->handled.load(std::memory_order_relaxed));
+        stats.parse_errors += worker->errors.load(std::memory_order_relaxed);
+        queue_ns += worker->queue_ns.load(std::memory_order_relaxed);
+        parse_ns += worker->parse_ns.load(std::memory_order_relaxed);
+        apply_ns += worker->apply_ns.load(std::memory_order_relaxed);
+    }
+    stats.stalls = stalls_.load(std::memory_order_relaxed);
+    stats.stall_seconds = stall_ns_.load(std::memory_order_relaxed) / 1e9;
+    stats.dropped = drops_.load(std::memory_order_relaxed);
+    uint64_t total = stats.total();
+    if (total > 0) {
+        stats.queue_us = queue_ns / 1e3 / total;
+        stats.parse_us = parse_ns / 1e3 / total;
+        stats.apply_us = apply_ns / 1e3 / total;
+    }
+    return stats;
+}
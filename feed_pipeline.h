@@ -0,0 +1,132 @@
+#ifndef FEED_PIPELINE_H
+#define FEED_PIPELINE_H
+
+#include "message_arena.h"
+#include "metrics.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct FeedPipelineConfig {
+    int workers = 2;
+    std::size_t queue_frames = 4096;    // per worker; a full ring stalls the reader
+    int spin = 1000;                    // empty polls before a worker sleeps
+    int stall_us = 1000;                // longest wait for room before frames are dropped
+
+    // "N" workers, or comma separated workers=N, queue=N, spin=N, stall=US.
+    // Throws std::invalid_argument on a malformed spec.
+    static FeedPipelineConfig parse(const std::string& spec);
+};
+
+struct FeedPipelineStats {
+    std::vector<uint64_t> frames;       // per worker
+    uint64_t parse_errors = 0;
+    uint64_t stalls = 0;                // pushes that found their ring full
+    double stall_seconds = 0.0;         // reader time spent waiting for room
+    uint64_t dropped = 0;               // frames given to the drop handler instead
+    double queue_us = 0.0;              // mean per frame: read to picked up
+    double parse_us = 0.0;
+    double apply_us = 0.0;
+
+    uint64_t total() const;
+    void print(std::ostream& out) const;
+};
+
+// Spreads parsing and applying of market data frames over worker threads.
+// The thread reading the socket only copies each frame into the ring of the
+// worker that owns its instrument; the worker parses it into its own arena
+// and hands it to the handler. One instrument always maps to one worker, so
+// its messages are handled in arrival order while other instruments proceed
+// in parallel. When a ring is full push waits up to stall_us for room. The
+// reader is normally the io_context thread, which also writes heartbeat
+// answers and pings, so it cannot wait for long: a worker still behind after
+// that has its frames dropped, without waiting again, until its ring takes
+// one. Each dropped frame goes to the drop handler on the reader's thread,
+// which can e.g. resnapshot the book whose change_id chain just broke.
+//
+// Frame buffers go back to the reader through a second ring, so in steady
+// state neither side allocates. Idle workers spin briefly, then sleep until
+// the reader wakes them.
+class FeedPipeline {
+public:
+    using Handler = std::function<void(const arena_json&)>;
+    using DropHandler = std::function<void(const char*, std::size_t)>;
+
+    // handler runs on every worker thread at once; see
+    // TradeExecution::handleSubscriptionMessage and handleDroppedFrame
+    FeedPipeline(FeedPipelineConfig config, Handler handler, DropHandler on_drop = nullptr);
+    ~FeedPipeline();
+
+    void start();
+    // Handle everything already queued, then join the workers
+    void stop();
+
+    // One thread only, normally the one reading the socket
+    void push(const char* data, std::size_t size);
+
+    // The instrument a frame is about, found without parsing it: the second
+    // part of a notification's channel ("book.BTC-PERPETUAL.100ms"), or else
+    // the first instrument_name in the frame, as in a get_order_book reply.
+    // Empty for anything else, which goes to worker 0.
+    static std::string_view partitionKey(std::string_view frame);
+    std::size_t workerFor(std::string_view frame) const;
+
+    FeedPipelineStats stats() const;
+
+private:
+    struct Frame {
+        std::string bytes;
+        int64_t read_ns = 0;
+    };
+
+    struct Worker {
+        explicit Worker(std::size_t capacity) : frames(capacity), spares(capacity) {}
+
+        SpscQueue<Frame> frames;            // reader -> worker
+        SpscQueue<std::string> spares;      // worker -> reader, buffers to reuse
+        MessageArena arena;
+        std::thread thread;
+        alignas(64) std::atomic<uint32_t> wake{0};
+        std::atomic<bool> sleeping{false};
+        // Written by the worker only
+        std::atomic<uint64_t> handled{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<int64_t> queue_ns{0};
+        std::atomic<int64_t> parse_ns{0};
+        std::atomic<int64_t> apply_ns{0};
+        Counter* frames_total = nullptr;
+        bool overflowing = false;           // reader only: dropping until a push fits
+    };
+
+    void run(Worker& worker);
+    void handle(Worker& worker, Frame& frame);
+    static void wakeUp(Worker& worker);
+
+    FeedPipelineConfig config_;
+    Handler handler_;
+    DropHandler on_drop_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stopping_{false};
+    bool started_ = false;
+    // Written by the reader only
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<int64_t> stall_ns_{0};
+    std::atomic<uint64_t> drops_{0};
+
+    LatencyHistogram& queue_seconds_;
+    LatencyHistogram& parse_seconds_;
+    LatencyHistogram& apply_seconds_;
+    Counter& parse_errors_;
+    Counter& stalls_total_;
+    LatencyHistogram& stall_seconds_;
+    Counter& drops_total_;
+};
+
+#endif // FEED_PIPELINE_H
@@ -0,0 +1,199 @@
+#include "fix_acceptor_stub.h"
+#include "fix_codec.h"
+#include "fix_session.h"
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+int64_t unixMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+FixAcceptorStub::FixAcceptorStub(uint16_t port, const std::string& client_secret)
+    : port_(port), client_secret_(client_secret) {}
+
+FixAcceptorStub::~FixAcceptorStub() {
+    stop();
+}
+
+bool FixAcceptorStub::start() {
+    try {
+        tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), port_);
+        acceptor_.reset(new tcp::acceptor(ioc_, endpoint));
+        port_ = acceptor_->local_endpoint().port();
+        accept();
+        thread_ = std::thread([this]() { ioc_.run(); });
+        std::cout << "FIX acceptor stub listening on 127.0.0.1:" << port_ << std::endl;
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error starting FIX acceptor stub: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void FixAcceptorStub::stop() {
+    ioc_.stop();
+    // serve() blocks in a read; shutting the socket down releases it
+    {
+        std::lock_guard<std::mutex> lock(active_mutex_);
+        stopping_ = true;
+        if (active_) {
+            boost::system::error_code ignored;
+            active_->shutdown(tcp::socket::shutdown_both, ignored);
+        }
+    }
+    if (thread_.joinable()) thread_.join();
+    acceptor_.reset();
+}
+
+void FixAcceptorStub::accept() {
+    acceptor_->async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            tcp::socket* session = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(active_mutex_);
+                if (!stopping_) {
+                    active_.reset(new tcp::socket(std::move(socket)));
+                    session = active_.get();
+                }
+            }
+            if (session) serve(*session);
+            std::lock_guard<std::mutex> lock(active_mutex_);
+            if (active_) {
+                boost::system::error_code ignored;
+                active_->shutdown(tcp::socket::shutdown_both, ignored);
+                active_->close(ignored);
+                active_.reset();
+            }
+        }
+        if (acceptor_ && acceptor_->is_open() && !ioc_.stopped()) accept();
+    });
+}
+
+void FixAcceptorStub::serve(tcp::socket& socket) {
+    std::array<char, 64 * 1024> buffer;
+    std::size_t size = 0;
+    uint64_t out_seq = 1;
+    std::string sender, target;
+    FixEncoder encoder;
+    FixMessage message;
+    bool logged_on = false;
+
+    auto reply = [&](std::string_view msg_type, auto&& body) {
+        encoder.begin(msg_type, sender, target, out_seq++, unixMillis());
+        body(encoder);
+        std::string_view frame = encoder.finish();
+        boost::system::error_code ignored;
+        boost::asio::write(socket, boost::asio::buffer(frame.data(), frame.size()), ignored);
+    };
+    auto execution = [&](const std::string& order_id, const RestingOrder& order, std::string_view cl_ord_id,
+                         std::string_view orig_cl_ord_id, char exec_type, char ord_status) {
+        reply(fix::kExecutionReport, [&](FixEncoder& e) {
+            e.field(fix::kOrderID, order_id).field(fix::kClOrdID, cl_ord_id);
+            if (!orig_cl_ord_id.empty()) e.field(fix::kOrigClOrdID, orig_cl_ord_id);
+            e.field(fix::kExecType, exec_type)
+             .field(fix::kOrdStatus, ord_status)
+             .field(fix::kSymbol, order.symbol)
+             .field(fix::kSide, order.side)
+             .field(fix::kOrderQty, order.qty)
+             .field(fix::kPrice, order.price)
+             .field(fix::kCumQty, 0.0)
+             .field(fix::kLeavesQty, ord_status == '4' ? 0.0 : order.qty)
+             .field(fix::kAvgPx, 0.0);
+        });
+    };
+
+    while (true) {
+        boost::system::error_code ec;
+        std::size_t n = socket.read_some(boost::asio::buffer(buffer.data() + size, buffer.size() - size), ec);
+        if (ec) break;
+        size += n;
+
+        std::size_t offset = 0;
+        bool close = false;
+        while (!close) {
+            std::ptrdiff_t length = FixMessage::frameLength(buffer.data() + offset, size - offset);
+            if (length == 0) break;
+            if (length < 0 || !message.parse(buffer.data() + offset, static_cast<std::size_t>(length))) {
+                close = true;
+                break;
+            }
+            offset += static_cast<std::size_t>(length);
+
+            std::string_view type = message.msgType();
+            if (type == fix::kLogon) {
+                // Answer with the comp ids swapped
+                target = std::string(message.get(fix::kSenderCompID));
+                sender = std::string(message.get(fix::kTargetCompID));
+                std::string raw_data(message.get(fix::kRawData));
+                if (!client_secret_.empty()
+                    && fixLogonPassword(raw_data, client_secret_) != message.get(fix::kPassword)) {
+                    reply(fix::kLogout, [](FixEncoder& e) { e.field(fix::kText, "invalid credentials"); });
+                    close = true;
+                    break;
+                }
+                std::string heartbeat(message.get(fix::kHeartBtInt));
+                reply(fix::kLogon, [&](FixEncoder& e) {
+                    e.field(fix::kHeartBtInt, heartbeat).field(fix::kResetSeqNumFlag, 'Y');
+                });
+                logged_on = true;
+            } else if (!logged_on) {
+                close = true;
+            } else if (type == fix::kTestRequest) {
+                std::string_view id = message.get(fix::kTestReqID);
+                reply(fix::kHeartbeat, [id](FixEncoder& e) { e.field(fix::kTestReqID, id); });
+            } else if (type == fix::kLogout) {
+                reply(fix::kLogout, [](FixEncoder&) {});
+                close = true;
+            } else if (type == fix::kNewOrderSingle) {
+                RestingOrder order;
+                order.symbol = std::string(message.get(fix::kSymbol));
+                std::string_view side = message.get(fix::kSide);
+                order.side = side.empty() ? '1' : side[0];
+                order.qty = 0.0;
+                order.price = 0.0;
+                message.getDouble(fix::kOrderQty, order.qty);
+                message.getDouble(fix::kPrice, order.price);
+                std::string order_id = "STUB-" + std::to_string(next_order_id_++);
+                orders_[order_id] = order;
+                execution(order_id, order, message.get(fix::kClOrdID), "", '0', '0');
+            } else if (type == fix::kOrderCancelRequest || type == fix::kOrderCancelReplaceRequest) {
+                std::string order_id(message.get(fix::kOrigClOrdID));
+                auto it = orders_.find(order_id);
+                if (it == orders_.end()) {
+                    std::string_view cl_ord_id = message.get(fix::kClOrdID);
+                    char response_to = type == fix::kOrderCancelRequest ? '1' : '2';
+                    reply(fix::kOrderCancelReject, [&](FixEncoder& e) {
+                        e.field(fix::kOrderID, order_id)
+                         .field(fix::kClOrdID, cl_ord_id)
+                         .field(fix::kOrigClOrdID, order_id)
+                         .field(fix::kOrdStatus, '8')
+                         .field(fix::kCxlRejResponseTo, response_to)
+                         .field(fix::kCxlRejReason, '1')
+                         .field(fix::kText, "unknown order");
+                    });
+                } else if (type == fix::kOrderCancelRequest) {
+                    execution(order_id, it->second, message.get(fix::kClOrdID), order_id, '4', '4');
+                    orders_.erase(it);
+                } else {
+                    message.getDouble(fix::kOrderQty, it->second.qty);
+                    message.getDouble(fix::kPrice, it->second.price);
+                    execution(order_id, it->second, message.get(fix::kClOrdID), order_id, '5', '0');
+                }
+            }
+        }
+        if (close) break;
+        std::memmove(buffer.data(), buffer.data() + offset, size - offset);
+        size -= offset;
+    }
+    // accept() closes the socket under the mutex stop() shuts it down with
+}
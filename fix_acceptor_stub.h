@@ -0,0 +1,52 @@
+#ifndef FIX_ACCEPTOR_STUB_H
+#define FIX_ACCEPTOR_STUB_H
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Local stand-in for the Deribit FIX acceptor, for exercising FixSession and
+// measuring the transport without an exchange. Accepts one session at a time,
+// checks the Logon signature when a secret is configured, answers heartbeats
+// and test requests, and acknowledges orders: NewOrderSingle rests as New,
+// OrderCancelRequest cancels, OrderCancelReplaceRequest replaces, and unknown
+// order ids get an OrderCancelReject. Nothing ever fills.
+class FixAcceptorStub {
+public:
+    explicit FixAcceptorStub(uint16_t port, const std::string& client_secret = "");
+    ~FixAcceptorStub();
+
+    bool start();
+    void stop();
+    uint16_t port() const { return port_; }
+
+private:
+    struct RestingOrder {
+        std::string symbol;
+        char side;
+        double qty;
+        double price;
+    };
+
+    void accept();
+    void serve(boost::asio::ip::tcp::socket& socket);
+
+    uint16_t port_;
+    std::string client_secret_;
+    boost::asio::io_context ioc_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    // The session being served; stop() shuts it down to release serve()'s
+    // read, so it only goes away under the mutex
+    std::mutex active_mutex_;
+    std::unique_ptr<boost::asio::ip::tcp::socket> active_;
+    bool stopping_ = false;
+    std::thread thread_;
+    std::map<std::string, RestingOrder> orders_;
+    uint64_t next_order_id_ = 1;
+};
+
+#endif // FIX_ACCEPTOR_STUB_H
@@ -0,0 +1,224 @@
+#include "fix_codec.h"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr char kBeginString[] = "8=FIX.4.4\x01";
+constexpr std::size_t kBeginStringSize = sizeof(kBeginString) - 1;
+
+// Days since 1970-01-01 to a civil date (proleptic Gregorian)
+void civilFromDays(int64_t days, int& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yoe + era * 400 + (month <= 2));
+}
+
+void writeDigits(char* out, unsigned value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+unsigned checksum(const char* data, std::size_t size) {
+    unsigned sum = 0;
+    for (std::size_t i = 0; i < size; ++i) sum += static_cast<unsigned char>(data[i]);
+    return sum % 256;
+}
+
+} // namespace
+
+std::size_t fix::formatUtcTimestamp(int64_t unix_ms, char* out) {
+    int64_t seconds = unix_ms / 1000;
+    int64_t millis = unix_ms % 1000;
+    int64_t days = seconds / 86400;
+    int64_t rem = seconds % 86400;
+    int year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    writeDigits(out, static_cast<unsigned>(year), 4);
+    writeDigits(out + 4, month, 2);
+    writeDigits(out + 6, day, 2);
+    out[8] = '-';
+    writeDigits(out + 9, static_cast<unsigned>(rem / 3600), 2);
+    out[11] = ':';
+    writeDigits(out + 12, static_cast<unsigned>(rem / 60 % 60), 2);
+    out[14] = ':';
+    writeDigits(out + 15, static_cast<unsigned>(rem % 60), 2);
+    out[17] = '.';
+    writeDigits(out + 18, static_cast<unsigned>(millis), 3);
+    return 21;
+}
+
+void FixEncoder::begin(std::string_view msg_type, std::string_view sender, std::string_view target,
+                       uint64_t seq_num, int64_t sending_time_ms) {
+    pos_ = kPrefixReserve;
+    overflow_ = false;
+    field(fix::kMsgType, msg_type);
+    field(fix::kSenderCompID, sender);
+    field(fix::kTargetCompID, target);
+    field(fix::kMsgSeqNum, static_cast<int64_t>(seq_num));
+    char timestamp[21];
+    field(fix::kSendingTime, std::string_view(timestamp, fix::formatUtcTimestamp(sending_time_ms, timestamp)));
+}
+
+bool FixEncoder::reserve(std::size_t n) {
+    if (overflow_ || pos_ + n > kPrefixReserve + kCapacity) {
+        overflow_ = true;
+        return false;
+    }
+    return true;
+}
+
+FixEncoder& FixEncoder::field(int tag, std::string_view value) {
+    // Tag (at most 5 digits), '=', value, SOH
+    if (!reserve(value.size() + 7)) return *this;
+    pos_ = static_cast<std::size_t>(std::to_chars(buffer_ + pos_, buffer_ + pos_ + 5, tag).ptr - buffer_);
+    buffer_[pos_++] = '=';
+    std::memcpy(buffer_ + pos_, value.data(), value.size());
+    pos_ += value.size();
+    buffer_[pos_++] = fix::kSoh;
+    return *this;
+}
+
+FixEncoder& FixEncoder::field(int tag, int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return field(tag, std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+}
+
+FixEncoder& FixEncoder::field(int tag, double value) {
+    // FIX float fields are plain decimals: the shortest form would write
+    // 100000 as "1e+05". Fixed notation at a bounded precision, with the
+    // trailing zeros (and a bare point) trimmed.
+    char digits[48];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed,
+                                kFloatDecimals);
+    if (result.ec != std::errc()) {
+        overflow_ = true;
+        return *this;
+    }
+    char* end = result.ptr;
+    if (std::memchr(digits, '.', static_cast<std::size_t>(end - digits))) {
+        while (end[-1] == '0') --end;
+        if (end[-1] == '.') --end;
+    }
+    std::string_view text(digits, static_cast<std::size_t>(end - digits));
+    return field(tag, text == "-0" ? std::string_view("0") : text);
+}
+
+FixEncoder& FixEncoder::field(int tag, char value) {
+    return field(tag, std::string_view(&value, 1));
+}
+
+std::string_view FixEncoder::finish() {
+    if (overflow_) return std::string_view();
+
+    // "8=FIX.4.4<SOH>9=<len><SOH>" placed directly in front of the body
+    const std::size_t body_size = pos_ - kPrefixReserve;
+    char length[8];
+    std::size_t length_size = static_cast<std::size_t>(
+        std::to_chars(length, length + sizeof(length), body_size).ptr - length);
+    std::size_t start = kPrefixReserve - (kBeginStringSize + 2 + length_size + 1);
+    char* out = buffer_ + start;
+    std::memcpy(out, kBeginString, kBeginStringSize);
+    out += kBeginStringSize;
+    *out++ = '9';
+    *out++ = '=';
+    std::memcpy(out, length, length_size);
+    out += length_size;
+    *out = fix::kSoh;
+
+    unsigned sum = checksum(buffer_ + start, pos_ - start);
+    char* trailer = buffer_ + pos_;
+    trailer[0] = '1';
+    trailer[1] = '0';
+    trailer[2] = '=';
+    writeDigits(trailer + 3, sum, 3);
+    trailer[6] = fix::kSoh;
+    return std::string_view(buffer_ + start, pos_ + kTrailer - start);
+}
+
+std::ptrdiff_t FixMessage::frameLength(const char* data, std::size_t size) {
+    std::size_t check = size < kBeginStringSize ? size : kBeginStringSize;
+    if (std::memcmp(data, kBeginString, check) != 0) return -1;
+    if (size < kBeginStringSize + 3) return 0;
+    if (data[kBeginStringSize] != '9' || data[kBeginStringSize + 1] != '=') return -1;
+
+    std::size_t body_size = 0;
+    std::size_t i = kBeginStringSize + 2;
+    for (; i < size && data[i] != fix::kSoh; ++i) {
+        if (data[i] < '0' || data[i] > '9' || i > kBeginStringSize + 8) return -1;
+        body_size = body_size * 10 + static_cast<std::size_t>(data[i] - '0');
+    }
+    if (i == size) return 0;
+
+    std::size_t total = i + 1 + body_size + 7;
+    if (size < total) return 0;
+    const char* trailer = data + total - 7;
+    if (std::memcmp(trailer, "10=", 3) != 0 || trailer[6] != fix::kSoh) return -1;
+    return static_cast<std::ptrdiff_t>(total);
+}
+
+bool FixMessage::parse(const char* data, std::size_t size) {
+    count_ = 0;
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        int tag = 0;
+        auto result = std::from_chars(p, end, tag);
+        if (result.ec != std::errc() || result.ptr == end || *result.ptr != '=') return false;
+        const char* value = result.ptr + 1;
+        const char* soh = static_cast<const char*>(std::memchr(value, fix::kSoh, static_cast<std::size_t>(end - value)));
+        if (!soh) return false;
+
+        if (tag == fix::kCheckSum) {
+            int64_t expected = 0;
+            std::from_chars(value, soh, expected);
+            return static_cast<int64_t>(checksum(data, static_cast<std::size_t>(p - data))) == expected;
+        }
+        if (count_ < kMaxFields) {
+            fields_[count_++] = Field{tag, value, static_cast<uint32_t>(soh - value)};
+        }
+        p = soh + 1;
+    }
+    return false;
+}
+
+std::string_view FixMessage::get(int tag) const {
+    for (std::size_t i = 0; i < count_; ++i) {
+        if (fields_[i].tag == tag) return std::string_view(fields_[i].value, fields_[i].length);
+    }
+    return std::string_view();
+}
+
+bool FixMessage::has(int tag) const {
+    for (std::size_t i = 0; i < count_; ++i) {
+        if (fields_[i].tag == tag) return true;
+    }
+    return false;
+}
+
+bool FixMessage::getInt(int tag, int64_t& out) const {
+    std::string_view value = get(tag);
+    if (value.empty()) return false;
+    return std::from_chars(value.data(), value.data() + value.size(), out).ec == std::errc();
+}
+
+bool FixMessage::getDouble(int tag, double& out) const {
+    // Exponents are not valid in FIX float fields, so they are rejected here
+    // rather than accepted from a peer that a venue would refuse
+    std::string_view value = get(tag);
+    if (value.empty()) return false;
+    const char* end = value.data() + value.size();
+    auto result = std::from_chars(value.data(), end, out, std::chars_format::fixed);
+    return result.ec == std::errc() && result.ptr == end;
+}
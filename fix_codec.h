@@ -0,0 +1,135 @@
+#ifndef FIX_CODEC_H
+#define FIX_CODEC_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// FIX 4.4 tag=value encoding for order entry. Both directions work on caller
+// owned buffers: the encoder writes into a fixed array and the decoder keeps
+// views into the received bytes, so neither allocates.
+namespace fix {
+
+constexpr char kSoh = '\x01';
+
+// Message types
+constexpr std::string_view kHeartbeat = "0";
+constexpr std::string_view kTestRequest = "1";
+constexpr std::string_view kResendRequest = "2";
+constexpr std::string_view kReject = "3";
+constexpr std::string_view kSequenceReset = "4";
+constexpr std::string_view kLogout = "5";
+constexpr std::string_view kExecutionReport = "8";
+constexpr std::string_view kOrderCancelReject = "9";
+constexpr std::string_view kLogon = "A";
+constexpr std::string_view kNewOrderSingle = "D";
+constexpr std::string_view kOrderCancelRequest = "F";
+constexpr std::string_view kOrderCancelReplaceRequest = "G";
+
+// Tags
+constexpr int kAvgPx = 6;
+constexpr int kBeginSeqNo = 7;
+constexpr int kBeginString = 8;
+constexpr int kBodyLength = 9;
+constexpr int kCheckSum = 10;
+constexpr int kClOrdID = 11;
+constexpr int kCumQty = 14;
+constexpr int kEndSeqNo = 16;
+constexpr int kLastPx = 31;
+constexpr int kLastQty = 32;
+constexpr int kMsgSeqNum = 34;
+constexpr int kMsgType = 35;
+constexpr int kNewSeqNo = 36;
+constexpr int kOrderID = 37;
+constexpr int kOrderQty = 38;
+constexpr int kOrdStatus = 39;
+constexpr int kOrdType = 40;
+constexpr int kOrigClOrdID = 41;
+constexpr int kPossDupFlag = 43;
+constexpr int kPrice = 44;
+constexpr int kSenderCompID = 49;
+constexpr int kSendingTime = 52;
+constexpr int kSide = 54;
+constexpr int kSymbol = 55;
+constexpr int kTargetCompID = 56;
+constexpr int kText = 58;
+constexpr int kTimeInForce = 59;
+constexpr int kRawData = 96;
+constexpr int kCxlRejReason = 102;
+constexpr int kHeartBtInt = 108;
+constexpr int kTestReqID = 112;
+constexpr int kGapFillFlag = 123;
+constexpr int kResetSeqNumFlag = 141;
+constexpr int kExecType = 150;
+constexpr int kLeavesQty = 151;
+constexpr int kCxlRejResponseTo = 434;
+constexpr int kUsername = 553;
+constexpr int kPassword = 554;
+
+// Writes "YYYYMMDD-HH:MM:SS.sss" (21 chars) for a Unix time in milliseconds
+std::size_t formatUtcTimestamp(int64_t unix_ms, char* out);
+
+} // namespace fix
+
+// Builds one message in place. BeginString and BodyLength are only known once
+// the body is complete, so the body is written after a reserved gap and the
+// prefix is filled in right-aligned by finish().
+class FixEncoder {
+public:
+    static constexpr std::size_t kCapacity = 1024;
+    // Decimal places written for float fields (Price, OrderQty, ...)
+    static constexpr int kFloatDecimals = 8;
+
+    void begin(std::string_view msg_type, std::string_view sender, std::string_view target,
+               uint64_t seq_num, int64_t sending_time_ms);
+    FixEncoder& field(int tag, std::string_view value);
+    FixEncoder& field(int tag, int64_t value);
+    FixEncoder& field(int tag, double value);
+    FixEncoder& field(int tag, char value);
+
+    // Completes the frame (prefix and CheckSum). Empty if the body overflowed.
+    std::string_view finish();
+
+private:
+    static constexpr std::size_t kPrefixReserve = 24;
+    static constexpr std::size_t kTrailer = 7;   // "10=NNN<SOH>"
+
+    bool reserve(std::size_t n);
+
+    char buffer_[kPrefixReserve + kCapacity + kTrailer];
+    std::size_t pos_ = kPrefixReserve;
+    bool overflow_ = false;
+};
+
+// Read-only view of one received frame. Field values point into the buffer
+// passed to parse(), which must outlive the view.
+class FixMessage {
+public:
+    static constexpr std::size_t kMaxFields = 64;
+
+    // Size of the first complete frame in data, 0 if more bytes are needed,
+    // or -1 if data does not start with a FIX 4.4 header
+    static std::ptrdiff_t frameLength(const char* data, std::size_t size);
+
+    // Split a complete frame into fields and verify its CheckSum
+    bool parse(const char* data, std::size_t size);
+
+    std::string_view msgType() const { return get(fix::kMsgType); }
+    std::string_view get(int tag) const;
+    bool has(int tag) const;
+    bool getInt(int tag, int64_t& out) const;
+    bool getDouble(int tag, double& out) const;
+
+private:
+    struct Field {
+        int tag;
+        const char* value;
+        uint32_t length;
+    };
+
+    std::array<Field, kMaxFields> fields_;
+    std::size_t count_ = 0;
+};
+
+#endif // FIX_CODEC_H
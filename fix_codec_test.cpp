@@ -0,0 +1,38 @@
+#include "fix_codec.h"
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// FIX float fields must be plain decimals. Prices from 100k up and small
+// option prices or sizes are where a shortest-form encoding would switch to
+// exponent notation, which a venue rejects.
+bool checkFixFloatFields() {
+    struct Case {
+        double value;
+        std::string_view expected;
+    };
+    const Case cases[] = {{100000.0, "100000"}, {1000000.0, "1000000"}, {0.0005, "0.0005"},
+                          {65000.5, "65000.5"}, {0.1 + 0.2, "0.3"}, {-0.0, "0"}};
+    bool ok = true;
+    FixEncoder encoder;
+    FixMessage message;
+    for (const auto& c : cases) {
+        encoder.begin(fix::kNewOrderSingle, "DERIBIT_TRADER", "DERIBITSERVER", 1, 1700000000000);
+        encoder.field(fix::kPrice, c.value);
+        std::string_view frame = encoder.finish();
+        double decoded = -1.0;
+        if (!message.parse(frame.data(), frame.size()) || message.get(fix::kPrice) != c.expected
+            || !message.getDouble(fix::kPrice, decoded) || decoded != std::stod(std::string(c.expected))) {
+            std::cerr << "FIX float field " << c.value << " encoded as \"" << message.get(fix::kPrice)
+                      << "\", expected \"" << c.expected << "\"\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = checkFixFloatFields();
+    std::cout << "FIX float fields: " << (ok ? "ok" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
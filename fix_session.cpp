@@ -0,0 +1,483 @@
+#include "fix_session.h"
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+std::string base64(const unsigned char* data, std::size_t size) {
+    std::string out(4 * ((size + 2) / 3), '\0');
+    int written = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&out[0]), data, static_cast<int>(size));
+    out.resize(static_cast<std::size_t>(written));
+    return out;
+}
+
+int64_t unixMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t steadyMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <std::size_t N>
+void copyField(std::string_view value, char (&out)[N]) {
+    std::size_t n = std::min(value.size(), N - 1);
+    if (n > 0) std::memcpy(out, value.data(), n);
+    out[n] = '\0';
+}
+
+const char* orderState(char ord_status) {
+    switch (ord_status) {
+        case '0': case '1': case '5': case '6': case 'E': return "open";
+        case '2': return "filled";
+        case '4': return "cancelled";
+        case '8': return "rejected";
+        default: return "untriggered";
+    }
+}
+
+// ExecutionReport / OrderCancelReject in the JSON-RPC reply shape
+json executionToJson(const FixExecution& e) {
+    if (e.cancel_reject || e.ord_status == '8') {
+        return {{"error", {
+            {"message", e.text[0] ? e.text : (e.cancel_reject ? "cancel rejected" : "order rejected")},
+            {"data", {{"order_id", e.order_id}, {"transport", "fix"}}}
+        }}};
+    }
+    json trades = json::array();
+    if (e.last_qty > 0.0) {
+        trades.push_back({{"order_id", e.order_id}, {"price", e.last_px}, {"amount", e.last_qty}});
+    }
+    return {{"result", {
+        {"order", {
+            {"order_id", e.order_id},
+            {"instrument_name", e.symbol},
+            {"direction", e.side == '2' ? "sell" : "buy"},
+            {"amount", e.order_qty},
+            {"price", e.price},
+            {"filled_amount", e.cum_qty},
+            {"average_price", e.avg_px},
+            {"order_state", orderState(e.ord_status)}
+        }},
+        {"trades", trades}
+    }}};
+}
+
+json transportError(const std::string& message) {
+    return {{"error", {{"message", message}, {"data", {{"transport", "fix"}}}}}};
+}
+
+} // namespace
+
+std::string fixLogonPassword(const std::string& raw_data, const std::string& client_secret) {
+    std::string input = raw_data + client_secret;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_Digest(input.data(), input.size(), digest, &digest_size, EVP_sha256(), nullptr);
+    return base64(digest, digest_size);
+}
+
+FixSession::FixSession(FixSessionConfig config)
+    : config_(std::move(config)), socket_(ioc_) {}
+
+FixSession::~FixSession() {
+    logout();
+}
+
+bool FixSession::logon() {
+    try {
+        tcp::resolver resolver(ioc_);
+        boost::asio::connect(socket_, resolver.resolve(config_.host, config_.port));
+        socket_.set_option(tcp::no_delay(true));
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error connecting FIX session: " << e.what() << std::endl;
+        return false;
+    }
+
+    next_out_seq_ = 1;
+    next_in_seq_ = 1;
+    read_size_ = 0;
+    logout_sent_ = false;
+    last_received_ms_ = steadyMillis();
+    running_ = true;
+    reader_ = std::thread(&FixSession::readLoop, this);
+
+    // Deribit authenticates with RawData = "<timestamp>.<nonce>" and
+    // Password = base64(sha256(RawData ++ client_secret))
+    unsigned char nonce[32];
+    RAND_bytes(nonce, sizeof(nonce));
+    std::string raw_data = std::to_string(unixMillis()) + "." + base64(nonce, sizeof(nonce));
+    std::string password = fixLogonPassword(raw_data, config_.client_secret);
+
+    bool sent = send(fix::kLogon, [&](FixEncoder& encoder) {
+        encoder.field(fix::kHeartBtInt, static_cast<int64_t>(config_.heartbeat_seconds))
+               .field(fix::kRawData, raw_data)
+               .field(fix::kResetSeqNumFlag, 'Y')
+               .field(fix::kUsername, config_.client_id)
+               .field(fix::kPassword, password);
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        state_cv_.wait_for(lock, std::chrono::milliseconds(config_.reply_timeout_ms),
+                           [this]() { return logged_on_.load() || !running_.load(); });
+    }
+    if (!sent || !logged_on_) {
+        std::cerr << "FIX logon to " << config_.host << ":" << config_.port << " failed" << std::endl;
+        shutdown();
+        return false;
+    }
+
+    heartbeat_ = std::thread(&FixSession::heartbeatLoop, this);
+    std::cout << "FIX session logged on to " << config_.host << ":" << config_.port << std::endl;
+    return true;
+}
+
+void FixSession::logout() {
+    if (logged_on_) {
+        logout_sent_ = true;
+        send(fix::kLogout, [](FixEncoder&) {});
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        state_cv_.wait_for(lock, std::chrono::milliseconds(config_.reply_timeout_ms),
+                           [this]() { return !logged_on_.load() || !running_.load(); });
+    }
+    shutdown();
+}
+
+void FixSession::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        running_ = false;
+        logged_on_ = false;
+    }
+    state_cv_.notify_all();
+
+    boost::system::error_code ignored;
+    socket_.shutdown(tcp::socket::shutdown_both, ignored);
+    if (reader_.joinable()) reader_.join();
+    if (heartbeat_.joinable()) heartbeat_.join();
+    socket_.close(ignored);
+}
+
+void FixSession::beginLocked(std::string_view msg_type, uint64_t seq_num) {
+    encoder_.begin(msg_type, config_.sender_comp_id, config_.target_comp_id, seq_num, unixMillis());
+}
+
+bool FixSession::finishLocked(bool advance_seq) {
+    std::string_view frame = encoder_.finish();
+    if (frame.empty()) {
+        std::cerr << "FIX message exceeds the encode buffer" << std::endl;
+        return false;
+    }
+    // The reader thread only ever reads this socket, so a blocking write
+    // here does not race with it
+    boost::system::error_code ec;
+    boost::asio::write(socket_, boost::asio::buffer(frame.data(), frame.size()), ec);
+    if (ec) {
+        std::cerr << "Error writing FIX message: " << ec.message() << std::endl;
+        return false;
+    }
+    if (advance_seq) ++next_out_seq_;
+    last_sent_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void FixSession::readLoop() {
+    FixMessage message;
+    while (running_) {
+        boost::system::error_code ec;
+        std::size_t n = socket_.read_some(
+            boost::asio::buffer(read_buffer_.data() + read_size_, read_buffer_.size() - read_size_), ec);
+        if (ec) break;
+        read_size_ += n;
+
+        std::size_t offset = 0;
+        bool corrupt = false;
+        while (offset < read_size_) {
+            std::ptrdiff_t length = FixMessage::frameLength(read_buffer_.data() + offset, read_size_ - offset);
+            if (length == 0) break;
+            if (length < 0) {
+                corrupt = true;
+                break;
+            }
+            if (message.parse(read_buffer_.data() + offset, static_cast<std::size_t>(length))) {
+                handleMessage(message);
+            } else {
+                std::cerr << "Dropping FIX message with a bad checksum" << std::endl;
+            }
+            offset += static_cast<std::size_t>(length);
+        }
+        if (corrupt || (offset == 0 && read_size_ == read_buffer_.size())) {
+            std::cerr << "Malformed FIX stream, closing session" << std::endl;
+            break;
+        }
+        std::memmove(read_buffer_.data(), read_buffer_.data() + offset, read_size_ - offset);
+        read_size_ -= offset;
+    }
+
+    bool was_running;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        was_running = running_.exchange(false);
+        logged_on_ = false;
+    }
+    state_cv_.notify_all();
+    if (was_running && !logout_sent_) {
+        std::cerr << "FIX session disconnected" << std::endl;
+    }
+}
+
+void FixSession::handleMessage(const FixMessage& message) {
+    last_received_ms_ = steadyMillis();
+    std::string_view type = message.msgType();
+    int64_t seq = 0;
+    message.getInt(fix::kMsgSeqNum, seq);
+
+    if (type == fix::kSequenceReset) {
+        int64_t new_seq = 0;
+        if (message.getInt(fix::kNewSeqNo, new_seq) && static_cast<uint64_t>(new_seq) > next_in_seq_) {
+            next_in_seq_ = static_cast<uint64_t>(new_seq);
+        }
+        return;
+    }
+
+    // Gaps are requested again but messages are still handled in arrival
+    // order; replayed execution reports for settled requests find no waiter.
+    if (static_cast<uint64_t>(seq) > next_in_seq_ && type != fix::kLogon) {
+        std::cerr << "FIX sequence gap: expected " << next_in_seq_ << ", got " << seq << std::endl;
+        uint64_t begin = next_in_seq_;
+        send(fix::kResendRequest, [begin](FixEncoder& encoder) {
+            encoder.field(fix::kBeginSeqNo, static_cast<int64_t>(begin)).field(fix::kEndSeqNo, int64_t{0});
+        });
+    }
+    if (static_cast<uint64_t>(seq) >= next_in_seq_ || type == fix::kLogon) {
+        next_in_seq_ = static_cast<uint64_t>(seq) + 1;
+    }
+
+    if (type == fix::kLogon) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            logged_on_ = true;
+        }
+        state_cv_.notify_all();
+    } else if (type == fix::kTestRequest) {
+        std::string_view id = message.get(fix::kTestReqID);
+        send(fix::kHeartbeat, [id](FixEncoder& encoder) { encoder.field(fix::kTestReqID, id); });
+    } else if (type == fix::kResendRequest) {
+        // Outbound messages are not stored; order entry is never replayed,
+        // so answer with a gap fill up to the next sequence number
+        int64_t begin = 1;
+        message.getInt(fix::kBeginSeqNo, begin);
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        beginLocked(fix::kSequenceReset, static_cast<uint64_t>(begin));
+        encoder_.field(fix::kPossDupFlag, 'Y')
+                .field(fix::kGapFillFlag, 'Y')
+                .field(fix::kNewSeqNo, static_cast<int64_t>(next_out_seq_));
+        finishLocked(false);
+    } else if (type == fix::kLogout) {
+        if (!logout_sent_) {
+            std::cerr << "FIX logout from acceptor: " << message.get(fix::kText) << std::endl;
+            logout_sent_ = true;
+            send(fix::kLogout, [](FixEncoder&) {});
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            logged_on_ = false;
+        }
+        state_cv_.notify_all();
+    } else if (type == fix::kReject) {
+        std::cerr << "FIX session reject: " << message.get(fix::kText) << std::endl;
+    } else if (type == fix::kExecutionReport) {
+        deliverExecution(message, false);
+    } else if (type == fix::kOrderCancelReject) {
+        deliverExecution(message, true);
+    }
+}
+
+void FixSession::deliverExecution(const FixMessage& message, bool cancel_reject) {
+    FixExecution execution;
+    message.getInt(fix::kClOrdID, execution.cl_ord_id);
+    execution.cancel_reject = cancel_reject;
+    std::string_view value = message.get(fix::kExecType);
+    execution.exec_type = value.empty() ? 0 : value[0];
+    value = message.get(fix::kOrdStatus);
+    execution.ord_status = value.empty() ? 0 : value[0];
+    value = message.get(fix::kSide);
+    execution.side = value.empty() ? 0 : value[0];
+    message.getDouble(fix::kOrderQty, execution.order_qty);
+    message.getDouble(fix::kPrice, execution.price);
+    message.getDouble(fix::kCumQty, execution.cum_qty);
+    message.getDouble(fix::kLeavesQty, execution.leaves_qty);
+    message.getDouble(fix::kAvgPx, execution.avg_px);
+    message.getDouble(fix::kLastQty, execution.last_qty);
+    message.getDouble(fix::kLastPx, execution.last_px);
+    copyField(message.get(fix::kOrderID), execution.order_id);
+    copyField(message.get(fix::kSymbol), execution.symbol);
+    copyField(message.get(fix::kText), execution.text);
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (Pending& slot : pending_) {
+            if (slot.waiting && !slot.ready && slot.cl_ord_id == execution.cl_ord_id) {
+                slot.execution = execution;
+                slot.ready = true;
+                state_cv_.notify_all();
+                return;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(handler_mutex_);
+    if (execution_handler_) execution_handler_(execution);
+}
+
+bool FixSession::expectExecution(int64_t cl_ord_id) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    for (Pending& slot : pending_) {
+        if (!slot.waiting) {
+            slot.cl_ord_id = cl_ord_id;
+            slot.waiting = true;
+            slot.ready = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FixSession::awaitExecution(int64_t cl_ord_id, FixExecution& out) {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    auto slot = std::find_if(pending_.begin(), pending_.end(), [cl_ord_id](const Pending& p) {
+        return p.waiting && p.cl_ord_id == cl_ord_id;
+    });
+    if (slot == pending_.end()) return false;
+
+    state_cv_.wait_for(lock, std::chrono::milliseconds(config_.reply_timeout_ms),
+                       [&]() { return slot->ready || !running_.load(); });
+    bool answered = slot->ready;
+    if (answered) out = slot->execution;
+    slot->waiting = false;
+    slot->ready = false;
+    return answered;
+}
+
+void FixSession::forgetExecution(int64_t cl_ord_id) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    for (Pending& slot : pending_) {
+        if (slot.waiting && slot.cl_ord_id == cl_ord_id) {
+            slot.waiting = false;
+            slot.ready = false;
+        }
+    }
+}
+
+void FixSession::setExecutionHandler(std::function<void(const FixExecution&)> handler) {
+    std::lock_guard<std::mutex> lock(handler_mutex_);
+    execution_handler_ = std::move(handler);
+}
+
+void FixSession::heartbeatLoop() {
+    const auto interval = std::chrono::seconds(config_.heartbeat_seconds);
+    const int64_t interval_ms = config_.heartbeat_seconds * 1000LL;
+    int64_t last_probe_ms = 0;
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    while (running_) {
+        state_cv_.wait_for(lock, std::chrono::seconds(1), [this]() { return !running_.load(); });
+        if (!running_) break;
+        lock.unlock();
+
+        bool idle;
+        {
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            idle = std::chrono::steady_clock::now() - last_sent_ >= interval;
+        }
+        if (idle) send(fix::kHeartbeat, [](FixEncoder&) {});
+
+        // Quiet acceptor: probe once per interval, give up after three
+        int64_t silent_ms = steadyMillis() - last_received_ms_.load();
+        if (silent_ms > 3 * interval_ms) {
+            std::cerr << "FIX acceptor silent for " << silent_ms << " ms, closing session" << std::endl;
+            boost::system::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored);
+        } else if (silent_ms > interval_ms && steadyMillis() - last_probe_ms >= interval_ms) {
+            last_probe_ms = steadyMillis();
+            send(fix::kTestRequest, [](FixEncoder& encoder) { encoder.field(fix::kTestReqID, "probe"); });
+        }
+        lock.lock();
+    }
+}
+
+FixOrderTransport::FixOrderTransport(FixSession& session)
+    : session_(session),
+      in_flight_(MetricsRegistry::instance().gauge(
+          "deribit_fix_in_flight", "FIX order requests sent and awaiting an execution report")) {
+    // Fills after the ack carry the original ClOrdID, which is the request id
+    session_.setExecutionHandler([this](const FixExecution& execution) {
+        OrderTracer* tracer = tracer_.load();
+        if (tracer && execution.last_qty > 0.0) {
+            tracer->stampOnce(execution.cl_ord_id, OrderStage::FillReceived);
+        }
+    });
+}
+
+FixOrderTransport::~FixOrderTransport() {
+    session_.setExecutionHandler(nullptr);
+}
+
+template <typename Body>
+json FixOrderTransport::roundTrip(int request_id, std::string_view msg_type, Body&& body, OrderTracer& tracer) {
+    tracer_.store(&tracer);
+    if (!session_.loggedOn()) return transportError("FIX session is not logged on");
+    if (!session_.expectExecution(request_id)) return transportError("Too many FIX requests in flight");
+
+    GaugeScope in_flight(in_flight_);
+    bool sent = session_.send(msg_type, [&](FixEncoder& encoder) {
+        encoder.field(fix::kClOrdID, static_cast<int64_t>(request_id));
+        body(encoder);
+        tracer.stamp(request_id, OrderStage::Encoded);
+    });
+    if (!sent) {
+        session_.forgetExecution(request_id);
+        return transportError("FIX send failed");
+    }
+    tracer.stamp(request_id, OrderStage::Written);
+
+    FixExecution execution;
+    if (!session_.awaitExecution(request_id, execution)) {
+        return transportError("No FIX reply for request " + std::to_string(request_id));
+    }
+    tracer.stamp(request_id, OrderStage::AckReceived);
+    return executionToJson(execution);
+}
+
+json FixOrderTransport::placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) {
+    return roundTrip(request_id, fix::kNewOrderSingle, [&order](FixEncoder& encoder) {
+        encoder.field(fix::kSide, order.side == OrderSide::Buy ? '1' : '2')
+               .field(fix::kOrderQty, order.amount)
+               .field(fix::kPrice, order.price)
+               .field(fix::kOrdType, '2')
+               .field(fix::kSymbol, order.instrument_name);
+    }, tracer);
+}
+
+json FixOrderTransport::cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) {
+    return roundTrip(request_id, fix::kOrderCancelRequest, [&order_id](FixEncoder& encoder) {
+        encoder.field(fix::kOrigClOrdID, order_id);
+    }, tracer);
+}
+
+json FixOrderTransport::modifyOrder(int request_id, const std::string& order_id, double new_price,
+                                    double new_amount, OrderTracer& tracer) {
+    return roundTrip(request_id, fix::kOrderCancelReplaceRequest, [&](FixEncoder& encoder) {
+        encoder.field(fix::kOrigClOrdID, order_id)
+               .field(fix::kOrderQty, new_amount)
+               .field(fix::kPrice, new_price)
+               .field(fix::kOrdType, '2');
+    }, tracer);
+}
@@ -0,0 +1,156 @@
+#ifndef FIX_SESSION_H
+#define FIX_SESSION_H
+
+#include "fix_codec.h"
+#include "order_transport.h"
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct FixSessionConfig {
+    std::string host;
+    std::string port;
+    std::string sender_comp_id = "DERIBIT_TRADER";
+    std::string target_comp_id = "DERIBITSERVER";
+    std::string client_id;
+    std::string client_secret;
+    int heartbeat_seconds = 30;
+    int reply_timeout_ms = 5000;
+};
+
+// Fields of an ExecutionReport or OrderCancelReject copied out of the
+// receive buffer into fixed-size storage
+struct FixExecution {
+    int64_t cl_ord_id = 0;
+    bool cancel_reject = false;
+    char exec_type = 0;
+    char ord_status = 0;
+    char side = 0;
+    double order_qty = 0.0;
+    double price = 0.0;
+    double cum_qty = 0.0;
+    double leaves_qty = 0.0;
+    double avg_px = 0.0;
+    double last_qty = 0.0;
+    double last_px = 0.0;
+    char order_id[64] = {};
+    char symbol[64] = {};
+    char text[128] = {};
+};
+
+// Deribit Logon password: base64(sha256(raw_data + client_secret))
+std::string fixLogonPassword(const std::string& raw_data, const std::string& client_secret);
+
+// FIX 4.4 initiator session over TCP. A reader thread answers TestRequest and
+// ResendRequest, tracks inbound sequence numbers and hands ExecutionReports to
+// whoever is waiting for that ClOrdID; a heartbeat thread keeps the session
+// alive when no orders are flowing. Sends are serialised by one mutex that
+// also owns the outbound sequence number and the encode buffer.
+class FixSession {
+public:
+    explicit FixSession(FixSessionConfig config);
+    ~FixSession();
+
+    // Connect, send Logon and wait for the acceptor's Logon
+    bool logon();
+    void logout();
+    bool loggedOn() const { return logged_on_.load(); }
+
+    // Encode and send one message; body(FixEncoder&) adds the fields after
+    // the standard header. False if the session is down or the body overflowed.
+    template <typename Body>
+    bool send(std::string_view msg_type, Body&& body) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (!running_.load()) return false;
+        beginLocked(msg_type, next_out_seq_);
+        body(encoder_);
+        return finishLocked(true);
+    }
+
+    // Register interest in the reply to cl_ord_id before sending the request,
+    // then block until the ExecutionReport or OrderCancelReject arrives (or
+    // the reply timeout passes). forgetExecution drops an unused registration.
+    bool expectExecution(int64_t cl_ord_id);
+    bool awaitExecution(int64_t cl_ord_id, FixExecution& out);
+    void forgetExecution(int64_t cl_ord_id);
+
+    // Reports nobody is waiting for (fills after the ack, unsolicited cancels)
+    void setExecutionHandler(std::function<void(const FixExecution&)> handler);
+
+private:
+    static constexpr std::size_t kPendingSlots = 64;
+    static constexpr std::size_t kReadBufferSize = 64 * 1024;
+
+    struct Pending {
+        int64_t cl_ord_id = 0;
+        bool waiting = false;
+        bool ready = false;
+        FixExecution execution;
+    };
+
+    void beginLocked(std::string_view msg_type, uint64_t seq_num);
+    bool finishLocked(bool advance_seq);
+    void readLoop();
+    void heartbeatLoop();
+    void handleMessage(const FixMessage& message);
+    void deliverExecution(const FixMessage& message, bool cancel_reject);
+    void shutdown();
+
+    FixSessionConfig config_;
+    boost::asio::io_context ioc_;
+    boost::asio::ip::tcp::socket socket_;
+
+    std::mutex write_mutex_;
+    FixEncoder encoder_;
+    uint64_t next_out_seq_ = 1;
+    std::chrono::steady_clock::time_point last_sent_;
+
+    uint64_t next_in_seq_ = 1;                  // reader thread only
+    std::array<char, kReadBufferSize> read_buffer_;
+    std::size_t read_size_ = 0;
+
+    std::mutex state_mutex_;
+    std::condition_variable state_cv_;
+    std::atomic<bool> logged_on_{false};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> logout_sent_{false};
+    std::atomic<int64_t> last_received_ms_{0};
+    std::array<Pending, kPendingSlots> pending_;
+    std::mutex handler_mutex_;
+    std::function<void(const FixExecution&)> execution_handler_;
+
+    std::thread reader_;
+    std::thread heartbeat_;
+};
+
+// OrderTransport over a FixSession: NewOrderSingle, OrderCancelRequest and
+// OrderCancelReplaceRequest out, ExecutionReport back. ClOrdID is the
+// request id, so the order trace lines up with the JSON-RPC path.
+class FixOrderTransport : public OrderTransport {
+public:
+    explicit FixOrderTransport(FixSession& session);
+    ~FixOrderTransport() override;
+
+    const char* name() const override { return "fix"; }
+    json placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) override;
+    json cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) override;
+    json modifyOrder(int request_id, const std::string& order_id, double new_price,
+                     double new_amount, OrderTracer& tracer) override;
+
+private:
+    template <typename Body>
+    json roundTrip(int request_id, std::string_view msg_type, Body&& body, OrderTracer& tracer);
+
+    FixSession& session_;
+    Gauge& in_flight_;
+    std::atomic<OrderTracer*> tracer_{nullptr};   // for fills that arrive after the ack
+};
+
+#endif // FIX_SESSION_H
@@ -1,12 +1,31 @@
 #include "latency_module.h"
+#include "metrics.h"
+#include <atomic>
 #include <iostream>
+#include <utility>
+
+namespace {
+std::atomic<bool> console_output{true};
+}
+
+LatencyModule::Action::Action(std::string name)
+    : name_(std::move(name)),
+      histogram_(MetricsRegistry::instance().histogram(
+          "deribit_latency_seconds", "Latency of timed client actions", "action=\"" + name_ + "\"")) {}
 
 std::chrono::high_resolution_clock::time_point LatencyModule::start() {
     return std::chrono::high_resolution_clock::now();
 }
 
-void LatencyModule::end(const std::chrono::high_resolution_clock::time_point& start_time, const std::string& action_name) {
+void LatencyModule::end(const std::chrono::high_resolution_clock::time_point& start_time, const Action& action) {
     auto end_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> latency = end_time - start_time;
-    std::cout << action_name << " Latency: " << latency.count() << " seconds" << std::endl;
+    action.histogram().observe(latency.count());
+    if (console_output.load(std::memory_order_relaxed)) {
+        std::cout << action.name() << " Latency: " << latency.count() << " seconds" << std::endl;
+    }
+}
+
+void LatencyModule::setConsoleOutput(bool enabled) {
+    console_output.store(enabled, std::memory_order_relaxed);
 }
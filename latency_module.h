@@ -4,13 +4,33 @@
 #include <chrono>
 #include <string>
 
+class LatencyHistogram;
+
 class LatencyModule {
 public:
+    // A timed action and its deribit_latency_seconds histogram, looked up in
+    // the metrics registry once. Keep one per call site (a function-local
+    // static) so timing a call never takes the registry lock.
+    class Action {
+    public:
+        explicit Action(std::string name);
+        const std::string& name() const { return name_; }
+        LatencyHistogram& histogram() const { return histogram_; }
+
+    private:
+        std::string name_;
+        LatencyHistogram& histogram_;
+    };
+
     // Start a timer
     static std::chrono::high_resolution_clock::time_point start();
 
-    // End the timer and calculate the latency
-    static void end(const std::chrono::high_resolution_clock::time_point& start_time, const std::string& action_name);
+    // End the timer and calculate the latency. Each action also feeds the
+    // deribit_latency_seconds histogram exported by the metrics endpoint.
+    static void end(const std::chrono::high_resolution_clock::time_point& start_time, const Action& action);
+
+    // Turn the per-call stdout line on or off (histograms are always recorded)
+    static void setConsoleOutput(bool enabled);
 };
 
 #endif // LATENCY_MODULE_H
@@ -0,0 +1,292 @@
+#include "matching_engine.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr double kEpsilon = 1e-9;
+
+BookSide restingSide(OrderSide side) {
+    return side == OrderSide::Buy ? BookSide::Bid : BookSide::Ask;
+}
+
+BookSide oppositeSide(OrderSide side) {
+    return side == OrderSide::Buy ? BookSide::Ask : BookSide::Bid;
+}
+
+const char* directionName(OrderSide side) {
+    return side == OrderSide::Buy ? "buy" : "sell";
+}
+
+// Whether an opposite-side level at price can trade with a limit order
+bool crosses(OrderSide side, double limit, double price) {
+    return side == OrderSide::Buy ? price <= limit : price >= limit;
+}
+
+} // namespace
+
+MatchingEngine::Instrument& MatchingEngine::instrument(const std::string& instrument_name) {
+    return instruments_[instrument_name];
+}
+
+const OrderBook* MatchingEngine::book(const std::string& instrument_name) const {
+    auto it = instruments_.find(instrument_name);
+    return it == instruments_.end() ? nullptr : &it->second.book;
+}
+
+double MatchingEngine::markedAmount(const std::vector<LevelMark>& marks, BookSide side, double price) {
+    for (const auto& mark : marks) {
+        if (mark.side == side && mark.price == price) return mark.amount;
+    }
+    return 0.0;
+}
+
+void MatchingEngine::addMark(std::vector<LevelMark>& marks, BookSide side, double price, double amount) {
+    for (auto& mark : marks) {
+        if (mark.side == side && mark.price == price) {
+            mark.amount += amount;
+            return;
+        }
+    }
+    marks.push_back(LevelMark{side, price, amount});
+}
+
+double MatchingEngine::takeMark(std::vector<LevelMark>& marks, BookSide side, double price, double limit) {
+    for (auto it = marks.begin(); it != marks.end(); ++it) {
+        if (it->side != side || it->price != price) continue;
+        double taken = std::min(it->amount, limit);
+        it->amount -= taken;
+        if (it->amount <= kEpsilon) marks.erase(it);
+        return taken;
+    }
+    return 0.0;
+}
+
+void MatchingEngine::applyBook(const std::string& instrument_name, bool snapshot,
+                               const std::vector<LevelUpdate>& levels, int64_t exchange_ns,
+                               std::vector<SimFill>& fills) {
+    Instrument& inst = instrument(instrument_name);
+
+    if (snapshot) {
+        inst.book.clear();
+        inst.traded.clear();
+        inst.taken.clear();
+        for (const auto& level : levels) {
+            inst.book.setLevel(level.side, level.price, level.size);
+        }
+        // A snapshot says nothing about what happened in between, so only cap
+        // each queue at what is displayed now
+        for (auto& entry : orders_) {
+            RestingOrder& order = entry.second;
+            if (order.instrument_name != instrument_name) continue;
+            order.queue_ahead = std::min(order.queue_ahead,
+                                         inst.book.sizeAt(restingSide(order.side), order.price));
+        }
+    } else {
+        for (const auto& level : levels) {
+            double old_size = inst.book.sizeAt(level.side, level.price);
+            double new_size = std::max(level.size, 0.0);
+            inst.book.setLevel(level.side, level.price, new_size);
+            takeMark(inst.taken, level.side, level.price, std::numeric_limits<double>::infinity());
+            if (new_size >= old_size) continue;
+
+            // Whatever the trades did not account for was cancelled, evenly
+            // through the queue
+            double decrease = old_size - new_size;
+            double cancelled = decrease - takeMark(inst.traded, level.side, level.price, decrease);
+            if (cancelled <= kEpsilon) continue;
+            for (auto& entry : orders_) {
+                RestingOrder& order = entry.second;
+                if (order.instrument_name != instrument_name || restingSide(order.side) != level.side
+                    || order.price != level.price) {
+                    continue;
+                }
+                double share = std::min(1.0, order.queue_ahead / old_size);
+                order.queue_ahead = std::max(0.0, order.queue_ahead - cancelled * share);
+            }
+        }
+    }
+    sweepCrossed(instrument_name, exchange_ns, fills);
+}
+
+void MatchingEngine::applyTrades(const std::string& instrument_name, const std::vector<TradePrint>& trades,
+                                 int64_t exchange_ns, std::vector<SimFill>& fills) {
+    Instrument& inst = instrument(instrument_name);
+    for (const auto& trade : trades) {
+        // A buy aggressor lifts offers, so resting sells are the passive side
+        OrderSide passive = trade.aggressor == OrderSide::Buy ? OrderSide::Sell : OrderSide::Buy;
+        addMark(inst.traded, restingSide(passive), trade.price, trade.amount);
+
+        for (auto it = orders_.begin(); it != orders_.end();) {
+            auto current = it++;
+            RestingOrder& order = current->second;
+            if (order.instrument_name != instrument_name || order.side != passive) continue;
+
+            double remaining = order.amount - order.filled;
+            bool through = passive == OrderSide::Sell ? order.price < trade.price : order.price > trade.price;
+            if (through) {
+                fillResting(current, remaining, exchange_ns, fills);
+            } else if (order.price == trade.price) {
+                // Everything printed at our price was ahead of us until the queue is gone
+                double past_queue = trade.amount - order.queue_ahead;
+                order.queue_ahead = std::max(0.0, order.queue_ahead - trade.amount);
+                if (past_queue > kEpsilon) {
+                    fillResting(current, std::min(remaining, past_queue), exchange_ns, fills);
+                }
+            }
+        }
+    }
+}
+
+void MatchingEngine::sweepCrossed(const std::string& instrument_name, int64_t exchange_ns,
+                                  std::vector<SimFill>& fills) {
+    const OrderBook& book = instrument(instrument_name).book;
+    for (auto it = orders_.begin(); it != orders_.end();) {
+        auto current = it++;
+        const RestingOrder& order = current->second;
+        if (order.instrument_name != instrument_name) continue;
+        double best = book.bestPrice(oppositeSide(order.side));
+        if (best > 0.0 && crosses(order.side, order.price, best)) {
+            fillResting(current, order.amount - order.filled, exchange_ns, fills);
+        }
+    }
+}
+
+void MatchingEngine::fillResting(std::map<uint64_t, RestingOrder>::iterator it, double amount,
+                                 int64_t exchange_ns, std::vector<SimFill>& fills) {
+    RestingOrder& order = it->second;
+    fills.push_back(SimFill{next_trade_id_++, order.order_id, order.instrument_name, order.side,
+                            order.price, amount, true, exchange_ns});
+    order.filled += amount;
+    if (order.amount - order.filled <= kEpsilon) {
+        sequence_by_id_.erase(order.order_id);
+        orders_.erase(it);
+    }
+}
+
+bool MatchingEngine::match(RestingOrder& order, int64_t exchange_ns, std::vector<SimFill>& fills, json& trades) {
+    Instrument& inst = instrument(order.instrument_name);
+    BookSide opposite = oppositeSide(order.side);
+    const double* prices = inst.book.prices(opposite);
+    const double* sizes = inst.book.sizes(opposite);
+
+    for (std::size_t i = 0; i < inst.book.depth(opposite) && order.amount - order.filled > kEpsilon; ++i) {
+        if (!crosses(order.side, order.price, prices[i])) break;
+        double available = sizes[i] - markedAmount(inst.taken, opposite, prices[i]);
+        double fill = std::min(available, order.amount - order.filled);
+        if (fill <= kEpsilon) continue;
+
+        addMark(inst.taken, opposite, prices[i], fill);
+        order.filled += fill;
+        uint64_t trade_id = next_trade_id_++;
+        fills.push_back(SimFill{trade_id, order.order_id, order.instrument_name, order.side,
+                                prices[i], fill, false, exchange_ns});
+        trades.push_back({
+            {"trade_id", "SIM-T" + std::to_string(trade_id)},
+            {"order_id", order.order_id},
+            {"instrument_name", order.instrument_name},
+            {"direction", directionName(order.side)},
+            {"price", prices[i]},
+            {"amount", fill},
+            {"liquidity", "T"},
+            {"timestamp", exchange_ns / 1000000}
+        });
+    }
+    return order.amount - order.filled > kEpsilon;
+}
+
+void MatchingEngine::rest(uint64_t sequence, RestingOrder order) {
+    // Joins behind the displayed size and behind our own earlier orders
+    const OrderBook& book = instrument(order.instrument_name).book;
+    order.queue_ahead = book.sizeAt(restingSide(order.side), order.price);
+    for (const auto& entry : orders_) {
+        const RestingOrder& other = entry.second;
+        if (other.instrument_name == order.instrument_name && other.side == order.side
+            && other.price == order.price) {
+            order.queue_ahead += other.amount - other.filled;
+        }
+    }
+    sequence_by_id_[order.order_id] = sequence;
+    orders_.emplace(sequence, std::move(order));
+}
+
+json MatchingEngine::place(const NewOrder& request, int64_t exchange_ns, std::vector<SimFill>& fills) {
+    if (!(request.amount > 0.0) || !(request.price > 0.0)) {
+        return errorJson(-32602, "Invalid params");
+    }
+    uint64_t sequence = next_sequence_++;
+    RestingOrder order{"SIM-" + std::to_string(sequence), request.instrument_name, request.side,
+                       request.price, request.amount, 0.0, 0.0};
+
+    json trades = json::array();
+    bool rests = match(order, exchange_ns, fills, trades);
+    json reply = {{"result", {{"order", orderJson(order, rests ? "open" : "filled")}, {"trades", std::move(trades)}}}};
+    if (rests) rest(sequence, std::move(order));
+    return reply;
+}
+
+json MatchingEngine::cancel(const std::string& order_id) {
+    auto id = sequence_by_id_.find(order_id);
+    if (id == sequence_by_id_.end()) {
+        return errorJson(11044, "not_open_order");
+    }
+    auto it = orders_.find(id->second);
+    json reply = {{"result", orderJson(it->second, "cancelled")}};
+    orders_.erase(it);
+    sequence_by_id_.erase(id);
+    return reply;
+}
+
+json MatchingEngine::modify(const std::string& order_id, double new_price, double new_amount,
+                            int64_t exchange_ns, std::vector<SimFill>& fills) {
+    auto id = sequence_by_id_.find(order_id);
+    if (id == sequence_by_id_.end()) {
+        return errorJson(11044, "not_open_order");
+    }
+    if (!(new_amount > 0.0) || !(new_price > 0.0)) {
+        return errorJson(-32602, "Invalid params");
+    }
+    auto it = orders_.find(id->second);
+
+    // Shrinking in place keeps the queue position; anything else re-enters
+    if (new_price == it->second.price && new_amount <= it->second.amount) {
+        RestingOrder& order = it->second;
+        order.amount = new_amount;
+        bool done = order.amount - order.filled <= kEpsilon;
+        json reply = {{"result", {{"order", orderJson(order, done ? "filled" : "open")}, {"trades", json::array()}}}};
+        if (done) {
+            orders_.erase(it);
+            sequence_by_id_.erase(id);
+        }
+        return reply;
+    }
+
+    RestingOrder order = std::move(it->second);
+    orders_.erase(it);
+    sequence_by_id_.erase(id);
+    order.price = new_price;
+    order.amount = new_amount;
+
+    json trades = json::array();
+    bool rests = match(order, exchange_ns, fills, trades);
+    json reply = {{"result", {{"order", orderJson(order, rests ? "open" : "filled")}, {"trades", std::move(trades)}}}};
+    if (rests) rest(next_sequence_++, std::move(order));
+    return reply;
+}
+
+json MatchingEngine::orderJson(const RestingOrder& order, const char* state) {
+    return {
+        {"order_id", order.order_id},
+        {"instrument_name", order.instrument_name},
+        {"direction", directionName(order.side)},
+        {"order_type", "limit"},
+        {"order_state", state},
+        {"price", order.price},
+        {"amount", order.amount},
+        {"filled_amount", order.filled}
+    };
+}
+
+json MatchingEngine::errorJson(int code, const char* message) {
+    return {{"error", {{"code", code}, {"message", message}}}};
+}
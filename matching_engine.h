@@ -0,0 +1,110 @@
+#ifndef MATCHING_ENGINE_H
+#define MATCHING_ENGINE_H
+
+#include "order_book.h"
+#include "order_transport.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct LevelUpdate {
+    BookSide side;
+    double price;
+    double size;        // zero removes the level
+};
+
+struct TradePrint {
+    double price;
+    double amount;
+    OrderSide aggressor;
+};
+
+struct SimFill {
+    uint64_t trade_id;
+    std::string order_id;
+    std::string instrument_name;
+    OrderSide side;
+    double price;
+    double amount;
+    bool maker;
+    int64_t exchange_ns;
+};
+
+// Exchange side of the backtest. Replays the recorded book per instrument and
+// matches simulated orders against it in price-time order. Recorded liquidity
+// is not ours to remove, so a resting order carries an estimate of the size
+// queued ahead of it at its price: the displayed size (plus our own earlier
+// orders) when it joins, reduced by trades printed at that price and by a
+// proportional share of cancellations. It fills once trades eat through that
+// queue or the opposite side moves through its price. Aggressive orders take
+// displayed size level by level; what they took stays unavailable until the
+// recording next updates that level.
+class MatchingEngine {
+public:
+    // Market events at the exchange. Fills of resting orders are appended.
+    void applyBook(const std::string& instrument_name, bool snapshot, const std::vector<LevelUpdate>& levels,
+                   int64_t exchange_ns, std::vector<SimFill>& fills);
+    void applyTrades(const std::string& instrument_name, const std::vector<TradePrint>& trades,
+                     int64_t exchange_ns, std::vector<SimFill>& fills);
+
+    // Order entry. Replies carry the "result" or "error" of the matching
+    // Deribit JSON-RPC call; immediate fills are appended to fills as well.
+    json place(const NewOrder& order, int64_t exchange_ns, std::vector<SimFill>& fills);
+    json cancel(const std::string& order_id);
+    json modify(const std::string& order_id, double new_price, double new_amount, int64_t exchange_ns,
+                std::vector<SimFill>& fills);
+
+    const OrderBook* book(const std::string& instrument_name) const;
+    std::size_t openOrders() const { return orders_.size(); }
+
+private:
+    struct RestingOrder {
+        std::string order_id;
+        std::string instrument_name;
+        OrderSide side;
+        double price;
+        double amount;
+        double filled;
+        double queue_ahead;
+    };
+
+    // Size per level consumed since the recording last touched it
+    struct LevelMark {
+        BookSide side;
+        double price;
+        double amount;
+    };
+
+    struct Instrument {
+        OrderBook book;
+        std::vector<LevelMark> traded;  // printed by trades, so the level's decrease is not counted twice
+        std::vector<LevelMark> taken;   // removed by our aggressive orders
+    };
+
+    static double takeMark(std::vector<LevelMark>& marks, BookSide side, double price, double limit);
+    static double markedAmount(const std::vector<LevelMark>& marks, BookSide side, double price);
+    static void addMark(std::vector<LevelMark>& marks, BookSide side, double price, double amount);
+
+    Instrument& instrument(const std::string& instrument_name);
+    // Take liquidity for an incoming order and rest what is left; false if nothing rests
+    bool match(RestingOrder& order, int64_t exchange_ns, std::vector<SimFill>& fills, json& trades);
+    void rest(uint64_t sequence, RestingOrder order);
+    void fillResting(std::map<uint64_t, RestingOrder>::iterator it, double amount, int64_t exchange_ns,
+                     std::vector<SimFill>& fills);
+    void sweepCrossed(const std::string& instrument_name, int64_t exchange_ns, std::vector<SimFill>& fills);
+    static json orderJson(const RestingOrder& order, const char* state);
+    static json errorJson(int code, const char* message);
+
+    std::unordered_map<std::string, Instrument> instruments_;
+    std::map<uint64_t, RestingOrder> orders_;                 // by sequence, i.e. time priority
+    std::unordered_map<std::string, uint64_t> sequence_by_id_;
+    uint64_t next_sequence_ = 1;
+    uint64_t next_trade_id_ = 1;
+};
+
+#endif // MATCHING_ENGINE_H
@@ -0,0 +1,103 @@
+#include "message_arena.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+thread_local MessageArena* current_arena = nullptr;
+}
+
+MessageArena::MessageArena(std::size_t block_size)
+    : block_size_(block_size > 0 ? block_size : 4096) {
+    addBlock(block_size_);
+}
+
+MessageArena::~MessageArena() {
+    for (Block& block : blocks_) {
+        std::free(block.data);
+    }
+}
+
+MessageArena* MessageArena::current() {
+    return current_arena;
+}
+
+void* MessageArena::allocate(std::size_t bytes, std::size_t alignment) {
+    for (;;) {
+        Block& block = blocks_[current_];
+        std::size_t aligned = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (aligned + bytes <= block.size) {
+            offset_ = aligned + bytes;
+            message_bytes_ += bytes;
+            allocations_.fetch_add(1, std::memory_order_relaxed);
+            bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            return block.data + aligned;
+        }
+        if (current_ + 1 < blocks_.size()) {
+            ++current_;
+        } else {
+            addBlock(std::max(block_size_, bytes + alignment));
+            current_ = blocks_.size() - 1;
+        }
+        offset_ = 0;
+    }
+}
+
+bool MessageArena::owns(const void* p) const {
+    const char* c = static_cast<const char*>(p);
+    for (const Block& block : blocks_) {
+        if (c >= block.data && c < block.data + block.size) return true;
+    }
+    return false;
+}
+
+void MessageArena::reset() {
+    messages_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t peak = peak_message_bytes_.load(std::memory_order_relaxed);
+    if (message_bytes_ > peak) {
+        peak_message_bytes_.store(message_bytes_, std::memory_order_relaxed);
+    }
+
+    // Merge overflow blocks into one big enough for this message so the
+    // next message of the same size fits without another malloc.
+    if (blocks_.size() > 1) {
+        std::size_t total = 0;
+        for (Block& block : blocks_) {
+            total += block.size;
+            std::free(block.data);
+        }
+        blocks_.clear();
+        addBlock(total);
+    }
+    current_ = 0;
+    offset_ = 0;
+    message_bytes_ = 0;
+}
+
+ArenaStats MessageArena::stats() const {
+    ArenaStats stats;
+    stats.messages = messages_.load(std::memory_order_relaxed);
+    stats.allocations = allocations_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.heap_blocks = heap_blocks_.load(std::memory_order_relaxed);
+    stats.peak_message_bytes = peak_message_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MessageArena::addBlock(std::size_t min_size) {
+    std::size_t size = std::max(min_size, block_size_);
+    char* data = static_cast<char*>(std::malloc(size));
+    if (!data) throw std::bad_alloc();
+    blocks_.push_back(Block{data, size});
+    heap_blocks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+ArenaScope::ArenaScope(MessageArena& arena)
+    : arena_(arena), previous_(current_arena) {
+    current_arena = &arena_;
+    ++arena_.scopes_;
+}
+
+ArenaScope::~ArenaScope() {
+    current_arena = previous_;
+    if (--arena_.scopes_ == 0) arena_.reset();
+}
@@ -0,0 +1,121 @@
+#ifndef MESSAGE_ARENA_H
+#define MESSAGE_ARENA_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counters are atomics so other threads can read them while the owner parses
+struct ArenaStats {
+    uint64_t messages = 0;           // resets, i.e. messages dispatched
+    uint64_t allocations = 0;        // allocations served from the arena
+    uint64_t bytes = 0;              // bytes served from the arena
+    uint64_t heap_blocks = 0;        // blocks the arena itself had to malloc
+    uint64_t peak_message_bytes = 0; // largest single message footprint
+};
+
+// Monotonic bump allocator for the DOM of one message. Allocation is a
+// pointer bump, free is a no-op and reset() recycles everything at once. When
+// a message overflows the first block the blocks are merged on reset, so in
+// steady state the DOM's objects, arrays and nodes never touch malloc.
+// Strings longer than the small string buffer still do (see arena_json).
+// An arena belongs to one reading thread.
+class MessageArena {
+public:
+    explicit MessageArena(std::size_t block_size = 64 * 1024);
+    ~MessageArena();
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    bool owns(const void* p) const;
+    void reset();
+    ArenaStats stats() const;
+
+    // Arena that ArenaAllocator uses on this thread, or null for the heap
+    static MessageArena* current();
+
+private:
+    friend class ArenaScope;
+
+    struct Block {
+        char* data;
+        std::size_t size;
+    };
+
+    void addBlock(std::size_t min_size);
+
+    std::vector<Block> blocks_;
+    std::size_t block_size_;
+    std::size_t current_ = 0;      // block being bumped
+    std::size_t offset_ = 0;       // bump offset within it
+    std::size_t message_bytes_ = 0;
+    int scopes_ = 0;               // open ArenaScopes; the outermost resets
+
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> heap_blocks_{0};
+    std::atomic<uint64_t> peak_message_bytes_{0};
+};
+
+// Routes ArenaAllocator on this thread to arena for the scope's lifetime and
+// resets the arena when the outermost scope on it ends, so a handler that
+// reads another message while the first is still in use only adds to the
+// arena. Every value allocated inside must be destroyed before the outermost
+// scope closes.
+class ArenaScope {
+public:
+    explicit ArenaScope(MessageArena& arena);
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    MessageArena& arena_;
+    MessageArena* previous_;
+};
+
+// Stateless allocator (nlohmann default-constructs its allocators) that takes
+// memory from the thread's current arena and falls back to the heap when no
+// ArenaScope is active.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        if (MessageArena* arena = MessageArena::current()) {
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        MessageArena* arena = MessageArena::current();
+        if (arena && arena->owns(p)) return;
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+// JSON DOM whose objects, arrays and value nodes live in the current arena.
+// String payloads stay std::string so handlers can keep using get_ref<const
+// std::string&>; short keys and names fit the small string buffer, and longer
+// strings are allocated on the heap as usual.
+using arena_json = nlohmann::basic_json<std::map, std::vector, std::string, bool,
+                                        std::int64_t, std::uint64_t, double, ArenaAllocator>;
+
+#endif // MESSAGE_ARENA_H
@@ -0,0 +1,125 @@
+#include "metrics.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+const std::array<double, LatencyHistogram::kBuckets>& LatencyHistogram::bounds() {
+    static const std::array<double, kBuckets> upper = {
+        1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3,
+        5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+    };
+    return upper;
+}
+
+void LatencyHistogram::observe(double seconds) {
+    const auto& upper = bounds();
+    std::size_t i = static_cast<std::size_t>(
+        std::lower_bound(upper.begin(), upper.end(), seconds) - upper.begin());
+    if (i < kBuckets) {
+        buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9), std::memory_order_relaxed);
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    return *findOrCreate(Kind::Counter, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    return *findOrCreate(Kind::Gauge, name, help, labels).gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const std::string& labels) {
+    return *findOrCreate(Kind::Histogram, name, help, labels).histogram;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::findOrCreate(Kind kind, const std::string& name,
+                                                      const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t size = size_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < size; ++i) {
+        Entry& entry = entries_[i];
+        if (entry.name == name && entry.labels == labels) {
+            if (entry.kind != kind) throw std::logic_error("Metric registered with another type: " + name);
+            return entry;
+        }
+    }
+    if (size == kMaxEntries) throw std::length_error("Metrics registry is full");
+
+    Entry& entry = entries_[size];
+    entry.kind = kind;
+    entry.name = name;
+    entry.help = help;
+    entry.labels = labels;
+    switch (kind) {
+        case Kind::Counter: entry.counter.reset(new Counter()); break;
+        case Kind::Gauge: entry.gauge.reset(new Gauge()); break;
+        case Kind::Histogram: entry.histogram.reset(new LatencyHistogram()); break;
+    }
+    // Publish only after the entry is fully built
+    size_.store(size + 1, std::memory_order_release);
+    return entry;
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    const std::size_t size = size_.load(std::memory_order_acquire);
+    std::ostringstream out;
+    std::vector<bool> emitted(size, false);
+
+    auto series = [](const std::string& name, const std::string& labels, const std::string& extra) {
+        std::string joined = labels;
+        if (!extra.empty()) joined += (joined.empty() ? "" : ",") + extra;
+        return joined.empty() ? name : name + "{" + joined + "}";
+    };
+
+    // Group label sets of one metric under a single HELP/TYPE header
+    for (std::size_t i = 0; i < size; ++i) {
+        if (emitted[i]) continue;
+        const Entry& first = entries_[i];
+        const char* type = first.kind == Kind::Counter ? "counter"
+                         : first.kind == Kind::Gauge ? "gauge" : "histogram";
+        out << "# HELP " << first.name << " " << first.help << "\n";
+        out << "# TYPE " << first.name << " " << type << "\n";
+
+        for (std::size_t j = i; j < size; ++j) {
+            const Entry& entry = entries_[j];
+            if (emitted[j] || entry.name != first.name) continue;
+            emitted[j] = true;
+
+            switch (entry.kind) {
+                case Kind::Counter:
+                    out << series(entry.name, entry.labels, "") << " " << entry.counter->value() << "\n";
+                    break;
+                case Kind::Gauge:
+                    out << series(entry.name, entry.labels, "") << " " << entry.gauge->value() << "\n";
+                    break;
+                case Kind::Histogram: {
+                    const LatencyHistogram& h = *entry.histogram;
+                    const auto& upper = LatencyHistogram::bounds();
+                    uint64_t cumulative = 0;
+                    for (std::size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                        cumulative += h.bucketCount(b);
+                        std::ostringstream le;
+                        le << "le=\"" << upper[b] << "\"";
+                        out << series(entry.name + "_bucket", entry.labels, le.str()) << " " << cumulative << "\n";
+                    }
+                    uint64_t count = h.count();
+                    out << series(entry.name + "_bucket", entry.labels, "le=\"+Inf\"") << " "
+                        << std::max(count, cumulative) << "\n";
+                    out << series(entry.name + "_sum", entry.labels, "") << " " << h.sum() << "\n";
+                    out << series(entry.name + "_count", entry.labels, "") << " " << count << "\n";
+                    break;
+                }
+            }
+        }
+    }
+    return out.str();
+}
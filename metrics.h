@@ -0,0 +1,100 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Holds a gauge one higher for the lifetime of the scope (queue depth,
+// requests in flight)
+class GaugeScope {
+public:
+    explicit GaugeScope(Gauge& gauge) : gauge_(gauge) { gauge_.add(1); }
+    ~GaugeScope() { gauge_.add(-1); }
+    GaugeScope(const GaugeScope&) = delete;
+    GaugeScope& operator=(const GaugeScope&) = delete;
+
+private:
+    Gauge& gauge_;
+};
+
+// Fixed log-spaced buckets from 1us to 10s
+class LatencyHistogram {
+public:
+    static constexpr std::size_t kBuckets = 22;
+    static const std::array<double, kBuckets>& bounds();
+
+    void observe(double seconds);
+    uint64_t bucketCount(std::size_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return sum_ns_.load(std::memory_order_relaxed) / 1e9; }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+};
+
+// Process-wide registry. Metrics are created once (under a mutex) and then
+// updated with relaxed atomics from any thread. The entry table is append
+// only and published with a release store, so rendering reads it without
+// taking the lock.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // labels is Prometheus label syntax without braces, e.g. channel="book"
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // Prometheus text exposition format 0.0.4
+    std::string renderPrometheus() const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+
+    struct Entry {
+        Kind kind;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    static constexpr std::size_t kMaxEntries = 1024;
+
+    MetricsRegistry() = default;
+    Entry& findOrCreate(Kind kind, const std::string& name, const std::string& help, const std::string& labels);
+
+    std::mutex mutex_;
+    std::array<Entry, kMaxEntries> entries_;
+    std::atomic<std::size_t> size_{0};
+};
+
+#endif // METRICS_H
@@ -0,0 +1,120 @@
+#include "metrics_server.h"
+#include "metrics.h"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+void lowerThreadPriority() {
+#if defined(__linux__)
+    // Per-thread nice value on Linux
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+
+// One scrape connection. Reads are asynchronous and bounded by a deadline, so
+// a client that connects and sends nothing cannot hold up other scrapers.
+class MetricsSession : public std::enable_shared_from_this<MetricsSession> {
+public:
+    static constexpr std::chrono::seconds kTimeout{5};
+
+    explicit MetricsSession(tcp::socket socket) : stream_(std::move(socket)) {}
+
+    void run() {
+        stream_.expires_after(kTimeout);
+        http::async_read(stream_, buffer_, request_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) { self->onRead(ec); });
+    }
+
+private:
+    void onRead(beast::error_code ec) {
+        if (ec) {
+            if (ec != beast::error::timeout && ec != http::error::end_of_stream) {
+                std::cerr << "Error serving metrics: " << ec.message() << std::endl;
+            }
+            return;
+        }
+
+        response_.version(request_.version());
+        response_.keep_alive(false);
+        response_.set(http::field::server, "deribit-trader");
+        if (request_.method() == http::verb::get
+            && (request_.target() == "/metrics" || request_.target() == "/")) {
+            response_.result(http::status::ok);
+            response_.set(http::field::content_type, "text/plain; version=0.0.4");
+            response_.body() = MetricsRegistry::instance().renderPrometheus();
+        } else {
+            response_.result(http::status::not_found);
+            response_.set(http::field::content_type, "text/plain");
+            response_.body() = "Not found\n";
+        }
+        response_.prepare_payload();
+
+        stream_.expires_after(kTimeout);
+        http::async_write(stream_, response_,
+            [self = shared_from_this()](beast::error_code, std::size_t) {
+                beast::error_code ignored;
+                self->stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+            });
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+};
+
+} // namespace
+
+MetricsServer::MetricsServer(uint16_t port, const std::string& address)
+    : port_(port), address_(address) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    try {
+        tcp::endpoint endpoint(boost::asio::ip::make_address(address_), port_);
+        acceptor_.reset(new tcp::acceptor(ioc_, endpoint));
+        port_ = acceptor_->local_endpoint().port();
+        accept();
+        thread_ = std::thread([this]() {
+            lowerThreadPriority();
+            ioc_.run();
+        });
+        std::cout << "Metrics available at http://" << address_ << ":" << port_ << "/metrics" << std::endl;
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error starting metrics server: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void MetricsServer::stop() {
+    ioc_.stop();
+    if (thread_.joinable()) thread_.join();
+    acceptor_.reset();
+}
+
+void MetricsServer::accept() {
+    acceptor_->async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (!ec) std::make_shared<MetricsSession>(std::move(socket))->run();
+        if (acceptor_ && acceptor_->is_open()) accept();
+    });
+}
@@ -0,0 +1,33 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Serves MetricsRegistry in Prometheus text format on GET /metrics.
+// Runs its own io_context on a background thread at the lowest scheduling
+// priority so scrapes never compete with the trading threads.
+class MetricsServer {
+public:
+    explicit MetricsServer(uint16_t port, const std::string& address = "127.0.0.1");
+    ~MetricsServer();
+
+    // Bind and start serving; false if the port could not be opened
+    bool start();
+    void stop();
+    uint16_t port() const { return port_; }
+
+private:
+    void accept();
+
+    uint16_t port_;
+    std::string address_;
+    boost::asio::io_context ioc_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    std::thread thread_;
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,340 @@
+#include "options_analytics.h"
+#include "black76.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+
+constexpr double kMillisPerYear = 365.0 * 24.0 * 3600.0 * 1000.0;
+// Below this many dirty strikes the thread hand-off costs more than it saves
+constexpr std::size_t kParallelThreshold = 512;
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+} // namespace
+
+void OptionsAnalyticsEngine::Scratch::resize(std::size_t n) {
+    rows.resize(n);
+    for (auto* column : {&forward, &strike, &expiry, &sign, &price, &iv, &delta, &gamma, &vega}) {
+        column->resize(n);
+    }
+}
+
+OptionsAnalyticsEngine::OptionsAnalyticsEngine(std::size_t max_workers)
+    : max_workers_(max_workers > 0 ? max_workers : std::max(1u, std::thread::hardware_concurrency())) {}
+
+OptionsAnalyticsEngine::~OptionsAnalyticsEngine() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stopping_ = true;
+    }
+    round_cv_.notify_all();
+    for (std::thread& thread : pool_) thread.join();
+}
+
+void OptionsAnalyticsEngine::loadInstruments(const json& instruments) {
+    struct Row {
+        std::string name;
+        std::string currency;
+        int64_t expiration_ms;
+        double strike;
+        double call_sign;
+        bool inverse;
+    };
+
+    try {
+        std::vector<Row> rows;
+        for (const auto& inst : instruments) {
+            if (inst.value("kind", "option") != "option" || !inst.contains("strike")) continue;
+            Row row;
+            row.name = inst.value("instrument_name", "");
+            row.currency = inst.value("base_currency", "");
+            row.expiration_ms = inst.value("expiration_timestamp", int64_t{0});
+            row.strike = inst["strike"].get<double>();
+            row.call_sign = inst.value("option_type", "call") == "put" ? -1.0 : 1.0;
+            row.inverse = inst.value("settlement_currency", row.currency) == row.currency;
+            if (!row.name.empty() && !row.currency.empty()) rows.push_back(std::move(row));
+        }
+
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            if (a.currency != b.currency) return a.currency < b.currency;
+            if (a.expiration_ms != b.expiration_ms) return a.expiration_ms < b.expiration_ms;
+            if (a.strike != b.strike) return a.strike < b.strike;
+            return a.call_sign > b.call_sign;
+        });
+
+        // Rows are grouped by currency; each one met is rebuilt from scratch
+        std::vector<Chain*> rebuilt;
+        for (const Row& row : rows) {
+            if (rebuilt.empty() || rebuilt.back()->currency != row.currency) {
+                auto old = chains_.find(row.currency);
+                if (old != chains_.end()) {
+                    Chain* stale = &old->second;
+                    for (const std::string& name : stale->names) by_instrument_.erase(name);
+                    by_index_.erase(stale->index_name);
+                    dirty_slices_.erase(std::remove_if(dirty_slices_.begin(), dirty_slices_.end(),
+                                                       [stale](const Work& w) { return w.chain == stale; }),
+                                        dirty_slices_.end());
+                    chains_.erase(old);
+                }
+                Chain& chain = chains_[row.currency];
+                chain.currency = row.currency;
+                chain.index_name = row.currency + "_usd";
+                std::transform(chain.index_name.begin(), chain.index_name.end(), chain.index_name.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                rebuilt.push_back(&chain);
+            }
+            Chain& chain = *rebuilt.back();
+            std::size_t index = chain.names.size();
+            if (chain.expiries.empty() || chain.expiries.back().expiration_ms != row.expiration_ms) {
+                ExpirySlice slice;
+                slice.expiration_ms = row.expiration_ms;
+                slice.begin = index;
+                chain.expiries.push_back(std::move(slice));
+            }
+            chain.expiries.back().end = index + 1;
+
+            chain.names.push_back(row.name);
+            chain.slice.push_back(static_cast<uint32_t>(chain.expiries.size() - 1));
+            chain.expiration_ms.push_back(row.expiration_ms);
+            chain.strike.push_back(row.strike);
+            chain.call_sign.push_back(row.call_sign);
+            chain.inverse.push_back(row.inverse ? 1 : 0);
+        }
+
+        for (Chain* rebuilt_chain : rebuilt) {
+            Chain& chain = *rebuilt_chain;
+            std::size_t n = chain.names.size();
+            chain.mark_price.assign(n, kNaN);
+            chain.forward.assign(n, 0.0);
+            chain.basis.assign(n, 1.0);
+            chain.iv.assign(n, kNaN);
+            chain.delta.assign(n, kNaN);
+            chain.gamma.assign(n, kNaN);
+            chain.vega.assign(n, kNaN);
+            chain.dirty.assign(n, 0);
+            for (ExpirySlice& slice : chain.expiries) {
+                slice.scratch.resize(slice.end - slice.begin);
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                by_instrument_[chain.names[i]] = Location{&chain, i};
+            }
+            by_index_[chain.index_name] = &chain;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error loading option instruments: " << e.what() << std::endl;
+    }
+}
+
+template <typename Json>
+void OptionsAnalyticsEngine::handleTicker(const Json& data) {
+    try {
+        if (!data.contains("instrument_name")) return;
+        auto it = by_instrument_.find(data["instrument_name"].template get_ref<const std::string&>());
+        if (it == by_instrument_.end()) return;
+
+        Chain& chain = *it->second.chain;
+        std::size_t row = it->second.row;
+        if (data.contains("mark_price") && data["mark_price"].is_number()) {
+            chain.mark_price[row] = data["mark_price"].template get<double>();
+        }
+        if (data.contains("underlying_price") && data["underlying_price"].is_number()) {
+            chain.forward[row] = data["underlying_price"].template get<double>();
+        }
+        double index_price = data.contains("index_price") && data["index_price"].is_number()
+            ? data["index_price"].template get<double>() : chain.index_price;
+        if (index_price > 0.0 && chain.forward[row] > 0.0) {
+            chain.basis[row] = chain.forward[row] / index_price;
+        }
+        markDirty(chain, row, kQuoteChanged);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling option ticker: " << e.what() << std::endl;
+    }
+}
+
+template <typename Json>
+void OptionsAnalyticsEngine::handleIndexPrice(const Json& data) {
+    try {
+        if (!data.contains("index_name") || !data.contains("price")) return;
+        auto it = by_index_.find(data["index_name"].template get_ref<const std::string&>());
+        if (it == by_index_.end()) return;
+
+        Chain& chain = *it->second;
+        chain.index_price = data["price"].template get<double>();
+
+        // Carry each strike's last observed basis onto the new index level;
+        // only strikes that already have a vol need their greeks refreshed.
+        const std::size_t n = chain.names.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            chain.forward[i] = chain.index_price * chain.basis[i];
+            if (!std::isnan(chain.iv[i])) markDirty(chain, i, kForwardChanged);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling index price: " << e.what() << std::endl;
+    }
+}
+
+template void OptionsAnalyticsEngine::handleTicker<json>(const json&);
+template void OptionsAnalyticsEngine::handleTicker<arena_json>(const arena_json&);
+template void OptionsAnalyticsEngine::handleIndexPrice<json>(const json&);
+template void OptionsAnalyticsEngine::handleIndexPrice<arena_json>(const arena_json&);
+
+void OptionsAnalyticsEngine::markDirty(Chain& chain, std::size_t row, uint8_t flags) {
+    if (chain.dirty[row] == 0) {
+        ExpirySlice& slice = chain.expiries[chain.slice[row]];
+        if (slice.dirty++ == 0) dirty_slices_.push_back(Work{&chain, &slice});
+    }
+    chain.dirty[row] |= flags;
+}
+
+std::size_t OptionsAnalyticsEngine::revalue(int64_t now_ms) {
+    std::size_t total = 0;
+    for (const Work& item : dirty_slices_) total += item.slice->dirty;
+    if (total == 0) return 0;
+
+    std::size_t workers = std::min(max_workers_, dirty_slices_.size());
+    if (workers <= 1 || total < kParallelThreshold) {
+        for (Work& item : dirty_slices_) revalueSlice(*item.chain, *item.slice, now_ms);
+        dirty_slices_.clear();
+        return total;
+    }
+
+    // Expiries are independent: hand them out largest first to the least
+    // loaded worker, run bucket 0 on this thread and the rest on the pool.
+    std::sort(dirty_slices_.begin(), dirty_slices_.end(),
+              [](const Work& a, const Work& b) { return a.slice->dirty > b.slice->dirty; });
+    std::vector<std::size_t> load(workers, 0);
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        while (pool_.size() + 1 < max_workers_) {
+            pool_.emplace_back(&OptionsAnalyticsEngine::runPool, this, pool_.size() + 1);
+        }
+        buckets_.resize(workers);
+        for (auto& bucket : buckets_) bucket.clear();
+        for (const Work& item : dirty_slices_) {
+            std::size_t target = static_cast<std::size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+            buckets_[target].push_back(item);
+            load[target] += item.slice->dirty;
+        }
+        round_now_ms_ = now_ms;
+        busy_ = workers - 1;
+        ++round_;
+    }
+    round_cv_.notify_all();
+
+    for (const Work& item : buckets_[0]) revalueSlice(*item.chain, *item.slice, now_ms);
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    done_cv_.wait(lock, [this]() { return busy_ == 0; });
+    dirty_slices_.clear();
+    return total;
+}
+
+// Pool thread index (from 1) runs buckets_[index] once per round; threads
+// beyond this round's bucket count sit it out
+void OptionsAnalyticsEngine::runPool(std::size_t index) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    for (;;) {
+        round_cv_.wait(lock, [this, &seen]() { return stopping_ || round_ != seen; });
+        if (stopping_) return;
+        seen = round_;
+        if (index >= buckets_.size()) continue;
+        int64_t now_ms = round_now_ms_;
+        lock.unlock();
+        for (const Work& item : buckets_[index]) revalueSlice(*item.chain, *item.slice, now_ms);
+        lock.lock();
+        if (--busy_ == 0) done_cv_.notify_one();
+    }
+}
+
+void OptionsAnalyticsEngine::revalueSlice(Chain& chain, ExpirySlice& slice, int64_t now_ms) {
+    Scratch& s = slice.scratch;
+    const double expiry_years = static_cast<double>(slice.expiration_ms - now_ms) / kMillisPerYear;
+
+    slice.dirty = 0;
+    if (!(expiry_years > 0.0)) {
+        for (std::size_t i = slice.begin; i < slice.end; ++i) {
+            chain.iv[i] = chain.delta[i] = chain.gamma[i] = chain.vega[i] = kNaN;
+            chain.dirty[i] = 0;
+        }
+        return;
+    }
+
+    // Implied vol for strikes with a new mark price
+    std::size_t n = 0;
+    for (std::size_t i = slice.begin; i < slice.end; ++i) {
+        if (!(chain.dirty[i] & kQuoteChanged)) continue;
+        s.rows[n] = i;
+        s.forward[n] = chain.forward[i];
+        s.strike[n] = chain.strike[i];
+        s.expiry[n] = expiry_years;
+        s.sign[n] = chain.call_sign[i];
+        s.price[n] = chain.inverse[i] ? chain.mark_price[i] * chain.forward[i] : chain.mark_price[i];
+        s.iv[n] = std::isnan(chain.iv[i]) ? 0.0 : chain.iv[i];
+        ++n;
+    }
+    if (n > 0) {
+        black76::impliedVolBatch(s.forward.data(), s.strike.data(), s.expiry.data(), s.sign.data(),
+                                 s.price.data(), s.iv.data(), n);
+        for (std::size_t j = 0; j < n; ++j) chain.iv[s.rows[j]] = s.iv[j];
+    }
+
+    // Greeks for everything that changed
+    n = 0;
+    for (std::size_t i = slice.begin; i < slice.end; ++i) {
+        if (!chain.dirty[i]) continue;
+        s.rows[n] = i;
+        s.forward[n] = chain.forward[i];
+        s.strike[n] = chain.strike[i];
+        s.expiry[n] = expiry_years;
+        s.sign[n] = chain.call_sign[i];
+        s.iv[n] = chain.iv[i];
+        chain.dirty[i] = 0;
+        ++n;
+    }
+    black76::greeksBatch(s.forward.data(), s.strike.data(), s.expiry.data(), s.sign.data(), s.iv.data(),
+                         s.delta.data(), s.gamma.data(), s.vega.data(), n);
+    for (std::size_t j = 0; j < n; ++j) {
+        std::size_t i = s.rows[j];
+        chain.delta[i] = s.delta[j];
+        chain.gamma[i] = s.gamma[j];
+        chain.vega[i] = s.vega[j];
+    }
+}
+
+bool OptionsAnalyticsEngine::greeks(const std::string& instrument_name, OptionGreeks& out) const {
+    auto it = by_instrument_.find(instrument_name);
+    if (it == by_instrument_.end()) return false;
+    const Chain& chain = *it->second.chain;
+    std::size_t row = it->second.row;
+    out.forward = chain.forward[row];
+    out.iv = chain.iv[row];
+    out.delta = chain.delta[row];
+    out.gamma = chain.gamma[row];
+    out.vega = chain.vega[row];
+    return !std::isnan(out.iv);
+}
+
+std::vector<std::string> OptionsAnalyticsEngine::instruments(const std::string& currency) const {
+    auto it = chains_.find(currency);
+    return it == chains_.end() ? std::vector<std::string>() : it->second.names;
+}
+
+std::vector<std::string> OptionsAnalyticsEngine::channels(const std::string& currency,
+                                                          const std::string& interval) const {
+    std::vector<std::string> result;
+    auto it = chains_.find(currency);
+    if (it == chains_.end()) return result;
+    result.reserve(it->second.names.size() + 1);
+    result.push_back("deribit_price_index." + it->second.index_name);
+    for (const std::string& name : it->second.names) {
+        result.push_back("ticker." + name + "." + interval);
+    }
+    return result;
+}
@@ -0,0 +1,137 @@
+#ifndef OPTIONS_ANALYTICS_H
+#define OPTIONS_ANALYTICS_H
+
+#include "message_arena.h"
+#include <nlohmann/json.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct OptionGreeks {
+    double forward = 0.0;
+    double iv = 0.0;
+    double delta = 0.0;
+    double gamma = 0.0;
+    double vega = 0.0;   // per vol point
+};
+
+// Keeps a structure-of-arrays options chain per underlying (ordered by expiry,
+// then strike) and revalues implied vol and greeks with the batch Black-76
+// kernels. Ticker updates mark a strike for a new implied vol solve, index
+// updates move the forwards and mark strikes for greeks only; revalue()
+// visits only the expiries holding marked strikes, so it is cheap enough to
+// call after every update. Large rounds are spread across a pool of worker
+// threads started on first use and kept for the engine's lifetime.
+class OptionsAnalyticsEngine {
+public:
+    // max_workers of 0 uses std::thread::hardware_concurrency()
+    explicit OptionsAnalyticsEngine(std::size_t max_workers = 0);
+    ~OptionsAnalyticsEngine();
+    OptionsAnalyticsEngine(const OptionsAnalyticsEngine&) = delete;
+    OptionsAnalyticsEngine& operator=(const OptionsAnalyticsEngine&) = delete;
+
+    // instruments is the "result" array of public/get_instruments with kind=option.
+    // Rebuilds the chains of the currencies it contains; other chains are kept.
+    void loadInstruments(const json& instruments);
+
+    // data is the "params.data" object of a ticker.* notification
+    template <typename Json>
+    void handleTicker(const Json& data);
+    // data is the "params.data" object of a deribit_price_index.* notification
+    template <typename Json>
+    void handleIndexPrice(const Json& data);
+
+    // Recompute every strike whose inputs changed; returns how many were revalued
+    std::size_t revalue(int64_t now_ms);
+
+    bool greeks(const std::string& instrument_name, OptionGreeks& out) const;
+    std::size_t optionCount() const { return by_instrument_.size(); }
+    // Options of one underlying, by expiry then strike
+    std::vector<std::string> instruments(const std::string& currency) const;
+    // Channels to subscribe to for one underlying (tickers plus its index)
+    std::vector<std::string> channels(const std::string& currency, const std::string& interval) const;
+
+private:
+    enum DirtyFlags : uint8_t {
+        kQuoteChanged = 1,     // new mark price, solve implied vol again
+        kForwardChanged = 2    // forward moved, greeks only
+    };
+
+    // Gather buffers for one expiry, sized once at load so revalue never allocates
+    struct Scratch {
+        std::vector<std::size_t> rows;
+        std::vector<double> forward, strike, expiry, sign, price, iv, delta, gamma, vega;
+        void resize(std::size_t n);
+    };
+
+    struct ExpirySlice {
+        int64_t expiration_ms = 0;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::size_t dirty = 0;          // marked rows; listed in dirty_slices_ while nonzero
+        Scratch scratch;
+    };
+
+    struct Chain {
+        std::string currency;
+        std::string index_name;
+        double index_price = 0.0;
+        std::vector<ExpirySlice> expiries;
+
+        std::vector<std::string> names;
+        std::vector<uint32_t> slice;     // index into expiries
+        std::vector<int64_t> expiration_ms;
+        std::vector<double> strike;
+        std::vector<double> call_sign;
+        std::vector<uint8_t> inverse;    // premium quoted in the base currency
+        std::vector<double> mark_price;
+        std::vector<double> forward;
+        std::vector<double> basis;       // forward / index at the last ticker
+        std::vector<double> iv;
+        std::vector<double> delta;
+        std::vector<double> gamma;
+        std::vector<double> vega;
+        std::vector<uint8_t> dirty;
+    };
+
+    struct Location {
+        Chain* chain;
+        std::size_t row;
+    };
+
+    struct Work {
+        Chain* chain;
+        ExpirySlice* slice;
+    };
+
+    void markDirty(Chain& chain, std::size_t row, uint8_t flags);
+    void revalueSlice(Chain& chain, ExpirySlice& slice, int64_t now_ms);
+    void runPool(std::size_t index);
+
+    std::size_t max_workers_;
+    std::unordered_map<std::string, Chain> chains_;          // by base currency
+    std::unordered_map<std::string, Location> by_instrument_;
+    std::unordered_map<std::string, Chain*> by_index_;       // e.g. "btc_usd"
+    std::vector<Work> dirty_slices_;
+
+    // Worker pool: thread i runs buckets_[i] of each round; the calling
+    // thread runs bucket 0 and waits for the rest
+    std::vector<std::thread> pool_;
+    std::mutex pool_mutex_;
+    std::condition_variable round_cv_;      // a round started, or stopping_
+    std::condition_variable done_cv_;       // busy_ reached zero
+    std::vector<std::vector<Work>> buckets_;
+    uint64_t round_ = 0;
+    std::size_t busy_ = 0;
+    int64_t round_now_ms_ = 0;
+    bool stopping_ = false;
+};
+
+#endif // OPTIONS_ANALYTICS_H
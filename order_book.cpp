@@ -0,0 +1,80 @@
+#include "order_book.h"
+#include <algorithm>
+#include <functional>
+
+OrderBook::OrderBook(std::size_t reserve_levels) {
+    bids_.prices.reserve(reserve_levels);
+    bids_.sizes.reserve(reserve_levels);
+    asks_.prices.reserve(reserve_levels);
+    asks_.sizes.reserve(reserve_levels);
+}
+
+void OrderBook::clear() {
+    for (Levels* side : {&bids_, &asks_}) {
+        side->prices.clear();
+        side->sizes.clear();
+        touch(*side, 0);
+    }
+    change_id_ = 0;
+    timestamp_ = 0;
+}
+
+void OrderBook::setLevel(BookSide side, double price, double size) {
+    Levels& book_side = levels(side);
+    auto& prices = book_side.prices;
+
+    auto it = side == BookSide::Bid
+        ? std::lower_bound(prices.begin(), prices.end(), price, std::greater<double>())
+        : std::lower_bound(prices.begin(), prices.end(), price);
+    std::size_t index = static_cast<std::size_t>(it - prices.begin());
+    bool exists = it != prices.end() && *it == price;
+
+    if (size <= 0.0) {
+        if (!exists) return;
+        prices.erase(it);
+        book_side.sizes.erase(book_side.sizes.begin() + index);
+    } else if (exists) {
+        book_side.sizes[index] = size;
+    } else {
+        prices.insert(it, price);
+        book_side.sizes.insert(book_side.sizes.begin() + index, size);
+    }
+    touch(book_side, index);
+}
+
+double OrderBook::sizeAt(BookSide side, double price) const {
+    const Levels& book_side = levels(side);
+    const auto& prices = book_side.prices;
+    auto it = side == BookSide::Bid
+        ? std::lower_bound(prices.begin(), prices.end(), price, std::greater<double>())
+        : std::lower_bound(prices.begin(), prices.end(), price);
+    if (it == prices.end() || *it != price) return 0.0;
+    return book_side.sizes[static_cast<std::size_t>(it - prices.begin())];
+}
+
+double OrderBook::bestPrice(BookSide side) const {
+    const Levels& book_side = levels(side);
+    return book_side.prices.empty() ? 0.0 : book_side.prices.front();
+}
+
+double OrderBook::bestSize(BookSide side) const {
+    const Levels& book_side = levels(side);
+    return book_side.sizes.empty() ? 0.0 : book_side.sizes.front();
+}
+
+std::size_t OrderBook::dirtyFrom(BookSide side) const {
+    const Levels& book_side = levels(side);
+    return book_side.dirty ? book_side.dirty_from : book_side.prices.size();
+}
+
+void OrderBook::markClean() {
+    bids_.dirty = false;
+    asks_.dirty = false;
+}
+
+void OrderBook::touch(Levels& side, std::size_t index) {
+    if (!side.dirty || index < side.dirty_from) {
+        side.dirty_from = index;
+    }
+    side.dirty = true;
+}
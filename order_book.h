@@ -0,0 +1,60 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class BookSide { Bid, Ask };
+
+// Price levels for one instrument kept as contiguous, sorted price/size
+// arrays (bids descending, asks ascending) so analytics can run straight over
+// them. Tracks the shallowest level touched since the last markClean() so
+// consumers only recompute what changed.
+class OrderBook {
+public:
+    explicit OrderBook(std::size_t reserve_levels = 256);
+
+    void clear();
+
+    // A size of zero (or less) removes the level
+    void setLevel(BookSide side, double price, double size);
+
+    std::size_t depth(BookSide side) const { return levels(side).prices.size(); }
+    const double* prices(BookSide side) const { return levels(side).prices.data(); }
+    const double* sizes(BookSide side) const { return levels(side).sizes.data(); }
+
+    // Zero when the side is empty
+    double bestPrice(BookSide side) const;
+    double bestSize(BookSide side) const;
+    // Size resting at exactly price; zero when there is no such level
+    double sizeAt(BookSide side, double price) const;
+
+    int64_t changeId() const { return change_id_; }
+    void setChangeId(int64_t change_id) { change_id_ = change_id; }
+    int64_t timestamp() const { return timestamp_; }
+    void setTimestamp(int64_t timestamp) { timestamp_ = timestamp; }
+
+    // Index of the shallowest level changed since markClean(); depth() when untouched
+    std::size_t dirtyFrom(BookSide side) const;
+    void markClean();
+
+private:
+    struct Levels {
+        std::vector<double> prices;
+        std::vector<double> sizes;
+        std::size_t dirty_from = 0;
+        bool dirty = false;
+    };
+
+    Levels& levels(BookSide side) { return side == BookSide::Bid ? bids_ : asks_; }
+    const Levels& levels(BookSide side) const { return side == BookSide::Bid ? bids_ : asks_; }
+    static void touch(Levels& side, std::size_t index);
+
+    Levels bids_;
+    Levels asks_;
+    int64_t change_id_ = 0;
+    int64_t timestamp_ = 0;
+};
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,324 @@
+#include "order_book_engine.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+OrderBookEngine::OrderBookEngine(std::size_t analytics_levels)
+    : analytics_levels_(analytics_levels) {}
+
+template <typename Json>
+BookUpdateResult OrderBookEngine::applyNotification(const Json& data) {
+    try {
+        if (!data.contains("instrument_name")) return BookUpdateResult::Ignored;
+
+        BookEntry& entry = entryFor(data["instrument_name"].template get_ref<const std::string&>());
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        int64_t change_id = data.value("change_id", int64_t{0});
+
+        // Incremental channels send "snapshot" then "change" messages linked by
+        // prev_change_id; grouped channels send full books without a type.
+        bool is_snapshot = !data.contains("prev_change_id")
+            || (data.contains("type") && data["type"] == "snapshot");
+
+        if (is_snapshot) {
+            entry.book.clear();
+        } else {
+            int64_t prev_change_id = data["prev_change_id"].template get<int64_t>();
+            // Already covered by a snapshot fetched after this change was sent
+            if (entry.in_sync && change_id <= entry.book.changeId()) return BookUpdateResult::Ignored;
+            if (!entry.in_sync || prev_change_id != entry.book.changeId()) {
+                entry.in_sync = false;
+                return BookUpdateResult::Gap;
+            }
+        }
+
+        if (data.contains("bids")) applyLevels(entry.book, BookSide::Bid, data["bids"]);
+        if (data.contains("asks")) applyLevels(entry.book, BookSide::Ask, data["asks"]);
+        entry.book.setChangeId(change_id);
+        entry.book.setTimestamp(data.value("timestamp", int64_t{0}));
+        entry.in_sync = true;
+        entry.confirmed = true;
+        entry.analytics.refresh(entry.book);
+
+        return is_snapshot ? BookUpdateResult::Snapshot : BookUpdateResult::Applied;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error applying order book notification: " << e.what() << std::endl;
+        return BookUpdateResult::Ignored;
+    }
+}
+
+template BookUpdateResult OrderBookEngine::applyNotification<json>(const json&);
+template BookUpdateResult OrderBookEngine::applyNotification<arena_json>(const arena_json&);
+
+BookUpdateResult OrderBookEngine::applySnapshot(const json& result) {
+    // get_order_book replies carry the same fields as a snapshot notification
+    // minus prev_change_id, so the notification path handles them as is.
+    return applyNotification(result);
+}
+
+namespace {
+
+constexpr char kCheckpointMagic[8] = {'D', 'O', 'B', 'K', 'C', 'K', 'P', 'T'};
+constexpr uint32_t kCheckpointVersion = 1;
+
+// FNV-1a, to reject a file that was cut short or overwritten in place
+uint64_t checksum(const char* data, std::size_t size) {
+    uint64_t hash = 1469598103934665603ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Bounds-checked reads from a checkpoint image
+class CheckpointCursor {
+public:
+    CheckpointCursor(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (size_ - offset_ < sizeof(T)) return false;
+        std::memcpy(&value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+    bool get(std::vector<double>& values, std::size_t count) {
+        if ((size_ - offset_) / sizeof(double) < count) return false;
+        values.resize(count);
+        if (count) std::memcpy(values.data(), data_ + offset_, count * sizeof(double));
+        offset_ += count * sizeof(double);
+        return true;
+    }
+
+    bool get(std::string& text, std::size_t length) {
+        if (size_ - offset_ < length) return false;
+        text.assign(data_ + offset_, length);
+        offset_ += length;
+        return true;
+    }
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t offset_ = 0;
+};
+
+int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// magic, version, book count, saved-at ms, then per book: name length, name,
+// change_id, timestamp, bid depth, ask depth, bid prices, bid sizes, ask
+// prices, ask sizes; then a checksum of everything before it
+std::string OrderBookEngine::serializeCheckpoint() const {
+    std::string image(kCheckpointMagic, sizeof(kCheckpointMagic));
+    put(image, kCheckpointVersion);
+    std::size_t count_offset = image.size();
+    put(image, uint32_t{0});
+    put(image, wallClockMs());
+
+    uint32_t count = 0;
+    std::shared_lock<std::shared_mutex> books_lock(books_mutex_);
+    for (const auto& entry : books_) {
+        std::lock_guard<std::mutex> lock(entry.second.mutex);
+        const OrderBook& book = entry.second.book;
+        if (!entry.second.in_sync || !entry.second.confirmed) continue;
+        put(image, static_cast<uint16_t>(entry.first.size()));
+        image.append(entry.first);
+        put(image, book.changeId());
+        put(image, book.timestamp());
+        auto bids = static_cast<uint32_t>(book.depth(BookSide::Bid));
+        auto asks = static_cast<uint32_t>(book.depth(BookSide::Ask));
+        put(image, bids);
+        put(image, asks);
+        image.append(reinterpret_cast<const char*>(book.prices(BookSide::Bid)), bids * sizeof(double));
+        image.append(reinterpret_cast<const char*>(book.sizes(BookSide::Bid)), bids * sizeof(double));
+        image.append(reinterpret_cast<const char*>(book.prices(BookSide::Ask)), asks * sizeof(double));
+        image.append(reinterpret_cast<const char*>(book.sizes(BookSide::Ask)), asks * sizeof(double));
+        ++count;
+    }
+    std::memcpy(&image[count_offset], &count, sizeof(count));
+    put(image, checksum(image.data(), image.size()));
+    return image;
+}
+
+// The image is synced before the rename, or a crash could leave the new name
+// pointing at a file whose data never reached the disk, and the directory
+// after it, so the rename itself survives
+bool OrderBookEngine::writeCheckpointFile(const std::string& path, const std::string& image) {
+    std::string temporary = path + ".tmp";
+#ifndef _WIN32
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0;
+    for (std::size_t done = 0; written && done < image.size();) {
+        ssize_t n = ::write(fd, image.data() + done, image.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        written = n > 0;
+        if (written) done += static_cast<std::size_t>(n);
+    }
+    written = written && ::fsync(fd) == 0;
+    if (fd >= 0 && ::close(fd) != 0) written = false;
+    if (!written) {
+        std::cerr << "Error writing order book checkpoint " << temporary << std::endl;
+        return false;
+    }
+#else
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out.flush()) {
+            std::cerr << "Error writing order book checkpoint " << temporary << std::endl;
+            return false;
+        }
+    }
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error replacing order book checkpoint " << path << std::endl;
+        return false;
+    }
+#ifndef _WIN32
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    bool synced = dir >= 0 && ::fsync(dir) == 0;
+    if (dir >= 0) ::close(dir);
+    if (!synced) {
+        std::cerr << "Error syncing the directory of order book checkpoint " << path << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+std::vector<std::string> OrderBookEngine::loadCheckpoint(const std::string& path, int64_t max_age_ms) {
+    std::vector<std::string> restored;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return restored;
+    std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    uint64_t stored_checksum = 0;
+    if (image.size() < sizeof(kCheckpointMagic) + sizeof(stored_checksum)
+        || std::memcmp(image.data(), kCheckpointMagic, sizeof(kCheckpointMagic)) != 0) {
+        std::cerr << "Ignoring order book checkpoint " << path << ": not a checkpoint file" << std::endl;
+        return restored;
+    }
+    std::size_t body = image.size() - sizeof(stored_checksum);
+    std::memcpy(&stored_checksum, image.data() + body, sizeof(stored_checksum));
+    if (stored_checksum != checksum(image.data(), body)) {
+        std::cerr << "Ignoring order book checkpoint " << path << ": checksum mismatch" << std::endl;
+        return restored;
+    }
+
+    CheckpointCursor cursor(image.data() + sizeof(kCheckpointMagic), body - sizeof(kCheckpointMagic));
+    uint32_t version = 0, count = 0;
+    int64_t saved_at_ms = 0;
+    if (!cursor.get(version) || version != kCheckpointVersion || !cursor.get(count) || !cursor.get(saved_at_ms)) {
+        std::cerr << "Ignoring order book checkpoint " << path << ": unsupported version" << std::endl;
+        return restored;
+    }
+    if (wallClockMs() - saved_at_ms > max_age_ms) {
+        std::cerr << "Ignoring order book checkpoint " << path << ": older than " << max_age_ms << " ms" << std::endl;
+        return restored;
+    }
+
+    std::vector<double> bid_prices, bid_sizes, ask_prices, ask_sizes;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t name_length = 0;
+        std::string name;
+        int64_t change_id = 0, timestamp = 0;
+        uint32_t bids = 0, asks = 0;
+        if (!cursor.get(name_length) || !cursor.get(name, name_length) || !cursor.get(change_id)
+            || !cursor.get(timestamp) || !cursor.get(bids) || !cursor.get(asks)
+            || !cursor.get(bid_prices, bids) || !cursor.get(bid_sizes, bids)
+            || !cursor.get(ask_prices, asks) || !cursor.get(ask_sizes, asks)) {
+            std::cerr << "Order book checkpoint " << path << " is truncated" << std::endl;
+            break;
+        }
+
+        BookEntry& entry = entryFor(name);
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        entry.book.clear();
+        for (uint32_t j = 0; j < bids; ++j) entry.book.setLevel(BookSide::Bid, bid_prices[j], bid_sizes[j]);
+        for (uint32_t j = 0; j < asks; ++j) entry.book.setLevel(BookSide::Ask, ask_prices[j], ask_sizes[j]);
+        entry.book.setChangeId(change_id);
+        entry.book.setTimestamp(timestamp);
+        entry.in_sync = true;
+        entry.confirmed = false;
+        entry.analytics.refresh(entry.book);
+        restored.push_back(std::move(name));
+    }
+    return restored;
+}
+
+const OrderBook* OrderBookEngine::book(const std::string& instrument_name) const {
+    std::shared_lock<std::shared_mutex> lock(books_mutex_);
+    auto it = books_.find(instrument_name);
+    return it == books_.end() ? nullptr : &it->second.book;
+}
+
+const BookAnalytics* OrderBookEngine::analytics(const std::string& instrument_name) const {
+    std::shared_lock<std::shared_mutex> lock(books_mutex_);
+    auto it = books_.find(instrument_name);
+    return it == books_.end() ? nullptr : &it->second.analytics;
+}
+
+bool OrderBookEngine::inSync(const std::string& instrument_name) const {
+    std::shared_lock<std::shared_mutex> lock(books_mutex_);
+    auto it = books_.find(instrument_name);
+    if (it == books_.end()) return false;
+    std::lock_guard<std::mutex> entry_lock(it->second.mutex);
+    return it->second.in_sync;
+}
+
+std::vector<std::string> OrderBookEngine::instruments() const {
+    std::vector<std::string> names;
+    std::shared_lock<std::shared_mutex> lock(books_mutex_);
+    names.reserve(books_.size());
+    for (const auto& entry : books_) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+OrderBookEngine::BookEntry& OrderBookEngine::entryFor(const std::string& instrument_name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(books_mutex_);
+        auto it = books_.find(instrument_name);
+        if (it != books_.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(books_mutex_);
+    return books_.try_emplace(instrument_name, analytics_levels_).first->second;
+}
+
+template <typename Json>
+void OrderBookEngine::applyLevels(OrderBook& book, BookSide side, const Json& levels) {
+    for (const auto& level : levels) {
+        // ["new"|"change"|"delete", price, amount] or [price, amount]
+        if (level.size() >= 3 && level[0].is_string()) {
+            double size = level[0] == "delete" ? 0.0 : level[2].template get<double>();
+            book.setLevel(side, level[1].template get<double>(), size);
+        } else if (level.size() >= 2) {
+            book.setLevel(side, level[0].template get<double>(), level[1].template get<double>());
+        }
+    }
+}
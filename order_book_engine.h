@@ -0,0 +1,76 @@
+#ifndef ORDER_BOOK_ENGINE_H
+#define ORDER_BOOK_ENGINE_H
+
+#include "order_book.h"
+#include "book_analytics.h"
+#include "message_arena.h"
+#include <nlohmann/json.hpp>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+enum class BookUpdateResult {
+    Applied,    // incremental change applied
+    Snapshot,   // book replaced by a full snapshot
+    Gap,        // change_id chain broken, book needs a fresh snapshot
+    Ignored     // malformed or unrelated message
+};
+
+// Maintains one OrderBook plus its BookAnalytics per instrument from book.*
+// notifications and get_order_book snapshots. Different instruments may be
+// updated from different threads at once (FeedPipeline workers); one
+// instrument's updates must come from one thread at a time. The pointers
+// returned by book() and analytics() are not synchronised with updates.
+class OrderBookEngine {
+public:
+    explicit OrderBookEngine(std::size_t analytics_levels = 100);
+
+    // data is the "params.data" object of a book.* notification (json or arena_json)
+    template <typename Json>
+    BookUpdateResult applyNotification(const Json& data);
+    // result is the "result" object of a public/get_order_book reply
+    BookUpdateResult applySnapshot(const json& result);
+
+    // Checkpoints for warm restarts: every in-sync book with its change_id,
+    // leaving out restored books the live feed has not confirmed yet (so a
+    // book's age is never reset by saving it again unseen). The image is
+    // built on the thread that applies updates; writing it out goes through
+    // a synced temporary file and a rename, so it can run elsewhere.
+    std::string serializeCheckpoint() const;
+    static bool writeCheckpointFile(const std::string& path, const std::string& image);
+    // Restore books from a checkpoint written less than max_age_ms ago. They
+    // count as in sync at their saved change_id, unconfirmed: the next change
+    // either continues the chain, confirming the book, or reports a Gap.
+    // Returns the instruments restored.
+    std::vector<std::string> loadCheckpoint(const std::string& path, int64_t max_age_ms);
+
+    const OrderBook* book(const std::string& instrument_name) const;
+    const BookAnalytics* analytics(const std::string& instrument_name) const;
+    bool inSync(const std::string& instrument_name) const;
+    std::vector<std::string> instruments() const;
+
+private:
+    struct BookEntry {
+        explicit BookEntry(std::size_t analytics_levels) : analytics(analytics_levels) {}
+
+        OrderBook book;
+        BookAnalytics analytics;
+        bool in_sync = false;
+        bool confirmed = false;     // a live change or snapshot applied since any restore
+        mutable std::mutex mutex;   // held while the book changes or is checkpointed
+    };
+
+    BookEntry& entryFor(const std::string& instrument_name);
+    template <typename Json>
+    static void applyLevels(OrderBook& book, BookSide side, const Json& levels);
+
+    std::size_t analytics_levels_;
+    mutable std::shared_mutex books_mutex_;     // the map itself; entries never move once added
+    std::unordered_map<std::string, BookEntry> books_;
+};
+
+#endif // ORDER_BOOK_ENGINE_H
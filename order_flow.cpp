@@ -0,0 +1,554 @@
+#include "order_flow.h"
+#include "trade_execution.h"
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace asio = boost::asio;
+
+namespace {
+
+// Prices on a tick, without the binary fraction noise Deribit rejects
+double onTick(double ticks, double tick) {
+    return std::round(ticks * tick * 1e8) / 1e8;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+void printRow(std::ostream& out, const char* name, uint64_t sent, uint64_t acked, uint64_t rejected,
+              std::vector<double> samples) {
+    out << std::left << std::setw(8) << name << std::right << std::setw(9) << sent << std::setw(9) << acked
+        << std::setw(10) << rejected;
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        out << std::fixed << std::setprecision(1) << std::setw(11) << percentile(samples, 0.50)
+            << std::setw(11) << percentile(samples, 0.90) << std::setw(11) << percentile(samples, 0.99)
+            << std::setw(11) << percentile(samples, 0.999) << std::setw(11) << samples.back();
+        out.unsetf(std::ios::floatfield);
+    }
+    out << "\n";
+}
+
+void printTable(std::ostream& out, const OrderFlowReport& report, const char* title,
+                std::vector<double> FlowActionStats::*samples) {
+    out << std::left << std::setw(8) << "action" << std::right << std::setw(9) << "sent" << std::setw(9) << "acked"
+        << std::setw(10) << "rejected" << std::setw(11) << "p50" << std::setw(11) << "p90" << std::setw(11) << "p99"
+        << std::setw(11) << "p99.9" << std::setw(11) << "max" << "  " << title << "\n";
+    std::vector<double> all;
+    uint64_t rejected = 0;
+    for (int i = 0; i < 3; ++i) {
+        const FlowActionStats& stats = report.actions[i];
+        printRow(out, flowActionName(static_cast<FlowAction>(i)), stats.sent, stats.acked, stats.rejected,
+                 stats.*samples);
+        all.insert(all.end(), (stats.*samples).begin(), (stats.*samples).end());
+        rejected += stats.rejected;
+    }
+    printRow(out, "all", report.sent(), report.acked(), rejected, std::move(all));
+}
+
+} // namespace
+
+const char* flowActionName(FlowAction action) {
+    switch (action) {
+        case FlowAction::Place: return "place";
+        case FlowAction::Modify: return "modify";
+        case FlowAction::Cancel: return "cancel";
+    }
+    return "unknown";
+}
+
+std::string OrderFlowSpec::describe() const {
+    std::ostringstream out;
+    out << (open_loop ? "open loop, " : "closed loop, ");
+    if (rate > 0.0) {
+        out << rate << (poisson ? " requests/s (Poisson)" : " requests/s");
+    } else {
+        out << "unpaced";
+    }
+    out << ", " << in_flight << (open_loop ? " in flight at most" : " sender(s)");
+    if (duration_seconds > 0.0) out << ", " << duration_seconds << " s";
+    if (count > 0) out << ", " << count << " requests";
+    if (!script.empty()) {
+        out << ", script " << script_path << " (" << script.size() << " steps)";
+        return out.str();
+    }
+    out << ", mix " << mix[0] << ":" << mix[1] << ":" << mix[2] << " over";
+    for (const auto& instrument : instruments) out << " " << instrument.name << ":" << instrument.weight;
+    return out.str();
+}
+
+OrderFlowSpec OrderFlowSpec::parse(const std::string& text) {
+    OrderFlowSpec spec;
+    auto number = [&text](const std::string& value, double low, double high) {
+        std::size_t used = 0;
+        double parsed = 0.0;
+        try {
+            parsed = std::stod(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != value.size() || !(parsed >= low && parsed <= high)) {
+            throw std::invalid_argument("Bad order flow setting in '" + text + "'");
+        }
+        return parsed;
+    };
+    auto split = [](const std::string& value) {
+        std::vector<std::string> parts;
+        std::stringstream in(value);
+        std::string part;
+        while (std::getline(in, part, ':')) parts.push_back(part);
+        return parts;
+    };
+
+    std::stringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : item.substr(equals + 1);
+        if (key == "rate") {
+            spec.rate = number(value, 0.0, 1e6);
+        } else if (key == "duration") {
+            spec.duration_seconds = number(value, 0.001, 86400.0);
+        } else if (key == "count") {
+            spec.count = static_cast<uint64_t>(number(value, 1.0, 1e12));
+        } else if (item == "open_loop") {
+            spec.open_loop = true;
+        } else if (item == "poisson") {
+            spec.poisson = true;
+        } else if (key == "in_flight") {
+            spec.in_flight = static_cast<int>(number(value, 1.0, 4096.0));
+        } else if (key == "instrument") {
+            std::vector<std::string> parts = split(value);
+            if (parts.empty() || parts[0].empty() || parts.size() > 3) {
+                throw std::invalid_argument("Bad instrument '" + value + "'");
+            }
+            FlowInstrument instrument;
+            instrument.name = parts[0];
+            if (parts.size() > 1) instrument.weight = number(parts[1], 1e-9, 1e9);
+            if (parts.size() > 2) instrument.tick = number(parts[2], 1e-9, 1e9);
+            spec.instruments.push_back(instrument);
+        } else if (key == "mix") {
+            std::vector<std::string> parts = split(value);
+            if (parts.size() != 3) throw std::invalid_argument("mix wants PLACE:MODIFY:CANCEL, got '" + value + "'");
+            for (int i = 0; i < 3; ++i) spec.mix[i] = number(parts[i], 0.0, 1e9);
+            if (spec.mix[0] <= 0.0) throw std::invalid_argument("mix needs some places to have orders to act on");
+        } else if (key == "amount") {
+            spec.amount = number(value, 1e-9, 1e12);
+        } else if (key == "distance") {
+            spec.distance = number(value, 0.0, 50.0) / 100.0;
+        } else if (key == "tick") {
+            spec.tick = number(value, 1e-9, 1e9);
+        } else if (key == "price") {
+            spec.reference_price = number(value, 1e-9, 1e12);
+        } else if (key == "seed") {
+            spec.seed = static_cast<uint64_t>(number(value, 0.0, 1e18));
+        } else if (key == "script" && !value.empty()) {
+            spec.script_path = value;
+        } else {
+            throw std::invalid_argument("Unknown order flow setting '" + item + "'");
+        }
+    }
+
+    if (!spec.script_path.empty()) {
+        std::ifstream in(spec.script_path);
+        if (!in) throw std::runtime_error("Cannot open order script " + spec.script_path);
+        spec.script = parseScript(in);
+        if (spec.script.empty()) throw std::invalid_argument("No steps in " + spec.script_path);
+    }
+    if (spec.instruments.empty()) spec.instruments.push_back(FlowInstrument{"BTC-PERPETUAL", 1.0, 0.0});
+    if (spec.duration_seconds <= 0.0 && spec.count == 0 && spec.script.empty()) spec.duration_seconds = 10.0;
+    return spec;
+}
+
+std::vector<FlowStep> OrderFlowSpec::parseScript(std::istream& in) {
+    std::vector<FlowStep> steps;
+    std::chrono::microseconds pending_delay{0};
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        std::istringstream words(line);
+        std::string verb;
+        if (!(words >> verb) || verb[0] == '#') continue;
+        auto bad = [&]() {
+            return std::invalid_argument("Bad order script line " + std::to_string(line_number) + ": " + line);
+        };
+
+        FlowStep step;
+        if (verb == "wait") {
+            double ms = 0.0;
+            if (!(words >> ms) || ms < 0.0) throw bad();
+            pending_delay += std::chrono::microseconds(static_cast<int64_t>(ms * 1000.0));
+            continue;
+        } else if (verb == "place") {
+            std::string side;
+            if (!(words >> step.instrument_name >> side >> step.amount >> step.price)) throw bad();
+            if (side != "buy" && side != "sell") throw bad();
+            if (step.amount <= 0.0 || step.price <= 0.0) throw bad();
+            step.action = FlowAction::Place;
+            step.side = side == "buy" ? OrderSide::Buy : OrderSide::Sell;
+        } else if (verb == "modify") {
+            if (!(words >> step.instrument_name >> step.price) || step.price <= 0.0) throw bad();
+            if (!(words >> step.amount)) step.amount = 0.0;
+            step.action = FlowAction::Modify;
+        } else if (verb == "cancel") {
+            if (!(words >> step.instrument_name)) throw bad();
+            step.action = FlowAction::Cancel;
+        } else {
+            throw bad();
+        }
+        step.delay = pending_delay;
+        pending_delay = std::chrono::microseconds(0);
+        steps.push_back(step);
+    }
+    return steps;
+}
+
+uint64_t OrderFlowReport::sent() const {
+    uint64_t total = 0;
+    for (const auto& stats : actions) total += stats.sent;
+    return total;
+}
+
+uint64_t OrderFlowReport::acked() const {
+    uint64_t total = 0;
+    for (const auto& stats : actions) total += stats.acked;
+    return total;
+}
+
+void OrderFlowReport::print(std::ostream& out) const {
+    double seconds = elapsed_seconds > 0.0 ? elapsed_seconds : 1.0;
+    out << (open_loop ? "Open loop" : "Closed loop") << " over " << transport << ": " << sent() << " requests in "
+        << std::fixed << std::setprecision(3) << elapsed_seconds << " s, " << std::setprecision(1)
+        << sent() / seconds << " sent/s, " << acked() / seconds << " acked/s";
+    if (target_rate > 0.0) out << " (target " << target_rate << "/s)";
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6) << "\n";
+
+    printTable(out, *this, "us, request to reply", &FlowActionStats::service_us);
+    if (open_loop) {
+        printTable(out, *this, "us, scheduled send to reply", &FlowActionStats::response_us);
+        out << late << " sends more than 1 ms behind schedule\n";
+    }
+    if (skipped > 0) out << skipped << " script steps skipped: no open order on the instrument\n";
+    if (cleanup_cancels > 0) out << cleanup_cancels << " orders left open were cancelled\n";
+    for (const auto& error : errors) {
+        out << "  " << error.second << " x " << error.first << "\n";
+    }
+}
+
+OrderFlowDriver::OrderFlowDriver(TradeExecution& trade, OrderFlowSpec spec)
+    : trade_(trade),
+      spec_(std::move(spec)),
+      blocking_(std::string(trade.orderTransportName()) != "json-rpc"),
+      rng_(spec_.seed) {
+    if (blocking_) pool_.reset(new asio::thread_pool(static_cast<std::size_t>(spec_.in_flight)));
+    std::vector<double> weights;
+    for (const auto& instrument : spec_.instruments) weights.push_back(instrument.weight);
+    instrument_pick_ = std::discrete_distribution<int>(weights.begin(), weights.end());
+    action_pick_ = std::discrete_distribution<int>(spec_.mix.begin(), spec_.mix.end());
+}
+
+OrderFlowDriver::~OrderFlowDriver() {
+    if (pool_) pool_->join();
+}
+
+asio::awaitable<OrderFlowReport> OrderFlowDriver::run() {
+    auto executor = co_await asio::this_coro::executor;
+    wake_.reset(new asio::steady_timer(executor));
+    if (spec_.script.empty()) co_await loadPrices();
+
+    report_ = OrderFlowReport();
+    report_.open_loop = spec_.open_loop;
+    report_.transport = trade_.orderTransportName();
+    report_.target_rate = spec_.rate;
+    start_ = next_slot_ = Clock::now();
+    end_ = spec_.duration_seconds > 0.0
+        ? start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spec_.duration_seconds))
+        : Clock::time_point::max();
+
+    if (spec_.open_loop) {
+        Clock::time_point scheduled;
+        uint64_t index = 0;
+        while (takeSlot(scheduled, index)) {
+            co_await waitUntil(scheduled);
+            while (in_flight_ >= spec_.in_flight) co_await waitWoken();
+            if (Clock::now() - scheduled > std::chrono::milliseconds(1)) ++report_.late;
+            Request request;
+            if (!makeRequest(index, request)) continue;
+            // Counted before the coroutine starts so the cap holds
+            ++in_flight_;
+            asio::co_spawn(executor, issue(std::move(request), scheduled), asio::detached);
+        }
+    } else {
+        for (int i = 0; i < spec_.in_flight; ++i) {
+            ++senders_;
+            asio::co_spawn(executor, sender(), asio::detached);
+        }
+        while (senders_ > 0) co_await waitWoken();
+    }
+    while (in_flight_ > 0) co_await waitWoken();
+    report_.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+
+    // Leave nothing resting; these cancels are not part of the measurement
+    while (!open_orders_.empty()) {
+        Request request{FlowAction::Cancel, open_orders_.front(), 0.0, 0.0};
+        open_orders_.pop_front();
+        json reply = co_await call(request);
+        ++report_.cleanup_cancels;
+        if (!reply.contains("result")) {
+            std::cerr << "Could not cancel " << request.order.order_id << ": " << reply.dump() << std::endl;
+        }
+    }
+    co_return report_;
+}
+
+// Generated prices start distance outside the touch, on the tick
+asio::awaitable<void> OrderFlowDriver::loadPrices() {
+    for (const auto& instrument : spec_.instruments) {
+        double tick = instrument.tick > 0.0 ? instrument.tick : spec_.tick;
+        double bid = spec_.reference_price;
+        double ask = spec_.reference_price;
+        if (bid <= 0.0) {
+            json book = co_await trade_.asyncGetOrderBook(instrument.name);
+            if (!book.contains("result")) {
+                throw std::runtime_error("No order book for " + instrument.name + ": " + book.dump());
+            }
+            const json& result = book["result"];
+            auto price = [&result](const char* key) {
+                return result.contains(key) && result[key].is_number() ? result[key].get<double>() : 0.0;
+            };
+            bid = price("best_bid_price") > 0.0 ? price("best_bid_price") : price("mark_price");
+            ask = price("best_ask_price") > 0.0 ? price("best_ask_price") : price("mark_price");
+            if (bid <= 0.0 || ask <= 0.0) throw std::runtime_error("No reference price for " + instrument.name);
+        }
+        quotes_[instrument.name] = Quote{onTick(std::floor(bid * (1.0 - spec_.distance) / tick), tick),
+                                         onTick(std::ceil(ask * (1.0 + spec_.distance) / tick), tick), tick};
+    }
+}
+
+// Open loop keeps to the schedule however far behind it falls; a closed loop
+// sender that was waiting on a reply starts its next gap from now
+bool OrderFlowDriver::takeSlot(Clock::time_point& scheduled, uint64_t& index) {
+    if (spec_.count > 0 && next_index_ >= spec_.count) return false;
+    if (!spec_.script.empty() && next_index_ >= spec_.script.size()) return false;
+    Clock::time_point slot = spec_.open_loop ? next_slot_ : std::max(next_slot_, Clock::now());
+    if (!spec_.script.empty()) slot += spec_.script[next_index_].delay;
+    if (slot >= end_) return false;
+
+    scheduled = slot;
+    index = next_index_++;
+    double gap = 0.0;
+    if (spec_.rate > 0.0) {
+        gap = spec_.poisson ? std::exponential_distribution<double>(spec_.rate)(rng_) : 1.0 / spec_.rate;
+    }
+    next_slot_ = slot + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap));
+    return true;
+}
+
+bool OrderFlowDriver::takeOpenOrder(const std::string& instrument_name, OpenOrder& order) {
+    auto it = std::find_if(open_orders_.begin(), open_orders_.end(),
+                           [&](const OpenOrder& open) { return open.instrument_name == instrument_name; });
+    if (it == open_orders_.end()) return false;
+    order = *it;
+    open_orders_.erase(it);
+    return true;
+}
+
+bool OrderFlowDriver::makeRequest(uint64_t index, Request& request) {
+    if (!spec_.script.empty()) {
+        const FlowStep& step = spec_.script[index];
+        request.action = step.action;
+        if (step.action == FlowAction::Place) {
+            request.order = OpenOrder{std::string(), step.instrument_name, step.side, step.price, step.amount};
+            request.price = step.price;
+            request.amount = step.amount;
+            return true;
+        }
+        if (!takeOpenOrder(step.instrument_name, request.order)) {
+            ++report_.skipped;
+            return false;
+        }
+        request.price = step.price;
+        request.amount = step.amount > 0.0 ? step.amount : request.order.amount;
+        return true;
+    }
+
+    const std::string& instrument_name = spec_.instruments[instrument_pick_(rng_)].name;
+    request.action = static_cast<FlowAction>(action_pick_(rng_));
+    // With nothing open to act on, keep the rate up with a new order
+    if (request.action != FlowAction::Place && !takeOpenOrder(instrument_name, request.order)) {
+        request.action = FlowAction::Place;
+    }
+    if (request.action == FlowAction::Place) {
+        OrderSide side = std::bernoulli_distribution(0.5)(rng_) ? OrderSide::Buy : OrderSide::Sell;
+        request.price = pickPrice(instrument_name, side, 0.0);
+        request.amount = spec_.amount;
+        request.order = OpenOrder{std::string(), instrument_name, side, request.price, request.amount};
+    } else if (request.action == FlowAction::Modify) {
+        request.price = pickPrice(instrument_name, request.order.side, request.order.price);
+        request.amount = request.order.amount;
+    }
+    return true;
+}
+
+// One of the ten ticks from the base outward, other than avoid
+double OrderFlowDriver::pickPrice(const std::string& instrument_name, OrderSide side, double avoid) {
+    const Quote& quote = quotes_.at(instrument_name);
+    std::uniform_int_distribution<int> level(0, 9);
+    double price = 0.0;
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        int k = level(rng_);
+        price = side == OrderSide::Buy ? quote.bid_base - onTick(k, quote.tick) : quote.ask_base + onTick(k, quote.tick);
+        price = std::max(onTick(std::round(price / quote.tick), quote.tick), quote.tick);
+        if (std::abs(price - avoid) > quote.tick / 2) break;
+    }
+    return price;
+}
+
+asio::awaitable<void> OrderFlowDriver::sender() {
+    Clock::time_point scheduled;
+    uint64_t index = 0;
+    while (takeSlot(scheduled, index)) {
+        co_await waitUntil(scheduled);
+        Request request;
+        if (!makeRequest(index, request)) continue;
+        ++in_flight_;
+        co_await issue(std::move(request), scheduled);
+    }
+    --senders_;
+    wake();
+}
+
+asio::awaitable<void> OrderFlowDriver::issue(Request request, Clock::time_point scheduled) {
+    Clock::time_point sent = Clock::now();
+    json reply;
+    try {
+        reply = co_await call(request);
+    }
+    catch (const std::exception& e) {
+        reply = json{{"error", {{"message", e.what()}}}};
+    }
+    finish(request, reply, scheduled, sent, Clock::now());
+    --in_flight_;
+    wake();
+}
+
+// Blocking calls run on the pool and post the reply back, so driver state is
+// only ever touched from the io_context's thread
+asio::awaitable<json> OrderFlowDriver::call(Request request) {
+    if (blocking_) {
+        struct Pending {
+            explicit Pending(const asio::any_io_executor& executor) : done(executor) {}
+            json reply;
+            asio::steady_timer done;    // cancelled once reply is set
+        };
+        auto executor = co_await asio::this_coro::executor;
+        auto pending = std::make_shared<Pending>(executor);
+        pending->done.expires_at(asio::steady_timer::time_point::max());
+        asio::post(*pool_, [this, request, pending, executor]() {
+            json reply = blockingCall(request);
+            asio::post(executor, [pending, reply = std::move(reply)]() mutable {
+                pending->reply = std::move(reply);
+                pending->done.cancel();
+            });
+        });
+        boost::system::error_code ec;
+        co_await pending->done.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        co_return std::move(pending->reply);
+    }
+    switch (request.action) {
+        case FlowAction::Place:
+            if (request.order.side == OrderSide::Buy) {
+                co_return co_await trade_.asyncPlaceBuyOrder(request.order.instrument_name, request.amount,
+                                                             request.price);
+            }
+            co_return co_await trade_.asyncPlaceSellOrder(request.order.instrument_name, request.amount,
+                                                          request.price);
+        case FlowAction::Modify:
+            co_return co_await trade_.asyncModifyOrder(request.order.order_id, request.price, request.amount);
+        case FlowAction::Cancel:
+            co_return co_await trade_.asyncCancelOrder(request.order.order_id);
+    }
+    co_return json();
+}
+
+json OrderFlowDriver::blockingCall(const Request& request) {
+    try {
+        switch (request.action) {
+            case FlowAction::Place:
+                return request.order.side == OrderSide::Buy
+                    ? trade_.placeBuyOrder(request.order.instrument_name, request.amount, request.price)
+                    : trade_.placeSellOrder(request.order.instrument_name, request.amount, request.price);
+            case FlowAction::Modify:
+                return trade_.modifyOrder(request.order.order_id, request.price, request.amount);
+            case FlowAction::Cancel:
+                return trade_.cancelOrder(request.order.order_id);
+        }
+    }
+    catch (const std::exception& e) {
+        return json{{"error", {{"message", e.what()}}}};
+    }
+    return json();
+}
+
+void OrderFlowDriver::finish(const Request& request, const json& reply, Clock::time_point scheduled,
+                             Clock::time_point sent, Clock::time_point answered) {
+    FlowActionStats& stats = report_.actions[static_cast<int>(request.action)];
+    ++stats.sent;
+    stats.service_us.push_back(std::chrono::duration<double, std::micro>(answered - sent).count());
+    stats.response_us.push_back(std::chrono::duration<double, std::micro>(answered - scheduled).count());
+
+    if (!reply.contains("result")) {
+        ++stats.rejected;
+        const json error = reply.contains("error") && reply["error"].is_object() ? reply["error"] : json::object();
+        ++report_.errors[error.value("message", std::string("no reply"))];
+        // Still open unless the exchange says otherwise, so it stays in play
+        // and gets cancelled at the end
+        if (request.action != FlowAction::Place && error.value("code", 0) != kNotOpenOrder) {
+            open_orders_.push_back(request.order);
+        }
+        return;
+    }
+
+    ++stats.acked;
+    if (request.action == FlowAction::Cancel) return;
+    // private/buy and private/edit wrap the order; other transports may not
+    const json& result = reply["result"];
+    const json& order = result.contains("order") ? result["order"] : result;
+    if (order.value("order_state", std::string()) != "open") return;
+    OpenOrder open = request.order;
+    open.order_id = order.value("order_id", open.order_id);
+    open.price = request.price;
+    open.amount = request.amount;
+    open_orders_.push_back(open);
+}
+
+asio::awaitable<void> OrderFlowDriver::waitUntil(Clock::time_point when) {
+    if (when <= Clock::now()) co_return;
+    asio::steady_timer timer(co_await asio::this_coro::executor, when);
+    co_await timer.async_wait(asio::use_awaitable);
+}
+
+asio::awaitable<void> OrderFlowDriver::waitWoken() {
+    wake_->expires_at(asio::steady_timer::time_point::max());
+    boost::system::error_code ec;
+    co_await wake_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+}
+
+void OrderFlowDriver::wake() {
+    wake_->cancel();
+}
@@ -0,0 +1,184 @@
+#ifndef ORDER_FLOW_H
+#define ORDER_FLOW_H
+
+#include "order_transport.h"
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+class TradeExecution;
+
+using json = nlohmann::json;
+
+enum class FlowAction { Place, Modify, Cancel };
+
+const char* flowActionName(FlowAction action);
+
+// One line of an order script. Modify and cancel act on the oldest open
+// order the script placed on that instrument.
+struct FlowStep {
+    FlowAction action;
+    std::string instrument_name;
+    OrderSide side = OrderSide::Buy;        // place
+    double price = 0.0;                     // place and modify
+    double amount = 0.0;                    // place; on modify 0 keeps the order's size
+    std::chrono::microseconds delay{0};     // "wait" lines before this step
+};
+
+struct FlowInstrument {
+    std::string name;
+    double weight = 1.0;
+    double tick = 0.0;                      // 0 uses the spec's tick
+};
+
+// What the driver sends and how fast. Generated flow picks an instrument by
+// weight and an action by the place:modify:cancel mix, and prices orders
+// between distance and distance + 10 ticks outside the touch so they rest.
+// A script replaces the generator and is sent once, in order.
+struct OrderFlowSpec {
+    double rate = 10.0;                     // requests per second, 0 = as fast as replies allow
+    double duration_seconds = 0.0;          // 0: until count or the script runs out, else 10 s
+    uint64_t count = 0;                     // stop after this many requests, if set
+    bool open_loop = false;                 // send on schedule whether or not earlier replies are in
+    bool poisson = false;                   // exponential gaps instead of even ones
+    int in_flight = 1;                      // closed loop: senders; open loop: cap before sends queue
+    std::vector<FlowInstrument> instruments;
+    std::array<double, 3> mix = {60.0, 30.0, 10.0};
+    double amount = 10.0;
+    double distance = 0.05;                 // fraction of the touch price
+    double tick = 0.5;
+    double reference_price = 0.0;           // price every instrument around it instead of reading its book
+    uint64_t seed = 1;
+    std::string script_path;
+    std::vector<FlowStep> script;
+
+    std::string describe() const;
+    // Comma separated rate=N, duration=S, count=N, open_loop, poisson,
+    // in_flight=N, instrument=NAME[:WEIGHT[:TICK]] (repeatable),
+    // mix=PLACE:MODIFY:CANCEL, amount=N, distance=PERCENT, tick=N, price=N,
+    // seed=N, script=PATH. Throws std::invalid_argument on a malformed spec
+    // and std::runtime_error if the script cannot be read.
+    static OrderFlowSpec parse(const std::string& spec);
+    // One step per line: "place INSTRUMENT buy|sell AMOUNT PRICE",
+    // "modify INSTRUMENT PRICE [AMOUNT]", "cancel INSTRUMENT" or "wait MS";
+    // blank lines and lines starting with # are skipped
+    static std::vector<FlowStep> parseScript(std::istream& in);
+};
+
+struct FlowActionStats {
+    uint64_t sent = 0;
+    uint64_t acked = 0;
+    uint64_t rejected = 0;
+    std::vector<double> service_us;         // request sent to reply
+    std::vector<double> response_us;        // scheduled send to reply, queueing included
+};
+
+struct OrderFlowReport {
+    bool open_loop = false;
+    std::string transport;
+    double target_rate = 0.0;
+    double elapsed_seconds = 0.0;           // first scheduled send to last reply
+    std::array<FlowActionStats, 3> actions;
+    uint64_t skipped = 0;                   // script steps with no open order to act on
+    uint64_t late = 0;                      // open loop sends more than 1 ms behind schedule
+    uint64_t cleanup_cancels = 0;           // orders still open at the end
+    std::map<std::string, uint64_t> errors; // reply error message -> count
+
+    uint64_t sent() const;
+    uint64_t acked() const;
+    void print(std::ostream& out) const;
+};
+
+// Drives an order flow through TradeExecution and measures it. Over JSON-RPC
+// the coroutine API keeps as many requests in flight as the spec allows; any
+// other transport has blocking calls only, so they run on a thread pool with
+// one thread per request in flight. Open loop sends on schedule and times
+// replies from the scheduled send as well, so a client that falls behind
+// shows it in the latency instead of quietly sending less. Every order still
+// open at the end is cancelled.
+class OrderFlowDriver {
+public:
+    OrderFlowDriver(TradeExecution& trade, OrderFlowSpec spec);
+    ~OrderFlowDriver();
+
+    // Await on the io_context TradeExecution's WebSocketHandler runs on, which
+    // must be run by one thread. Throws std::runtime_error if a reference
+    // price cannot be read.
+    boost::asio::awaitable<OrderFlowReport> run();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct OpenOrder {
+        std::string order_id;
+        std::string instrument_name;
+        OrderSide side;
+        double price;
+        double amount;
+    };
+
+    // Place: order holds the instrument and side. Modify and cancel: the open
+    // order acted on. price and amount are the new values.
+    struct Request {
+        FlowAction action;
+        OpenOrder order;
+        double price = 0.0;
+        double amount = 0.0;
+    };
+
+    struct Quote {
+        double bid_base;            // highest generated buy price
+        double ask_base;            // lowest generated sell price
+        double tick;
+    };
+
+    boost::asio::awaitable<void> loadPrices();
+    bool takeSlot(Clock::time_point& scheduled, uint64_t& index);
+    bool makeRequest(uint64_t index, Request& request);
+    double pickPrice(const std::string& instrument_name, OrderSide side, double avoid);
+    boost::asio::awaitable<void> sender();
+    boost::asio::awaitable<void> issue(Request request, Clock::time_point scheduled);
+    boost::asio::awaitable<json> call(Request request);
+    json blockingCall(const Request& request);
+    void finish(const Request& request, const json& reply, Clock::time_point scheduled,
+                Clock::time_point sent, Clock::time_point answered);
+    boost::asio::awaitable<void> waitUntil(Clock::time_point when);
+    // Until the next reply, or a closed loop sender, finishes
+    boost::asio::awaitable<void> waitWoken();
+    void wake();
+    bool takeOpenOrder(const std::string& instrument_name, OpenOrder& order);
+
+    static constexpr int kNotOpenOrder = 11044;
+
+    TradeExecution& trade_;
+    OrderFlowSpec spec_;
+    bool blocking_;
+    std::unique_ptr<boost::asio::thread_pool> pool_;
+    std::mt19937_64 rng_;
+    std::map<std::string, Quote> quotes_;
+    std::deque<OpenOrder> open_orders_;         // acked and not being modified or cancelled
+    Clock::time_point start_;
+    Clock::time_point end_;
+    Clock::time_point next_slot_;
+    uint64_t next_index_ = 0;
+    int in_flight_ = 0;
+    int senders_ = 0;                           // closed loop senders still running
+    std::discrete_distribution<int> instrument_pick_;
+    std::discrete_distribution<int> action_pick_;
+    std::unique_ptr<boost::asio::steady_timer> wake_;
+    OrderFlowReport report_;
+};
+
+#endif // ORDER_FLOW_H
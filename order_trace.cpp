@@ -0,0 +1,214 @@
+#include "order_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ORDER_TRACE_HAVE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ORDER_TRACE_HAVE_RDTSC 1
+#else
+#define ORDER_TRACE_HAVE_RDTSC 0
+#endif
+
+namespace {
+
+constexpr int kStageCount = static_cast<int>(OrderStage::Count);
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    double ticks_per_ns;
+    uint64_t count;
+};
+
+const char kMagic[8] = {'O', 'R', 'D', 'T', 'R', 'A', 'C', 'E'};
+
+uint64_t steadyNanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double calibrate() {
+#if ORDER_TRACE_HAVE_RDTSC
+    // Spin for a few milliseconds and compare tick and clock deltas
+    uint64_t ns0 = steadyNanoseconds();
+    uint64_t tsc0 = __rdtsc();
+    uint64_t ns1 = ns0;
+    while (ns1 - ns0 < 10000000) {
+        ns1 = steadyNanoseconds();
+    }
+    uint64_t tsc1 = __rdtsc();
+    return static_cast<double>(tsc1 - tsc0) / static_cast<double>(ns1 - ns0);
+#else
+    return 1.0;
+#endif
+}
+
+} // namespace
+
+const char* orderStageName(OrderStage stage) {
+    switch (stage) {
+        case OrderStage::Created: return "created";
+        case OrderStage::Encoded: return "encoded";
+        case OrderStage::Written: return "written";
+        case OrderStage::AckReceived: return "ack";
+        case OrderStage::FillReceived: return "fill";
+        default: return "unknown";
+    }
+}
+
+uint64_t TscClock::now() {
+#if ORDER_TRACE_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return steadyNanoseconds();
+#endif
+}
+
+double TscClock::ticksPerNanosecond() {
+    static const double ticks_per_ns = calibrate();
+    return ticks_per_ns;
+}
+
+OrderTracer::OrderTracer(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+    TscClock::ticksPerNanosecond();   // calibrate now, not on the first order
+}
+
+OrderTracer::Slot& OrderTracer::slotFor(int64_t request_id) {
+    return slots_[static_cast<std::size_t>(request_id) & mask_];
+}
+
+void OrderTracer::stamp(int64_t request_id, OrderStage stage) {
+    uint64_t now = TscClock::now();
+    Slot& slot = slotFor(request_id);
+    int index = static_cast<int>(stage);
+
+    // Created claims the slot; later stages for an order whose slot has
+    // since been reused are dropped.
+    if (stage == OrderStage::Created) {
+        slot.stage_mask.store(0, std::memory_order_relaxed);
+        slot.request_id.store(request_id, std::memory_order_relaxed);
+    } else if (slot.request_id.load(std::memory_order_relaxed) != request_id) {
+        return;
+    }
+    slot.tsc[index].store(now, std::memory_order_relaxed);
+    slot.stage_mask.fetch_or(1u << index, std::memory_order_release);
+}
+
+void OrderTracer::stampOnce(int64_t request_id, OrderStage stage) {
+    Slot& slot = slotFor(request_id);
+    if (slot.request_id.load(std::memory_order_relaxed) != request_id) return;
+    if (slot.stage_mask.load(std::memory_order_acquire) & (1u << static_cast<int>(stage))) return;
+    stamp(request_id, stage);
+}
+
+bool OrderTracer::dumpToFile(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    std::vector<OrderTraceRecord> records;
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        const Slot& slot = slots_[i];
+        uint32_t stage_mask = slot.stage_mask.load(std::memory_order_acquire);
+        if (stage_mask == 0) continue;
+        OrderTraceRecord record{};
+        record.request_id = slot.request_id.load(std::memory_order_relaxed);
+        record.stage_mask = stage_mask;
+        for (int s = 0; s < kStageCount; ++s) {
+            record.tsc[s] = (stage_mask & (1u << s)) ? slot.tsc[s].load(std::memory_order_relaxed) : 0;
+        }
+        records.push_back(record);
+    }
+    std::sort(records.begin(), records.end(), [](const OrderTraceRecord& a, const OrderTraceRecord& b) {
+        return a.request_id < b.request_id;
+    });
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = 1;
+    header.record_size = sizeof(OrderTraceRecord);
+    header.ticks_per_ns = TscClock::ticksPerNanosecond();
+    header.count = records.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(OrderTraceRecord)));
+    return static_cast<bool>(out);
+}
+
+bool OrderTracer::summarise(const std::string& path, std::ostream& out) {
+    std::ifstream in(path, std::ios::binary);
+    TraceFileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+        || header.record_size != sizeof(OrderTraceRecord)) {
+        out << "Not an order trace file: " << path << "\n";
+        return false;
+    }
+
+    // A truncated or corrupt header must not size the buffer past the file
+    std::streampos records_start = in.tellg();
+    in.seekg(0, std::ios::end);
+    uint64_t available = static_cast<uint64_t>(in.tellg() - records_start) / sizeof(OrderTraceRecord);
+    in.seekg(records_start);
+    std::vector<OrderTraceRecord> records(static_cast<std::size_t>(std::min<uint64_t>(header.count, available)));
+    in.read(reinterpret_cast<char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(OrderTraceRecord)));
+    records.resize(static_cast<std::size_t>(in.gcount()) / sizeof(OrderTraceRecord));
+
+    struct Segment {
+        const char* name;
+        OrderStage from;
+        OrderStage to;
+    };
+    const Segment segments[] = {
+        {"encode", OrderStage::Created, OrderStage::Encoded},
+        {"write", OrderStage::Encoded, OrderStage::Written},
+        {"wire + exchange + ack read", OrderStage::Written, OrderStage::AckReceived},
+        {"ack to first fill", OrderStage::AckReceived, OrderStage::FillReceived},
+        {"decision to ack", OrderStage::Created, OrderStage::AckReceived},
+        {"decision to fill", OrderStage::Created, OrderStage::FillReceived},
+    };
+
+    out << "Orders traced: " << records.size() << " (" << header.ticks_per_ns << " ticks/ns)\n";
+    out << std::left << std::setw(28) << "Segment (us)" << std::right
+        << std::setw(8) << "count" << std::setw(12) << "p50" << std::setw(12) << "p90"
+        << std::setw(12) << "p99" << std::setw(12) << "max" << "\n";
+
+    std::vector<double> samples;
+    for (const Segment& seg : segments) {
+        uint32_t need = (1u << static_cast<int>(seg.from)) | (1u << static_cast<int>(seg.to));
+        samples.clear();
+        for (const OrderTraceRecord& r : records) {
+            if ((r.stage_mask & need) != need) continue;
+            uint64_t from = r.tsc[static_cast<int>(seg.from)];
+            uint64_t to = r.tsc[static_cast<int>(seg.to)];
+            if (to < from) continue;
+            samples.push_back(static_cast<double>(to - from) / header.ticks_per_ns / 1000.0);
+        }
+        out << std::left << std::setw(28) << seg.name << std::right << std::setw(8) << samples.size();
+        if (samples.empty()) {
+            out << "\n";
+            continue;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto pct = [&samples](double p) {
+            return samples[static_cast<std::size_t>(p * (samples.size() - 1))];
+        };
+        out << std::fixed << std::setprecision(1)
+            << std::setw(12) << pct(0.50) << std::setw(12) << pct(0.90)
+            << std::setw(12) << pct(0.99) << std::setw(12) << samples.back() << "\n";
+        out.unsetf(std::ios::floatfield);
+    }
+    return true;
+}
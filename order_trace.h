@@ -0,0 +1,70 @@
+#ifndef ORDER_TRACE_H
+#define ORDER_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Points in an order's life that get a timestamp
+enum class OrderStage : uint8_t {
+    Created = 0,      // decision made, before the request is built
+    Encoded,          // request serialised
+    Written,          // handed to the socket
+    AckReceived,      // exchange reply parsed
+    FillReceived,     // first fill seen
+    Count
+};
+
+const char* orderStageName(OrderStage stage);
+
+// Time stamp counter reads, calibrated against steady_clock once per process.
+// Falls back to steady_clock nanoseconds on CPUs without rdtsc.
+class TscClock {
+public:
+    static uint64_t now();
+    static double ticksPerNanosecond();
+    static double toNanoseconds(uint64_t ticks) { return ticks / ticksPerNanosecond(); }
+};
+
+// On-disk record, one per traced order
+struct OrderTraceRecord {
+    int64_t request_id;
+    uint32_t stage_mask;      // bit i set when stage i was stamped
+    uint32_t reserved;
+    uint64_t tsc[static_cast<int>(OrderStage::Count)];
+};
+
+// Per-order stage timestamps keyed by JSON-RPC request id, held in a
+// preallocated ring (slot = id modulo capacity, so the oldest orders are
+// overwritten). stamp() is lock-free and safe to call from any thread.
+class OrderTracer {
+public:
+    explicit OrderTracer(std::size_t capacity = 65536);
+
+    void stamp(int64_t request_id, OrderStage stage);
+    // Stamp only if the stage has not been recorded yet (e.g. first fill)
+    void stampOnce(int64_t request_id, OrderStage stage);
+
+    // Binary dump: header followed by OrderTraceRecord entries
+    bool dumpToFile(const std::string& path) const;
+
+    // Read a dump and print per-stage latency percentiles
+    static bool summarise(const std::string& path, std::ostream& out);
+
+private:
+    struct Slot {
+        std::atomic<int64_t> request_id{-1};
+        std::atomic<uint32_t> stage_mask{0};
+        std::atomic<uint64_t> tsc[static_cast<int>(OrderStage::Count)];
+    };
+
+    Slot& slotFor(int64_t request_id);
+
+    std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+#endif // ORDER_TRACE_H
@@ -0,0 +1,105 @@
+#include "order_transport.h"
+#include "websocket_handler.h"
+
+JsonRpcOrderTransport::JsonRpcOrderTransport(WebSocketHandler& websocket)
+    : websocket_(websocket),
+      in_flight_(MetricsRegistry::instance().gauge(
+          "deribit_rpc_in_flight", "JSON-RPC requests sent and awaiting a reply")) {}
+
+json JsonRpcOrderTransport::placeRequest(int request_id, const NewOrder& order) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", request_id},
+        {"method", order.side == OrderSide::Buy ? "private/buy" : "private/sell"},
+        {"params", {
+            {"instrument_name", order.instrument_name},
+            {"amount", order.amount},
+            {"type", "limit"},
+            {"price", order.price}
+        }}
+    };
+}
+
+json JsonRpcOrderTransport::cancelRequest(int request_id, const std::string& order_id) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", request_id},
+        {"method", "private/cancel"},
+        {"params", {{"order_id", order_id}}}
+    };
+}
+
+json JsonRpcOrderTransport::modifyRequest(int request_id, const std::string& order_id, double new_price,
+                                          double new_amount) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", request_id},
+        {"method", "private/edit"},
+        {"params", {
+            {"order_id", order_id},
+            {"new_price", new_price},
+            {"new_amount", new_amount},
+            {"contracts", new_amount}
+        }}
+    };
+}
+
+json JsonRpcOrderTransport::send(int request_id, const json& request, OrderTracer& tracer) {
+    std::string payload = request.dump();
+    tracer.stamp(request_id, OrderStage::Encoded);
+    json response;
+    {
+        GaugeScope in_flight(in_flight_);
+        response = websocket_.call(request_id, payload,
+                                   [&tracer, request_id]() { tracer.stamp(request_id, OrderStage::Written); });
+    }
+    tracer.stamp(request_id, OrderStage::AckReceived);
+    return response;
+}
+
+boost::asio::awaitable<json> JsonRpcOrderTransport::asyncSend(int request_id, json request, OrderTracer& tracer) {
+    std::string payload = request.dump();
+    tracer.stamp(request_id, OrderStage::Encoded);
+    json response;
+    {
+        GaugeScope in_flight(in_flight_);
+        auto call = websocket_.start_call(request_id, std::move(payload), [&tracer, request_id]() {
+            tracer.stamp(request_id, OrderStage::Written);
+        });
+        response = co_await websocket_.await_reply(std::move(call));
+    }
+    tracer.stamp(request_id, OrderStage::AckReceived);
+    co_return response;
+}
+
+json JsonRpcOrderTransport::placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) {
+    return send(request_id, placeRequest(request_id, order), tracer);
+}
+
+json JsonRpcOrderTransport::cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) {
+    return send(request_id, cancelRequest(request_id, order_id), tracer);
+}
+
+json JsonRpcOrderTransport::modifyOrder(int request_id, const std::string& order_id, double new_price,
+                                        double new_amount, OrderTracer& tracer) {
+    return send(request_id, modifyRequest(request_id, order_id, new_price, new_amount), tracer);
+}
+
+boost::asio::awaitable<json> JsonRpcOrderTransport::asyncPlaceOrder(int request_id, NewOrder order,
+                                                                    OrderTracer& tracer) {
+    json request = placeRequest(request_id, order);
+    co_return co_await asyncSend(request_id, std::move(request), tracer);
+}
+
+boost::asio::awaitable<json> JsonRpcOrderTransport::asyncCancelOrder(int request_id, std::string order_id,
+                                                                     OrderTracer& tracer) {
+    json request = cancelRequest(request_id, order_id);
+    co_return co_await asyncSend(request_id, std::move(request), tracer);
+}
+
+boost::asio::awaitable<json> JsonRpcOrderTransport::asyncModifyOrder(int request_id, std::string order_id,
+                                                                     double new_price, double new_amount,
+                                                                     OrderTracer& tracer) {
+    json request = modifyRequest(request_id, order_id, new_price, new_amount);
+    co_return co_await asyncSend(request_id, std::move(request), tracer);
+}
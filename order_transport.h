@@ -0,0 +1,71 @@
+#ifndef ORDER_TRANSPORT_H
+#define ORDER_TRANSPORT_H
+
+#include "metrics.h"
+#include "order_trace.h"
+#include <boost/asio/awaitable.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+
+class WebSocketHandler;
+
+using json = nlohmann::json;
+
+enum class OrderSide { Buy, Sell };
+
+struct NewOrder {
+    std::string instrument_name;
+    OrderSide side;
+    double amount;
+    double price;
+};
+
+// Order entry over one wire protocol. Each call blocks until the venue
+// answers and returns the answer in Deribit JSON-RPC shape
+// ({"result": {"order": {...}, "trades": [...]}} or {"error": {...}}), so
+// callers do not care which transport is in use. Implementations stamp the
+// Encoded, Written and AckReceived stages under request_id; the caller stamps
+// Created before calling.
+class OrderTransport {
+public:
+    virtual ~OrderTransport() = default;
+
+    virtual const char* name() const = 0;
+    virtual json placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) = 0;
+    virtual json cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) = 0;
+    virtual json modifyOrder(int request_id, const std::string& order_id, double new_price,
+                             double new_amount, OrderTracer& tracer) = 0;
+};
+
+// private/buy, private/sell, private/cancel and private/edit over the
+// WebSocket connection
+class JsonRpcOrderTransport : public OrderTransport {
+public:
+    explicit JsonRpcOrderTransport(WebSocketHandler& websocket);
+
+    const char* name() const override { return "json-rpc"; }
+    json placeOrder(int request_id, const NewOrder& order, OrderTracer& tracer) override;
+    json cancelOrder(int request_id, const std::string& order_id, OrderTracer& tracer) override;
+    json modifyOrder(int request_id, const std::string& order_id, double new_price,
+                     double new_amount, OrderTracer& tracer) override;
+
+    // Coroutine versions over WebSocketHandler::start_call; many can be in
+    // flight at once. Arguments are taken by value because the coroutine may
+    // outlive the caller's temporaries.
+    boost::asio::awaitable<json> asyncPlaceOrder(int request_id, NewOrder order, OrderTracer& tracer);
+    boost::asio::awaitable<json> asyncCancelOrder(int request_id, std::string order_id, OrderTracer& tracer);
+    boost::asio::awaitable<json> asyncModifyOrder(int request_id, std::string order_id, double new_price,
+                                                  double new_amount, OrderTracer& tracer);
+
+private:
+    static json placeRequest(int request_id, const NewOrder& order);
+    static json cancelRequest(int request_id, const std::string& order_id);
+    static json modifyRequest(int request_id, const std::string& order_id, double new_price, double new_amount);
+    json send(int request_id, const json& request, OrderTracer& tracer);
+    boost::asio::awaitable<json> asyncSend(int request_id, json request, OrderTracer& tracer);
+
+    WebSocketHandler& websocket_;
+    Gauge& in_flight_;
+};
+
+#endif // ORDER_TRANSPORT_H
@@ -0,0 +1,303 @@
+#include "quote_manager.h"
+#include "trade_execution.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+QuoteManager::QuoteManager(TradeExecution& trade, QuoteManagerConfig config)
+    : trade_(trade),
+      config_(config),
+      places_(MetricsRegistry::instance().counter(
+          "deribit_quote_requests_total", "Order requests sent by the quote manager", "action=\"place\"")),
+      amends_(MetricsRegistry::instance().counter(
+          "deribit_quote_requests_total", "Order requests sent by the quote manager", "action=\"amend\"")),
+      cancels_(MetricsRegistry::instance().counter(
+          "deribit_quote_requests_total", "Order requests sent by the quote manager", "action=\"cancel\"")),
+      coalesced_(MetricsRegistry::instance().counter(
+          "deribit_quote_targets_coalesced_total", "Quote targets replaced before being acted on")) {}
+
+void QuoteManager::setQuotes(const std::string& instrument_name, QuoteLadder ladder) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++stats_.targets;
+    InstrumentQuotes& quotes = instruments_[instrument_name];
+    quotes.target = std::move(ladder);
+    ++quotes.version;
+    if (quotes.busy) {
+        if (quotes.unplanned) {
+            ++stats_.coalesced;
+            coalesced_.inc();
+        }
+        quotes.unplanned = true;
+        return;
+    }
+
+    quotes.busy = true;
+    bool superseded = true;
+    while (superseded) {
+        quotes.unplanned = false;
+        uint64_t version = quotes.version;
+        if (!quotes.pending.empty()) confirmPending(instrument_name, quotes, lock);
+        for (const Action& action : plan(quotes)) {
+            lock.unlock();
+            json reply = send(instrument_name, action);
+            lock.lock();
+            apply(instrument_name, quotes, action, reply);
+            deliverFills(lock);
+            // A newer target makes the rest of this plan stale
+            if (quotes.version != version) break;
+        }
+        superseded = quotes.version != version;
+    }
+    quotes.busy = false;
+}
+
+// Adopt the open orders that pending places turned into. While the open
+// orders cannot be fetched the places stay pending.
+void QuoteManager::confirmPending(const std::string& instrument_name, InstrumentQuotes& quotes,
+                                  std::unique_lock<std::mutex>& lock) {
+    lock.unlock();
+    json reply;
+    try {
+        reply = trade_.getOpenOrders(instrument_name);
+    }
+    catch (const std::exception&) {
+    }
+    lock.lock();
+    if (!reply.contains("result") || !reply["result"].is_array()) return;
+
+    for (const PendingPlace& place : quotes.pending) {
+        for (const auto& order : reply["result"]) {
+            std::string order_id = order.value("order_id", std::string());
+            OrderSide side = order.value("direction", std::string()) == "buy" ? OrderSide::Buy : OrderSide::Sell;
+            if (side != place.side || order_instruments_.count(order_id)
+                || std::abs(order.value("price", 0.0) - place.price) > config_.price_tolerance
+                || std::abs(order.value("amount", 0.0) - place.amount) > config_.size_tolerance) {
+                continue;
+            }
+            ManagedOrder& live = trackOrder(instrument_name, quotes, order_id, side);
+            live.price = order.value("price", place.price);
+            live.amount = order.value("amount", place.amount);
+            live.filled = order.value("filled_amount", 0.0);
+            ++stats_.confirmed;
+            break;
+        }
+    }
+    quotes.pending.clear();
+}
+
+// Cancels first so exposure only shrinks while the plan is sent, then amends,
+// then new orders
+std::vector<QuoteManager::Action> QuoteManager::plan(InstrumentQuotes& quotes) {
+    std::vector<Action> actions;
+    planSide(quotes, OrderSide::Buy, quotes.target.bids, actions);
+    planSide(quotes, OrderSide::Sell, quotes.target.asks, actions);
+    std::stable_sort(actions.begin(), actions.end(), [](const Action& a, const Action& b) {
+        auto rank = [](ActionKind kind) { return kind == ActionKind::Cancel ? 0 : kind == ActionKind::Amend ? 1 : 2; };
+        return rank(a.kind) < rank(b.kind);
+    });
+    return actions;
+}
+
+void QuoteManager::planSide(InstrumentQuotes& quotes, OrderSide side, std::vector<QuoteLevel> levels,
+                            std::vector<Action>& actions) {
+    auto better = [side](double a, double b) { return side == OrderSide::Buy ? a > b : a < b; };
+    levels.erase(std::remove_if(levels.begin(), levels.end(),
+                                [](const QuoteLevel& level) { return !(level.amount > 0.0); }),
+                 levels.end());
+    std::sort(levels.begin(), levels.end(),
+              [&](const QuoteLevel& a, const QuoteLevel& b) { return better(a.price, b.price); });
+
+    // A pending place holds its level; it cannot be moved without an id
+    for (const PendingPlace& place : quotes.pending) {
+        if (place.side != side) continue;
+        auto held = std::find_if(levels.begin(), levels.end(), [&](const QuoteLevel& level) {
+            return std::abs(level.price - place.price) <= config_.price_tolerance;
+        });
+        if (held != levels.end()) levels.erase(held);
+    }
+
+    std::vector<ManagedOrder*> live;
+    for (auto& order : quotes.orders) {
+        if (order.side == side) live.push_back(&order);
+    }
+    std::sort(live.begin(), live.end(),
+              [&](const ManagedOrder* a, const ManagedOrder* b) { return better(a->price, b->price); });
+
+    auto amend = [&](const ManagedOrder& order, const QuoteLevel& level) {
+        actions.push_back(Action{ActionKind::Amend, side, order.order_id, level.price, order.filled + level.amount});
+    };
+
+    // Orders already at a target price keep their queue position
+    std::vector<bool> level_done(levels.size(), false);
+    std::vector<bool> order_done(live.size(), false);
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        for (std::size_t j = 0; j < live.size(); ++j) {
+            if (order_done[j] || std::abs(live[j]->price - levels[i].price) > config_.price_tolerance) continue;
+            if (std::abs(live[j]->remaining() - levels[i].amount) > config_.size_tolerance) {
+                amend(*live[j], levels[i]);
+            } else {
+                ++stats_.kept;
+            }
+            level_done[i] = order_done[j] = true;
+            break;
+        }
+    }
+
+    // Moving an order costs one request where cancel and place cost two
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        if (level_done[i]) continue;
+        while (j < live.size() && order_done[j]) ++j;
+        if (j < live.size()) {
+            amend(*live[j], levels[i]);
+            order_done[j] = true;
+        } else {
+            actions.push_back(Action{ActionKind::Place, side, std::string(), levels[i].price, levels[i].amount});
+        }
+    }
+    for (std::size_t k = 0; k < live.size(); ++k) {
+        if (!order_done[k]) actions.push_back(Action{ActionKind::Cancel, side, live[k]->order_id, 0.0, 0.0});
+    }
+}
+
+json QuoteManager::send(const std::string& instrument_name, const Action& action) {
+    try {
+        switch (action.kind) {
+            case ActionKind::Place:
+                return action.side == OrderSide::Buy
+                    ? trade_.placeBuyOrder(instrument_name, action.amount, action.price)
+                    : trade_.placeSellOrder(instrument_name, action.amount, action.price);
+            case ActionKind::Amend:
+                return trade_.modifyOrder(action.order_id, action.price, action.amount);
+            case ActionKind::Cancel:
+                return trade_.cancelOrder(action.order_id);
+        }
+    }
+    catch (const std::exception& e) {
+        return json{{"error", {{"message", e.what()}}}};
+    }
+    return json();
+}
+
+void QuoteManager::apply(const std::string& instrument_name, InstrumentQuotes& quotes, const Action& action,
+                         const json& reply) {
+    switch (action.kind) {
+        case ActionKind::Place: ++stats_.places; places_.inc(); break;
+        case ActionKind::Amend: ++stats_.amends; amends_.inc(); break;
+        case ActionKind::Cancel: ++stats_.cancels; cancels_.inc(); break;
+    }
+
+    // private/cancel answers with the order itself
+    if (action.kind == ActionKind::Cancel && reply.contains("result")) {
+        removeOrder(quotes, action.order_id);
+        return;
+    }
+    if (!reply.contains("result") || !reply["result"].contains("order")) {
+        int code = reply.contains("error") ? reply["error"].value("code", 0) : 0;
+        // No code from the exchange: the place may be resting all the same
+        if (action.kind == ActionKind::Place && code == 0) {
+            ++stats_.unconfirmed;
+            quotes.pending.push_back(PendingPlace{action.side, action.price, action.amount});
+            std::cerr << "Quote place for " << instrument_name << " unconfirmed: " << reply.dump() << std::endl;
+            return;
+        }
+        ++stats_.rejects;
+        // The order filled or was cancelled before the request got there
+        if (action.kind != ActionKind::Place && code == kNotOpenOrder) {
+            removeOrder(quotes, action.order_id);
+        } else {
+            std::cerr << "Quote request for " << instrument_name << " failed: " << reply.dump() << std::endl;
+        }
+        return;
+    }
+
+    const json& result = reply["result"];
+    const json& order = result["order"];
+    recordTrades(instrument_name, action.side, result.value("trades", json::array()));
+    std::string order_id = order.value("order_id", std::string());
+    if (order.value("order_state", std::string()) != "open") {
+        removeOrder(quotes, order_id);
+        return;
+    }
+
+    ManagedOrder& live = trackOrder(instrument_name, quotes, order_id, action.side);
+    live.price = order.value("price", action.price);
+    live.amount = order.value("amount", action.amount);
+    // A user.trades fill may already be ahead of this reply
+    live.filled = std::max(live.filled, order.value("filled_amount", 0.0));
+}
+
+ManagedOrder& QuoteManager::trackOrder(const std::string& instrument_name, InstrumentQuotes& quotes,
+                                       const std::string& order_id, OrderSide side) {
+    auto it = std::find_if(quotes.orders.begin(), quotes.orders.end(),
+                           [&](const ManagedOrder& live) { return live.order_id == order_id; });
+    if (it != quotes.orders.end()) return *it;
+    quotes.orders.push_back(ManagedOrder{order_id, side, 0.0, 0.0, 0.0});
+    if (order_instruments_.size() >= kMaxTrackedOrders) order_instruments_.clear();
+    order_instruments_[order_id] = instrument_name;
+    return quotes.orders.back();
+}
+
+void QuoteManager::recordTrades(const std::string& instrument_name, OrderSide side, const json& trades) {
+    if (seen_trades_.size() >= kMaxTrackedTrades) seen_trades_.clear();
+    for (const auto& trade : trades) {
+        const json& id = trade["trade_id"];
+        if (!seen_trades_.insert(id.is_string() ? id.get<std::string>() : id.dump()).second) continue;
+        fills_.push_back(Fill{instrument_name, side, trade.value("amount", 0.0)});
+    }
+}
+
+void QuoteManager::onFill(const std::string& order_id, const std::string& trade_id, OrderSide side, double amount) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (seen_trades_.size() >= kMaxTrackedTrades) seen_trades_.clear();
+    if (!seen_trades_.insert(trade_id).second) return;
+
+    auto owner = order_instruments_.find(order_id);
+    if (owner == order_instruments_.end()) return;
+    std::string instrument_name = owner->second;
+    fills_.push_back(Fill{instrument_name, side, amount});
+
+    InstrumentQuotes& quotes = instruments_[instrument_name];
+    auto it = std::find_if(quotes.orders.begin(), quotes.orders.end(),
+                           [&](const ManagedOrder& live) { return live.order_id == order_id; });
+    if (it != quotes.orders.end()) {
+        it->filled += amount;
+        if (it->remaining() <= 1e-9) removeOrder(quotes, order_id);
+    }
+    deliverFills(lock);
+}
+
+void QuoteManager::removeOrder(InstrumentQuotes& quotes, const std::string& order_id) {
+    quotes.orders.erase(std::remove_if(quotes.orders.begin(), quotes.orders.end(),
+                                       [&](const ManagedOrder& live) { return live.order_id == order_id; }),
+                        quotes.orders.end());
+}
+
+void QuoteManager::deliverFills(std::unique_lock<std::mutex>& lock) {
+    if (fills_.empty() || !fill_handler_) {
+        fills_.clear();
+        return;
+    }
+    std::vector<Fill> fills;
+    fills.swap(fills_);
+    auto handler = fill_handler_;
+    lock.unlock();
+    for (const auto& fill : fills) handler(fill.instrument_name, fill.side, fill.amount);
+    lock.lock();
+}
+
+void QuoteManager::setFillHandler(std::function<void(const std::string&, OrderSide, double)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fill_handler_ = std::move(handler);
+}
+
+std::vector<ManagedOrder> QuoteManager::orders(const std::string& instrument_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = instruments_.find(instrument_name);
+    return it == instruments_.end() ? std::vector<ManagedOrder>() : it->second.orders;
+}
+
+QuoteManagerStats QuoteManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,165 @@
+#ifndef QUOTE_MANAGER_H
+#define QUOTE_MANAGER_H
+
+#include "metrics.h"
+#include "order_transport.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class TradeExecution;
+
+using json = nlohmann::json;
+
+// One resting quote: amount is the size left to trade at price
+struct QuoteLevel {
+    double price;
+    double amount;
+};
+
+// Target quotes for one instrument, in any order
+struct QuoteLadder {
+    std::vector<QuoteLevel> bids;
+    std::vector<QuoteLevel> asks;
+};
+
+// An open order as of the last reply or fill
+struct ManagedOrder {
+    std::string order_id;
+    OrderSide side;
+    double price;
+    double amount;      // total including fills, as private/edit takes it
+    double filled;
+
+    double remaining() const { return amount - filled; }
+};
+
+struct QuoteManagerConfig {
+    // Prices this close are the same level
+    double price_tolerance = 1e-9;
+    // An order whose remaining size is this close to its level is left
+    // alone, e.g. so a partial fill does not cost an amend
+    double size_tolerance = 1e-9;
+};
+
+struct QuoteManagerStats {
+    uint64_t targets = 0;       // setQuotes calls
+    uint64_t coalesced = 0;     // targets replaced before any request was based on them
+    uint64_t places = 0;
+    uint64_t amends = 0;
+    uint64_t cancels = 0;
+    uint64_t kept = 0;          // orders a reconciliation left untouched
+    uint64_t rejects = 0;       // requests answered with an error
+    uint64_t unconfirmed = 0;   // places with no answer, e.g. timed out
+    uint64_t confirmed = 0;     // of those, found resting in the open orders
+};
+
+// Keeps each instrument's open orders in line with a target ladder using as
+// few requests as possible. Per side, an order already at a target price
+// keeps its queue position and is amended only if its size is off; the other
+// orders are amended onto the remaining target prices, best first; only what
+// is left over is cancelled or placed. Requests go out through TradeExecution
+// one at a time. A setQuotes call for an instrument another thread is already
+// sending for only replaces the target: that thread drops the rest of its
+// plan after the request in flight and re-diffs against the newest target,
+// so superseded ladders are never sent.
+//
+// A place that gets no answer (a timeout, failover or transport error) may
+// still have reached the exchange, so it is not forgotten: it stays pending,
+// holding its level, until the instrument's open orders are fetched before
+// the next plan. An open order on the same side, price and size that the
+// manager does not know yet is adopted as the pending one; if there is none
+// the place is dropped. Amends and cancels need no such care, since the
+// order stays managed and the next plan puts it right.
+class QuoteManager {
+public:
+    explicit QuoteManager(TradeExecution& trade, QuoteManagerConfig config = {});
+
+    // Returns once the instrument's orders match the newest target, or at
+    // once if another thread is working on the instrument
+    void setQuotes(const std::string& instrument_name, QuoteLadder ladder);
+    void cancelAll(const std::string& instrument_name) { setQuotes(instrument_name, QuoteLadder{}); }
+
+    // A user.trades fill; trades already seen in a reply are skipped
+    void onFill(const std::string& order_id, const std::string& trade_id, OrderSide side, double amount);
+    // Called once per distinct trade on a managed order, from replies and
+    // onFill, outside the manager's lock
+    void setFillHandler(std::function<void(const std::string& instrument_name, OrderSide side, double amount)> handler);
+
+    std::vector<ManagedOrder> orders(const std::string& instrument_name) const;
+    QuoteManagerStats stats() const;
+
+private:
+    enum class ActionKind { Place, Amend, Cancel };
+
+    struct Action {
+        ActionKind kind;
+        OrderSide side;
+        std::string order_id;   // amend and cancel
+        double price;
+        double amount;
+    };
+
+    // A place whose outcome is unknown
+    struct PendingPlace {
+        OrderSide side;
+        double price;
+        double amount;
+    };
+
+    struct Fill {
+        std::string instrument_name;
+        OrderSide side;
+        double amount;
+    };
+
+    struct InstrumentQuotes {
+        QuoteLadder target;
+        uint64_t version = 0;
+        bool busy = false;      // a thread is sending for this instrument
+        bool unplanned = false; // target not yet diffed
+        std::vector<ManagedOrder> orders;
+        std::vector<PendingPlace> pending;
+    };
+
+    void confirmPending(const std::string& instrument_name, InstrumentQuotes& quotes,
+                        std::unique_lock<std::mutex>& lock);
+    std::vector<Action> plan(InstrumentQuotes& quotes);
+    void planSide(InstrumentQuotes& quotes, OrderSide side, std::vector<QuoteLevel> levels,
+                  std::vector<Action>& actions);
+    json send(const std::string& instrument_name, const Action& action);
+    void apply(const std::string& instrument_name, InstrumentQuotes& quotes, const Action& action,
+               const json& reply);
+    void recordTrades(const std::string& instrument_name, OrderSide side, const json& trades);
+    void removeOrder(InstrumentQuotes& quotes, const std::string& order_id);
+    ManagedOrder& trackOrder(const std::string& instrument_name, InstrumentQuotes& quotes,
+                             const std::string& order_id, OrderSide side);
+    void deliverFills(std::unique_lock<std::mutex>& lock);
+
+    static constexpr std::size_t kMaxTrackedOrders = 65536;
+    static constexpr std::size_t kMaxTrackedTrades = 65536;
+    static constexpr int kNotOpenOrder = 11044;
+
+    TradeExecution& trade_;
+    QuoteManagerConfig config_;
+    mutable std::mutex mutex_;
+    std::map<std::string, InstrumentQuotes> instruments_;
+    // order_id -> instrument for every order placed, kept after it closes so
+    // a fill reported late is still attributed
+    std::map<std::string, std::string> order_instruments_;
+    std::unordered_set<std::string> seen_trades_;
+    std::function<void(const std::string&, OrderSide, double)> fill_handler_;
+    std::vector<Fill> fills_;       // waiting for the lock to be released
+    QuoteManagerStats stats_;
+    Counter& places_;
+    Counter& amends_;
+    Counter& cancels_;
+    Counter& coalesced_;
+};
+
+#endif // QUOTE_MANAGER_H
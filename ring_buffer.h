@@ -0,0 +1,75 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity FIFO. Storage is allocated in the constructor and only
+// again by an explicit reserve, so push/pop never touch the heap. When full,
+// push_back overwrites the oldest element.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity = 0)
+        : data_(capacity), head_(0), size_(0) {}
+
+    void push_back(const T& value) {
+        if (data_.empty()) return;
+        if (size_ == data_.size()) {
+            data_[head_] = value;
+            head_ = next(head_);
+            return;
+        }
+        data_[index(size_)] = value;
+        ++size_;
+    }
+
+    void pop_front() {
+        if (size_ == 0) return;
+        head_ = next(head_);
+        --size_;
+    }
+
+    // Grow to capacity, keeping the elements in order; never shrinks
+    void reserve(std::size_t capacity) {
+        if (capacity <= data_.size()) return;
+        std::vector<T> data(capacity);
+        for (std::size_t i = 0; i < size_; ++i) data[i] = data_[index(i)];
+        data_.swap(data);
+        head_ = 0;
+    }
+
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    // Element i counted from the oldest entry
+    T& operator[](std::size_t i) { return data_[index(i)]; }
+    const T& operator[](std::size_t i) const { return data_[index(i)]; }
+
+    T& front() { return data_[head_]; }
+    const T& front() const { return data_[head_]; }
+    T& back() { return data_[index(size_ - 1)]; }
+    const T& back() const { return data_[index(size_ - 1)]; }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return data_.size(); }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == data_.size(); }
+
+private:
+    std::size_t index(std::size_t i) const {
+        std::size_t pos = head_ + i;
+        return pos >= data_.size() ? pos - data_.size() : pos;
+    }
+    std::size_t next(std::size_t pos) const {
+        return pos + 1 == data_.size() ? 0 : pos + 1;
+    }
+
+    std::vector<T> data_;
+    std::size_t head_;
+    std::size_t size_;
+};
+
+#endif // RING_BUFFER_H
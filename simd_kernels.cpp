@@ -0,0 +1,188 @@
+#include "simd_kernels.h"
+
+#if SIMD_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+bool hasAvx2() {
+#if SIMD_HAVE_AVX2 && defined(__GNUC__)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#elif SIMD_HAVE_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+namespace {
+
+double sumScalar(const double* a, std::size_t n) {
+    double total = 0.0;
+    for (std::size_t i = 0; i < n; ++i) total += a[i];
+    return total;
+}
+
+double dotScalar(const double* a, const double* b, std::size_t n) {
+    double total = 0.0;
+    for (std::size_t i = 0; i < n; ++i) total += a[i] * b[i];
+    return total;
+}
+
+void prefixSumScalar(const double* a, double* out, std::size_t n, double carry) {
+    for (std::size_t i = 0; i < n; ++i) {
+        carry += a[i];
+        out[i] = carry;
+    }
+}
+
+void prefixSumProductsScalar(const double* a, const double* b, double* out, std::size_t n, double carry) {
+    for (std::size_t i = 0; i < n; ++i) {
+        carry += a[i] * b[i];
+        out[i] = carry;
+    }
+}
+
+void prefixSumDeltasScalar(const int32_t* deltas, int64_t* out, std::size_t n, int64_t carry) {
+    for (std::size_t i = 0; i < n; ++i) {
+        carry += deltas[i];
+        out[i] = carry;
+    }
+}
+
+#if SIMD_HAVE_AVX2
+
+SIMD_TARGET_AVX2 double horizontalSum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+// In-register inclusive scan of four lanes: [x0, x0+x1, x0+x1+x2, x0+..+x3]
+SIMD_TARGET_AVX2 __m256d scan4(__m256d x) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d shifted = _mm256_permute4x64_pd(x, _MM_SHUFFLE(2, 1, 0, 0));
+    x = _mm256_add_pd(x, _mm256_blend_pd(shifted, zero, 0x1));
+    shifted = _mm256_permute4x64_pd(x, _MM_SHUFFLE(1, 0, 0, 0));
+    return _mm256_add_pd(x, _mm256_blend_pd(shifted, zero, 0x3));
+}
+
+SIMD_TARGET_AVX2 double sumAvx2(const double* a, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(a + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(a + i + 4));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(a + i));
+    }
+    return horizontalSum(_mm256_add_pd(acc0, acc1)) + sumScalar(a + i, n - i);
+}
+
+SIMD_TARGET_AVX2 double dotAvx2(const double* a, const double* b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    return horizontalSum(_mm256_add_pd(acc0, acc1)) + dotScalar(a + i, b + i, n - i);
+}
+
+SIMD_TARGET_AVX2 void prefixSumAvx2(const double* a, double* out, std::size_t n, double carry) {
+    __m256d running = _mm256_set1_pd(carry);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_add_pd(scan4(_mm256_loadu_pd(a + i)), running);
+        _mm256_storeu_pd(out + i, x);
+        running = _mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    if (i > 0) carry = out[i - 1];
+    prefixSumScalar(a + i, out + i, n - i, carry);
+}
+
+SIMD_TARGET_AVX2 void prefixSumProductsAvx2(const double* a, const double* b, double* out,
+                                            std::size_t n, double carry) {
+    __m256d running = _mm256_set1_pd(carry);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d prod = _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d x = _mm256_add_pd(scan4(prod), running);
+        _mm256_storeu_pd(out + i, x);
+        running = _mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    if (i > 0) carry = out[i - 1];
+    prefixSumProductsScalar(a + i, b + i, out + i, n - i, carry);
+}
+
+// Same scan on 64-bit integer lanes
+SIMD_TARGET_AVX2 __m256i scan4(__m256i x) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i shifted = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0));
+    x = _mm256_add_epi64(x, _mm256_blend_epi32(shifted, zero, 0x03));
+    shifted = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0));
+    return _mm256_add_epi64(x, _mm256_blend_epi32(shifted, zero, 0x0f));
+}
+
+SIMD_TARGET_AVX2 void prefixSumDeltasAvx2(const int32_t* deltas, int64_t* out, std::size_t n, int64_t carry) {
+    __m256i running = _mm256_set1_epi64x(carry);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i wide = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(deltas + i)));
+        __m256i x = _mm256_add_epi64(scan4(wide), running);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        running = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    if (i > 0) carry = out[i - 1];
+    prefixSumDeltasScalar(deltas + i, out + i, n - i, carry);
+}
+
+#endif // SIMD_HAVE_AVX2
+
+} // namespace
+
+double sum(const double* a, std::size_t n) {
+#if SIMD_HAVE_AVX2
+    if (hasAvx2()) return sumAvx2(a, n);
+#endif
+    return sumScalar(a, n);
+}
+
+double dot(const double* a, const double* b, std::size_t n) {
+#if SIMD_HAVE_AVX2
+    if (hasAvx2()) return dotAvx2(a, b, n);
+#endif
+    return dotScalar(a, b, n);
+}
+
+void prefixSum(const double* a, double* out, std::size_t n, double carry) {
+#if SIMD_HAVE_AVX2
+    if (hasAvx2()) return prefixSumAvx2(a, out, n, carry);
+#endif
+    prefixSumScalar(a, out, n, carry);
+}
+
+void prefixSumProducts(const double* a, const double* b, double* out, std::size_t n, double carry) {
+#if SIMD_HAVE_AVX2
+    if (hasAvx2()) return prefixSumProductsAvx2(a, b, out, n, carry);
+#endif
+    prefixSumProductsScalar(a, b, out, n, carry);
+}
+
+void prefixSumDeltas(const int32_t* deltas, int64_t* out, std::size_t n, int64_t carry) {
+#if SIMD_HAVE_AVX2
+    if (hasAvx2()) return prefixSumDeltasAvx2(deltas, out, n, carry);
+#endif
+    prefixSumDeltasScalar(deltas, out, n, carry);
+}
+
+} // namespace simd
@@ -0,0 +1,43 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// AVX2 code is compiled per function with a target attribute on GCC/Clang so
+// the binary does not need to be built with -mavx2; MSVC only gets the AVX2
+// path when the whole build targets it (/arch:AVX2).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_HAVE_AVX2 1
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define SIMD_HAVE_AVX2 1
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_HAVE_AVX2 0
+#define SIMD_TARGET_AVX2
+#endif
+
+// Numeric kernels over contiguous double arrays. Each has an AVX2 version and
+// a scalar fallback; the AVX2 path is taken when the CPU supports it.
+namespace simd {
+
+// Runtime check, evaluated once
+bool hasAvx2();
+
+double sum(const double* a, std::size_t n);
+double dot(const double* a, const double* b, std::size_t n);
+
+// out[i] = carry + a[0] + ... + a[i]
+void prefixSum(const double* a, double* out, std::size_t n, double carry = 0.0);
+
+// out[i] = carry + a[0]*b[0] + ... + a[i]*b[i]
+void prefixSumProducts(const double* a, const double* b, double* out, std::size_t n,
+                       double carry = 0.0);
+
+// Delta decoding: out[i] = carry + deltas[0] + ... + deltas[i]
+void prefixSumDeltas(const int32_t* deltas, int64_t* out, std::size_t n, int64_t carry = 0);
+
+} // namespace simd
+
+#endif // SIMD_KERNELS_H
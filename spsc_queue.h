@@ -0,0 +1,84 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two and allocated once. The
+// producer never blocks: try_push fails when the consumer has fallen a full
+// queue behind. Head and tail sit on separate cache lines, and each side keeps
+// a cached copy of the other's index so it only touches the shared line when
+// the cache says the queue looks full or empty. Values are moved out on pop,
+// so a queue of buffers hands them over without copying.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity)
+        : slots_(roundUp(capacity)), mask_(slots_.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only
+    bool try_push(const T& value) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (full(tail)) return false;
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer only; value is left untouched when the queue is full
+    bool try_push(T&& value) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (full(tail)) return false;
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool try_pop(T& value) {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is running
+    std::size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    std::size_t capacity() const { return slots_.size(); }
+
+private:
+    bool full(std::size_t tail) {
+        if (tail - head_cache_ != slots_.size()) return false;
+        head_cache_ = head_.load(std::memory_order_acquire);
+        return tail - head_cache_ == slots_.size();
+    }
+
+    static std::size_t roundUp(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+    std::vector<T> slots_;
+    std::size_t mask_;
+
+    alignas(64) std::atomic<std::size_t> head_{0};   // next slot to pop
+    std::size_t tail_cache_ = 0;                      // consumer's view of tail_
+    alignas(64) std::atomic<std::size_t> tail_{0};   // next slot to push
+    std::size_t head_cache_ = 0;                      // producer's view of head_
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,547 @@
+#include "tick_store.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace tick_store;
+
+namespace {
+
+constexpr int64_t kMsPerDay = 86400000;
+
+std::size_t alignUp(std::size_t n) {
+    return (n + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+int64_t dayOf(int64_t ms) {
+    return ms >= 0 ? ms / kMsPerDay : (ms - kMsPerDay + 1) / kMsPerDay;
+}
+
+std::size_t columnCount(TickKind kind) {
+    return kind == TickKind::Quote ? 6 : 5;
+}
+
+std::size_t encodingWidth(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Delta32: return 4;
+        case Encoding::Raw8: return 1;
+        default: return 8;
+    }
+}
+
+// Deltas of either sign in few bytes: zigzag maps small magnitudes to small
+// unsigned values, LEB128 stores seven bits per byte
+void appendVarint(std::vector<uint8_t>& out, int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+        out.push_back(static_cast<uint8_t>(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(zigzag));
+}
+
+void appendAligned(std::vector<uint8_t>& block, const void* data, std::size_t bytes) {
+    const uint8_t* begin = static_cast<const uint8_t*>(data);
+    block.insert(block.end(), begin, begin + bytes);
+    block.resize(alignUp(block.size()), 0);
+}
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TickRecord makeRecord(TickKind kind, const std::string& instrument, int64_t exchange_ms) {
+    TickRecord record{};
+    record.kind = kind;
+    std::size_t length = std::min(instrument.size(), sizeof(record.instrument) - 1);
+    std::memcpy(record.instrument, instrument.data(), length);
+    record.receive_ns = wallClockNs();
+    // Fall back to the local clock so the row still lands in the right day
+    record.exchange_ms = exchange_ms > 0 ? exchange_ms : record.receive_ns / 1000000;
+    return record;
+}
+
+} // namespace
+
+std::string tick_store::dayString(int64_t day) {
+    std::chrono::year_month_day date{std::chrono::sys_days{std::chrono::days{day}}};
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u", static_cast<int>(date.year()),
+                  static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()));
+    return text;
+}
+
+std::string tick_store::pathFor(const std::string& root, const std::string& instrument, int64_t day, TickKind kind) {
+    std::filesystem::path path(root);
+    path /= instrument;
+    path /= dayString(day) + (kind == TickKind::Quote ? ".quotes.dtk" : ".trades.dtk");
+    return path.string();
+}
+
+TickStoreWriter::TickStoreWriter(TickStoreConfig config)
+    : config_(std::move(config)),
+      queue_(config_.queue_capacity),
+      rows_(MetricsRegistry::instance().counter(
+          "deribit_tick_store_rows_total", "Quote and trade rows appended to the tick store")),
+      dropped_(MetricsRegistry::instance().counter(
+          "deribit_tick_store_dropped_total", "Rows dropped because the tick store queue was full")),
+      bytes_(MetricsRegistry::instance().counter(
+          "deribit_tick_store_bytes_total", "Bytes written to tick store files")) {
+    if (config_.block_rows == 0) config_.block_rows = 1;
+}
+
+TickStoreWriter::~TickStoreWriter() {
+    stop();
+}
+
+void TickStoreWriter::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void TickStoreWriter::stop() {
+    if (!running_.exchange(false)) return;
+    if (thread_.joinable()) thread_.join();
+}
+
+bool TickStoreWriter::recordQuote(const std::string& instrument, int64_t exchange_ms, double bid_price,
+                                  double bid_size, double ask_price, double ask_size) {
+    TickRecord record = makeRecord(TickKind::Quote, instrument, exchange_ms);
+    record.price = bid_price;
+    record.size = bid_size;
+    record.ask_price = ask_price;
+    record.ask_size = ask_size;
+    return push(record);
+}
+
+bool TickStoreWriter::recordTrade(const std::string& instrument, int64_t exchange_ms, double price, double amount,
+                                  bool buy) {
+    TickRecord record = makeRecord(TickKind::Trade, instrument, exchange_ms);
+    record.price = price;
+    record.size = amount;
+    record.buy = buy;
+    return push(record);
+}
+
+bool TickStoreWriter::push(const TickRecord& record) {
+    if (queue_.try_push(record)) return true;
+    dropped_.inc();
+    return false;
+}
+
+void TickStoreWriter::run() {
+    auto last_flush = std::chrono::steady_clock::now();
+    TickRecord record;
+    while (true) {
+        // Checked before draining so rows pushed ahead of stop() are kept
+        bool stopping = !running_.load(std::memory_order_acquire);
+        bool drained_any = false;
+        while (queue_.try_pop(record)) {
+            append(record);
+            drained_any = true;
+        }
+        if (stopping) break;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_flush >= config_.flush_interval) {
+            flushAll();
+            last_flush = now;
+        }
+        if (!drained_any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    flushAll();
+    for (auto& entry : streams_) {
+        if (entry.second->file.is_open()) entry.second->file.close();
+    }
+}
+
+TickStoreWriter::Stream& TickStoreWriter::streamFor(const TickRecord& record) {
+    auto key = std::make_pair(std::string(record.instrument), record.kind);
+    auto it = streams_.find(key);
+    if (it != streams_.end()) return *it->second;
+
+    auto stream = std::make_unique<Stream>();
+    stream->instrument = key.first;
+    stream->kind = record.kind;
+    return *streams_.emplace(std::move(key), std::move(stream)).first->second;
+}
+
+void TickStoreWriter::append(const TickRecord& record) {
+    Stream& stream = streamFor(record);
+
+    int64_t day = dayOf(record.exchange_ms);
+    if (day != stream.day) {
+        flushBlock(stream);
+        if (stream.file.is_open()) stream.file.close();
+        stream.day = day;
+        openFile(stream);
+    }
+    if (stream.disabled) return;
+
+    if (record.kind == TickKind::Quote) {
+        if (stream.has_last && record.price == stream.last.price && record.size == stream.last.size
+            && record.ask_price == stream.last.ask_price && record.ask_size == stream.last.ask_size) {
+            return;
+        }
+        stream.last = record;
+        stream.has_last = true;
+    }
+
+    stream.exchange_ms.push_back(record.exchange_ms);
+    stream.receive_ns.push_back(record.receive_ns);
+    stream.price.push_back(std::llround(record.price * config_.price_scale));
+    stream.size.push_back(record.size);
+    if (record.kind == TickKind::Quote) {
+        stream.ask_price.push_back(std::llround(record.ask_price * config_.price_scale));
+        stream.ask_size.push_back(record.ask_size);
+    } else {
+        stream.buy.push_back(record.buy ? 1 : 0);
+    }
+    rows_.inc();
+
+    if (stream.exchange_ms.size() >= config_.block_rows) flushBlock(stream);
+}
+
+// Continue an existing file after checking it is compatible, cutting off a
+// block left half written by a crash; otherwise start a new one
+void TickStoreWriter::openFile(Stream& stream) {
+    std::string path = pathFor(config_.root, stream.instrument, stream.day, stream.kind);
+    stream.disabled = false;
+    try {
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+
+        std::error_code ec;
+        uintmax_t file_size = std::filesystem::file_size(path, ec);
+        if (!ec && file_size >= sizeof(FileHeader)) {
+            std::ifstream in(path, std::ios::binary);
+            FileHeader header{};
+            in.read(reinterpret_cast<char*>(&header), sizeof(header));
+            // Older readers cannot take newer blocks, so only append to this version
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+                || header.kind != static_cast<uint8_t>(stream.kind) || header.price_scale != config_.price_scale
+                || stream.instrument != header.instrument) {
+                std::cerr << "Tick store file " << path << " has a different layout, not appending" << std::endl;
+                stream.disabled = true;
+                return;
+            }
+
+            uintmax_t valid = sizeof(FileHeader);
+            BlockHeader block{};
+            while (valid + sizeof(block) <= file_size) {
+                in.seekg(static_cast<std::streamoff>(valid));
+                if (!in.read(reinterpret_cast<char*>(&block), sizeof(block))) break;
+                if (block.magic != kBlockMagic || block.bytes < sizeof(block) || valid + block.bytes > file_size) break;
+                valid += block.bytes;
+            }
+            in.close();
+            if (valid < file_size) std::filesystem::resize_file(path, valid);
+            stream.file.open(path, std::ios::binary | std::ios::app);
+        } else {
+            FileHeader header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.kind = static_cast<uint8_t>(stream.kind);
+            header.column_count = static_cast<uint8_t>(columnCount(stream.kind));
+            header.day = stream.day;
+            header.price_scale = config_.price_scale;
+            std::strncpy(header.instrument, stream.instrument.c_str(), sizeof(header.instrument) - 1);
+            stream.file.open(path, std::ios::binary | std::ios::trunc);
+            stream.file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            bytes_.inc(sizeof(header));
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error opening tick store file " << path << ": " << e.what() << std::endl;
+    }
+    if (!stream.file) {
+        std::cerr << "Cannot write tick store file " << path << std::endl;
+        stream.disabled = true;
+    }
+}
+
+void TickStoreWriter::flushBlock(Stream& stream) {
+    std::size_t rows = stream.exchange_ms.size();
+    if (rows == 0) return;
+
+    if (!stream.disabled) {
+        BlockHeader header{};
+        header.magic = kBlockMagic;
+        header.rows = static_cast<uint32_t>(rows);
+        header.first_ms = stream.exchange_ms.front();
+        header.last_ms = stream.exchange_ms.back();
+
+        std::vector<uint8_t> block(alignUp(sizeof(BlockHeader)), 0);
+        std::vector<int32_t> deltas(rows);
+        std::vector<uint8_t> varints;
+
+        auto addInts = [&](std::size_t index, const std::vector<int64_t>& values) {
+            ColumnHeader& column = header.columns[index];
+            column.offset = block.size();
+            bool fits = true;
+            deltas[0] = 0;
+            for (std::size_t i = 1; i < rows && fits; ++i) {
+                int64_t delta = values[i] - values[i - 1];
+                fits = delta >= std::numeric_limits<int32_t>::min() && delta <= std::numeric_limits<int32_t>::max();
+                deltas[i] = static_cast<int32_t>(delta);
+            }
+            if (fits) {
+                column.encoding = static_cast<uint8_t>(Encoding::Delta32);
+                column.base = values[0];
+                appendAligned(block, deltas.data(), rows * sizeof(int32_t));
+            } else {
+                // Wrapping subtraction, so even a full int64 range round-trips
+                varints.clear();
+                for (std::size_t i = 1; i < rows; ++i) {
+                    appendVarint(varints, static_cast<int64_t>(static_cast<uint64_t>(values[i])
+                                                               - static_cast<uint64_t>(values[i - 1])));
+                }
+                column.encoding = static_cast<uint8_t>(Encoding::Varint);
+                column.base = values[0];
+                column.bytes = static_cast<uint32_t>(varints.size());
+                appendAligned(block, varints.data(), varints.size());
+            }
+        };
+        auto addRaw = [&](std::size_t index, Encoding encoding, const void* data) {
+            ColumnHeader& column = header.columns[index];
+            column.encoding = static_cast<uint8_t>(encoding);
+            column.offset = block.size();
+            appendAligned(block, data, rows * encodingWidth(encoding));
+        };
+
+        addInts(kExchangeMs, stream.exchange_ms);
+        addInts(kReceiveNs, stream.receive_ns);
+        addInts(kPrice, stream.price);
+        if (stream.kind == TickKind::Quote) {
+            addInts(kAskPriceOrAmount, stream.ask_price);
+            addRaw(kSizeOrBuy, Encoding::Raw64, stream.size.data());
+            addRaw(kAskSize, Encoding::Raw64, stream.ask_size.data());
+        } else {
+            addRaw(kAskPriceOrAmount, Encoding::Raw64, stream.size.data());
+            addRaw(kSizeOrBuy, Encoding::Raw8, stream.buy.data());
+        }
+
+        header.bytes = block.size();
+        std::memcpy(block.data(), &header, sizeof(header));
+        stream.file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+        stream.file.flush();
+        if (!stream.file) {
+            std::cerr << "Error writing tick store block for " << stream.instrument << std::endl;
+            stream.disabled = true;
+        } else {
+            bytes_.inc(block.size());
+        }
+    }
+
+    stream.exchange_ms.clear();
+    stream.receive_ns.clear();
+    stream.price.clear();
+    stream.ask_price.clear();
+    stream.size.clear();
+    stream.ask_size.clear();
+    stream.buy.clear();
+}
+
+void TickStoreWriter::flushAll() {
+    for (auto& entry : streams_) {
+        flushBlock(*entry.second);
+    }
+}
+
+TickStoreReader::TickStoreReader(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open tick store file " + path);
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat tick store file " + path);
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map tick store file " + path);
+        }
+        ::madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(mapping);
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open tick store file " + path);
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+
+    header_ = reinterpret_cast<const FileHeader*>(data_);
+    if (size_ < sizeof(FileHeader) || std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0
+        || header_->version < kMinVersion || header_->version > kVersion || header_->column_count > kMaxColumns) {
+        unmap();
+        throw std::runtime_error("Not a tick store file: " + path);
+    }
+
+    std::size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= size_) {
+        const auto* block = reinterpret_cast<const BlockHeader*>(data_ + offset);
+        if (block->magic != kBlockMagic || block->bytes < sizeof(BlockHeader) || offset + block->bytes > size_) break;
+        bool columns_ok = true;
+        for (std::size_t i = 0; i < header_->column_count; ++i) {
+            const ColumnHeader& column = block->columns[i];
+            Encoding encoding = static_cast<Encoding>(column.encoding);
+            std::size_t length = encoding == Encoding::Varint ? column.bytes
+                                                              : block->rows * encodingWidth(encoding);
+            columns_ok = columns_ok && column.offset % kAlignment == 0
+                && column.offset + length <= block->bytes;
+        }
+        if (!columns_ok) break;
+        blocks_.push_back(block);
+        rows_ += block->rows;
+        offset += block->bytes;
+    }
+}
+
+TickStoreReader::~TickStoreReader() {
+    unmap();
+}
+
+void TickStoreReader::unmap() {
+#ifndef _WIN32
+    if (data_ && size_ > 0) ::munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+}
+
+const uint8_t* TickStoreReader::column(const BlockHeader& block, std::size_t index) const {
+    return reinterpret_cast<const uint8_t*>(&block) + block.columns[index].offset;
+}
+
+const int64_t* TickStoreReader::decodeInts(const BlockHeader& block, std::size_t index, std::vector<int64_t>& out) {
+    const ColumnHeader& header = block.columns[index];
+    Encoding encoding = static_cast<Encoding>(header.encoding);
+    if (encoding == Encoding::Varint) {
+        out.resize(block.rows);
+        const uint8_t* in = column(block, index);
+        const uint8_t* end = in + header.bytes;
+        uint64_t value = static_cast<uint64_t>(header.base);
+        for (std::size_t i = 0; i < block.rows; ++i) {
+            if (i > 0) {
+                uint64_t zigzag = 0;
+                int shift = 0;
+                uint8_t byte = 0x80;
+                while (byte & 0x80) {
+                    if (in == end || shift > 63) throw std::runtime_error("Corrupt varint column in tick store block");
+                    byte = *in++;
+                    zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                    shift += 7;
+                }
+                value += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+            }
+            out[i] = static_cast<int64_t>(value);
+        }
+        return out.data();
+    }
+    if (encoding != Encoding::Delta32) {
+        return reinterpret_cast<const int64_t*>(column(block, index));
+    }
+    out.resize(block.rows);
+    simd::prefixSumDeltas(reinterpret_cast<const int32_t*>(column(block, index)), out.data(), block.rows, header.base);
+    return out.data();
+}
+
+const double* TickStoreReader::decodePrices(const BlockHeader& block, std::size_t index, std::vector<int64_t>& ints,
+                                            std::vector<double>& out) {
+    const int64_t* fixed = decodeInts(block, index, ints);
+    double inverse = 1.0 / header_->price_scale;
+    out.resize(block.rows);
+    for (std::size_t i = 0; i < block.rows; ++i) {
+        out[i] = static_cast<double>(fixed[i]) * inverse;
+    }
+    return out.data();
+}
+
+QuoteColumns TickStoreReader::quotes(std::size_t index) {
+    if (kind() != TickKind::Quote) throw std::logic_error("Tick store file holds trades, not quotes");
+    const BlockHeader& block = *blocks_.at(index);
+    QuoteColumns columns;
+    columns.rows = block.rows;
+    columns.exchange_ms = decodeInts(block, kExchangeMs, exchange_ms_);
+    columns.receive_ns = decodeInts(block, kReceiveNs, receive_ns_);
+    columns.bid_price = decodePrices(block, kPrice, price_ints_, price_);
+    columns.ask_price = decodePrices(block, kAskPriceOrAmount, ask_price_ints_, ask_price_);
+    columns.bid_size = reinterpret_cast<const double*>(column(block, kSizeOrBuy));
+    columns.ask_size = reinterpret_cast<const double*>(column(block, kAskSize));
+    return columns;
+}
+
+TradeColumns TickStoreReader::trades(std::size_t index) {
+    if (kind() != TickKind::Trade) throw std::logic_error("Tick store file holds quotes, not trades");
+    const BlockHeader& block = *blocks_.at(index);
+    TradeColumns columns;
+    columns.rows = block.rows;
+    columns.exchange_ms = decodeInts(block, kExchangeMs, exchange_ms_);
+    columns.receive_ns = decodeInts(block, kReceiveNs, receive_ns_);
+    columns.price = decodePrices(block, kPrice, price_ints_, price_);
+    columns.amount = reinterpret_cast<const double*>(column(block, kAskPriceOrAmount));
+    columns.buy = column(block, kSizeOrBuy);
+    return columns;
+}
+
+bool TickStoreReader::summarise(const std::string& path, std::ostream& out) {
+    try {
+        TickStoreReader reader(path);
+        out << reader.instrument() << " " << dayString(reader.day())
+            << (reader.kind() == TickKind::Quote ? " quotes" : " trades") << ": " << reader.rows()
+            << " rows in " << reader.blocks() << " blocks\n";
+        if (reader.rows() == 0) return true;
+        out << "  exchange time " << reader.blockFirstMs(0) << " .. "
+            << reader.blockLastMs(reader.blocks() - 1) << " ms\n";
+
+        if (reader.kind() == TickKind::Quote) {
+            double bid_total = 0.0, ask_total = 0.0, bid_size_total = 0.0, ask_size_total = 0.0;
+            for (std::size_t b = 0; b < reader.blocks(); ++b) {
+                QuoteColumns q = reader.quotes(b);
+                bid_total += simd::sum(q.bid_price, q.rows);
+                ask_total += simd::sum(q.ask_price, q.rows);
+                bid_size_total += simd::sum(q.bid_size, q.rows);
+                ask_size_total += simd::sum(q.ask_size, q.rows);
+            }
+            double n = static_cast<double>(reader.rows());
+            out << "  mean spread " << (ask_total - bid_total) / n << ", mean bid size " << bid_size_total / n
+                << ", mean ask size " << ask_size_total / n << "\n";
+        } else {
+            double volume = 0.0, notional = 0.0, buy_volume = 0.0;
+            for (std::size_t b = 0; b < reader.blocks(); ++b) {
+                TradeColumns t = reader.trades(b);
+                volume += simd::sum(t.amount, t.rows);
+                notional += simd::dot(t.price, t.amount, t.rows);
+                for (std::size_t i = 0; i < t.rows; ++i) {
+                    if (t.buy[i]) buy_volume += t.amount[i];
+                }
+            }
+            out << "  volume " << volume << ", VWAP " << (volume > 0.0 ? notional / volume : 0.0)
+                << ", buy share " << (volume > 0.0 ? buy_volume / volume : 0.0) << "\n";
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error reading tick store: " << e.what() << std::endl;
+        return false;
+    }
+}
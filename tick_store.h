@@ -0,0 +1,234 @@
+#ifndef TICK_STORE_H
+#define TICK_STORE_H
+
+#include "metrics.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class TickKind : uint8_t { Quote = 0, Trade = 1 };
+
+// On-disk layout shared by the writer and the reader. One file per
+// instrument, UTC day and kind: a FileHeader followed by self-describing
+// blocks of up to block_rows rows. Each block stores its columns back to
+// back, every column starting on a 64-byte boundary. Timestamps and prices
+// (fixed point, price * price_scale) are stored as int32 deltas from the
+// previous row when the whole block fits, otherwise as zigzag varint deltas
+// (a receive_ns gap of more than 2.1 s already overflows int32). Sizes are
+// raw doubles, which the reader hands out straight from the mapping.
+namespace tick_store {
+
+constexpr char kMagic[8] = {'D', 'T', 'K', 'S', 'T', 'O', 'R', 'E'};
+constexpr uint32_t kVersion = 2;              // 2 added Varint columns
+constexpr uint32_t kMinVersion = 1;           // oldest the reader takes
+constexpr uint32_t kBlockMagic = 0x314b4c42;    // "BLK1"
+constexpr std::size_t kAlignment = 64;
+constexpr std::size_t kMaxColumns = 6;
+
+enum class Encoding : uint8_t { Raw64 = 0, Delta32 = 1, Raw8 = 2, Varint = 3 };
+
+// Quote columns: exchange_ms, receive_ns, bid_price, ask_price, bid_size, ask_size
+// Trade columns: exchange_ms, receive_ns, price, amount, buy
+enum Column : std::size_t {
+    kExchangeMs = 0,
+    kReceiveNs = 1,
+    kPrice = 2,             // trade price or best bid
+    kAskPriceOrAmount = 3,
+    kSizeOrBuy = 4,         // best bid size, or trade aggressor (1 = buy)
+    kAskSize = 5
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint8_t kind;
+    uint8_t column_count;
+    uint16_t reserved;
+    int64_t day;            // days since 1970-01-01 UTC
+    double price_scale;
+    char instrument[48];
+    uint8_t padding[48];
+};
+static_assert(sizeof(FileHeader) == 128, "file header is two cache lines");
+
+struct ColumnHeader {
+    uint8_t encoding;
+    uint8_t reserved[3];
+    uint32_t bytes;         // encoded length for Varint
+    int64_t base;           // value of the first row for Delta32 and Varint
+    uint64_t offset;        // from the start of the block
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t rows;
+    uint64_t bytes;         // header, columns and padding
+    int64_t first_ms;
+    int64_t last_ms;
+    ColumnHeader columns[kMaxColumns];
+};
+
+// Days since the epoch as YYYY-MM-DD
+std::string dayString(int64_t day);
+// ROOT/INSTRUMENT/YYYY-MM-DD.quotes.dtk or .trades.dtk
+std::string pathFor(const std::string& root, const std::string& instrument, int64_t day, TickKind kind);
+
+} // namespace tick_store
+
+// One row on its way from the market data thread to the writer thread
+struct TickRecord {
+    TickKind kind;
+    bool buy;                   // trades: aggressor side
+    char instrument[46];        // NUL-terminated, truncated if longer
+    int64_t exchange_ms;
+    int64_t receive_ns;         // local wall clock
+    double price;               // trade price or best bid
+    double size;                // trade amount or best bid size
+    double ask_price;           // quotes only
+    double ask_size;
+};
+
+struct TickStoreConfig {
+    std::string root = "ticks";
+    std::size_t queue_capacity = 65536;
+    uint32_t block_rows = 4096;
+    double price_scale = 1e6;
+    // Partial blocks are written at least this often so readers see recent data
+    std::chrono::milliseconds flush_interval{10000};
+};
+
+// Appends top-of-book changes and trades to columnar files. The record*
+// calls come from the market data thread and only copy into an SPSC queue;
+// encoding and file I/O happen on the store's own thread. Rows that do not
+// fit in the queue are dropped and counted. Quotes equal to the previous
+// quote for the instrument are not stored.
+class TickStoreWriter {
+public:
+    explicit TickStoreWriter(TickStoreConfig config);
+    ~TickStoreWriter();
+
+    void start();
+    // Drain the queue, write partial blocks and close the files
+    void stop();
+
+    // Single producer: call from one thread only
+    bool recordQuote(const std::string& instrument, int64_t exchange_ms, double bid_price, double bid_size,
+                     double ask_price, double ask_size);
+    bool recordTrade(const std::string& instrument, int64_t exchange_ms, double price, double amount, bool buy);
+
+private:
+    struct Stream {
+        std::string instrument;
+        TickKind kind;
+        int64_t day = -1;
+        std::ofstream file;
+        bool disabled = false;
+        std::vector<int64_t> exchange_ms;
+        std::vector<int64_t> receive_ns;
+        std::vector<int64_t> price;
+        std::vector<int64_t> ask_price;      // trades: unused
+        std::vector<double> size;
+        std::vector<double> ask_size;        // trades: unused
+        std::vector<uint8_t> buy;            // quotes: unused
+        TickRecord last{};
+        bool has_last = false;
+    };
+
+    bool push(const TickRecord& record);
+    void run();
+    void append(const TickRecord& record);
+    Stream& streamFor(const TickRecord& record);
+    void openFile(Stream& stream);
+    void flushBlock(Stream& stream);
+    void flushAll();
+
+    TickStoreConfig config_;
+    SpscQueue<TickRecord> queue_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::map<std::pair<std::string, TickKind>, std::unique_ptr<Stream>> streams_;
+    Counter& rows_;
+    Counter& dropped_;
+    Counter& bytes_;
+};
+
+struct QuoteColumns {
+    std::size_t rows = 0;
+    const int64_t* exchange_ms = nullptr;
+    const int64_t* receive_ns = nullptr;
+    const double* bid_price = nullptr;
+    const double* ask_price = nullptr;
+    const double* bid_size = nullptr;
+    const double* ask_size = nullptr;
+};
+
+struct TradeColumns {
+    std::size_t rows = 0;
+    const int64_t* exchange_ms = nullptr;
+    const int64_t* receive_ns = nullptr;
+    const double* price = nullptr;
+    const double* amount = nullptr;
+    const uint8_t* buy = nullptr;
+};
+
+// Memory-maps one store file and decodes it a block at a time into
+// contiguous arrays. A block cut short by a crash ends the file.
+class TickStoreReader {
+public:
+    // Throws std::runtime_error if the file cannot be opened or is not a store file
+    explicit TickStoreReader(const std::string& path);
+    ~TickStoreReader();
+
+    TickStoreReader(const TickStoreReader&) = delete;
+    TickStoreReader& operator=(const TickStoreReader&) = delete;
+
+    TickKind kind() const { return static_cast<TickKind>(header_->kind); }
+    std::string instrument() const { return header_->instrument; }
+    int64_t day() const { return header_->day; }
+    double priceScale() const { return header_->price_scale; }
+
+    std::size_t blocks() const { return blocks_.size(); }
+    std::size_t rows() const { return rows_; }
+    // Exchange time range of a block, for skipping it without decoding
+    int64_t blockFirstMs(std::size_t block) const { return blocks_[block]->first_ms; }
+    int64_t blockLastMs(std::size_t block) const { return blocks_[block]->last_ms; }
+
+    // Decode one block. The pointers stay valid until the next call.
+    QuoteColumns quotes(std::size_t block);
+    TradeColumns trades(std::size_t block);
+
+    // Print row counts, time range and column summaries for a file
+    static bool summarise(const std::string& path, std::ostream& out);
+
+private:
+    void unmap();
+    const uint8_t* column(const tick_store::BlockHeader& block, std::size_t index) const;
+    const int64_t* decodeInts(const tick_store::BlockHeader& block, std::size_t index, std::vector<int64_t>& out);
+    const double* decodePrices(const tick_store::BlockHeader& block, std::size_t index, std::vector<int64_t>& ints,
+                               std::vector<double>& out);
+
+    const uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<uint8_t> buffer_;       // used where mmap is unavailable
+    const tick_store::FileHeader* header_ = nullptr;
+    std::vector<const tick_store::BlockHeader*> blocks_;
+    std::size_t rows_ = 0;
+
+    std::vector<int64_t> exchange_ms_;
+    std::vector<int64_t> receive_ns_;
+    std::vector<int64_t> price_ints_;
+    std::vector<int64_t> ask_price_ints_;
+    std::vector<double> price_;
+    std::vector<double> ask_price_;
+};
+
+#endif // TICK_STORE_H
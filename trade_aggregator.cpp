@@ -0,0 +1,193 @@
+#include "trade_aggregator.h"
+#include <algorithm>
+#include <iostream>
+
+TradeAggregator::TradeAggregator(int64_t window_ms, int64_t bar_interval_ms,
+                                 std::size_t window_capacity, std::size_t bar_history,
+                                 std::size_t max_window_capacity)
+    : window_ms_(window_ms),
+      bar_interval_ms_(bar_interval_ms > 0 ? bar_interval_ms : 1000),
+      window_capacity_(window_capacity),
+      bar_history_(bar_history),
+      max_window_capacity_(std::max(window_capacity, max_window_capacity)) {}
+
+template <typename Json>
+void TradeAggregator::handleTradeNotification(const Json& trades) {
+    try {
+        if (!trades.is_array()) return;
+
+        for (const auto& t : trades) {
+            if (!t.contains("instrument_name") || !t.contains("price") || !t.contains("amount")) {
+                continue;
+            }
+            TradeTick tick;
+            tick.timestamp_ms = t.value("timestamp", int64_t{0});
+            tick.price = t["price"].template get<double>();
+            tick.amount = t["amount"].template get<double>();
+            tick.is_buy = t.contains("direction") && t["direction"] == "buy";
+
+            // get_ref avoids copying the instrument name for the map lookup
+            onTrade(t["instrument_name"].template get_ref<const std::string&>(), tick);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling trade notification: " << e.what() << std::endl;
+    }
+}
+
+template void TradeAggregator::handleTradeNotification<json>(const json&);
+template void TradeAggregator::handleTradeNotification<arena_json>(const arena_json&);
+
+void TradeAggregator::onTrade(const std::string& instrument_name, const TradeTick& trade) {
+    InstrumentTape& tape = tapeFor(instrument_name);
+
+    // A full ring means the window holds more trades than we sized for. Grow
+    // it while we may; at the limit the oldest trade is about to be
+    // overwritten, so take it out of the sums first.
+    if (tape.window.full() && tape.window.capacity() > 0) {
+        evict(tape, std::max(tape.last_trade_ms, trade.timestamp_ms));
+        if (tape.window.full() && tape.window.capacity() < max_window_capacity_) {
+            tape.window.reserve(std::min(tape.window.capacity() * 2, max_window_capacity_));
+        } else if (tape.window.full()) {
+            removeFromWindow(tape, tape.window.front());
+            tape.window.pop_front();
+            ++tape.overflowed;
+        }
+    }
+
+    tape.window.push_back(trade);
+    tape.notional_sum += trade.price * trade.amount;
+    tape.volume_sum += trade.amount;
+    (trade.is_buy ? tape.buy_sum : tape.sell_sum) += trade.amount;
+    tape.last_trade_ms = std::max(tape.last_trade_ms, trade.timestamp_ms);
+
+    evict(tape, tape.last_trade_ms);
+    if (++tape.since_resum >= tape.window.capacity()) resum(tape);
+    updateBar(tape, trade);
+}
+
+void TradeAggregator::expire(int64_t now_ms) {
+    for (auto& entry : tapes_) {
+        evict(entry.second, now_ms);
+    }
+}
+
+void TradeAggregator::reserveInstrument(const std::string& instrument_name) {
+    tapeFor(instrument_name);
+}
+
+bool TradeAggregator::hasInstrument(const std::string& instrument_name) const {
+    return tapes_.count(instrument_name) != 0;
+}
+
+TradeWindowStats TradeAggregator::windowStats(const std::string& instrument_name) const {
+    TradeWindowStats stats;
+    auto it = tapes_.find(instrument_name);
+    if (it == tapes_.end()) return stats;
+
+    const InstrumentTape& tape = it->second;
+    stats.volume = tape.volume_sum;
+    stats.buy_volume = tape.buy_sum;
+    stats.sell_volume = tape.sell_sum;
+    stats.trade_count = tape.window.size();
+    stats.last_trade_ms = tape.last_trade_ms;
+    stats.overflowed = tape.overflowed;
+    if (tape.volume_sum > 0.0) {
+        stats.vwap = tape.notional_sum / tape.volume_sum;
+    }
+    double total = tape.buy_sum + tape.sell_sum;
+    if (total > 0.0) {
+        stats.imbalance = (tape.buy_sum - tape.sell_sum) / total;
+    }
+    return stats;
+}
+
+OhlcvBar TradeAggregator::currentBar(const std::string& instrument_name) const {
+    auto it = tapes_.find(instrument_name);
+    if (it == tapes_.end() || !it->second.has_bar) return OhlcvBar{};
+    return it->second.current;
+}
+
+std::vector<OhlcvBar> TradeAggregator::completedBars(const std::string& instrument_name,
+                                                     std::size_t max_bars) const {
+    std::vector<OhlcvBar> result;
+    auto it = tapes_.find(instrument_name);
+    if (it == tapes_.end()) return result;
+
+    const RingBuffer<OhlcvBar>& bars = it->second.bars;
+    std::size_t count = std::min(max_bars, bars.size());
+    result.reserve(count);
+    for (std::size_t i = bars.size() - count; i < bars.size(); ++i) {
+        result.push_back(bars[i]);
+    }
+    return result;
+}
+
+TradeAggregator::InstrumentTape& TradeAggregator::tapeFor(const std::string& instrument_name) {
+    auto it = tapes_.find(instrument_name);
+    if (it != tapes_.end()) return it->second;
+    return tapes_.emplace(instrument_name, InstrumentTape(window_capacity_, bar_history_)).first->second;
+}
+
+void TradeAggregator::evict(InstrumentTape& tape, int64_t now_ms) {
+    const int64_t cutoff = now_ms - window_ms_;
+    while (!tape.window.empty() && tape.window.front().timestamp_ms <= cutoff) {
+        removeFromWindow(tape, tape.window.front());
+        tape.window.pop_front();
+    }
+
+    // Reset the running sums whenever the window drains so floating point
+    // error from add/subtract cannot accumulate indefinitely.
+    if (tape.window.empty()) {
+        tape.notional_sum = 0.0;
+        tape.volume_sum = 0.0;
+        tape.buy_sum = 0.0;
+        tape.sell_sum = 0.0;
+    }
+}
+
+void TradeAggregator::removeFromWindow(InstrumentTape& tape, const TradeTick& trade) {
+    tape.notional_sum -= trade.price * trade.amount;
+    tape.volume_sum -= trade.amount;
+    (trade.is_buy ? tape.buy_sum : tape.sell_sum) -= trade.amount;
+}
+
+void TradeAggregator::resum(InstrumentTape& tape) {
+    tape.notional_sum = 0.0;
+    tape.volume_sum = 0.0;
+    tape.buy_sum = 0.0;
+    tape.sell_sum = 0.0;
+    for (std::size_t i = 0; i < tape.window.size(); ++i) {
+        const TradeTick& trade = tape.window[i];
+        tape.notional_sum += trade.price * trade.amount;
+        tape.volume_sum += trade.amount;
+        (trade.is_buy ? tape.buy_sum : tape.sell_sum) += trade.amount;
+    }
+    tape.since_resum = 0;
+}
+
+void TradeAggregator::updateBar(InstrumentTape& tape, const TradeTick& trade) {
+    const int64_t bar_start = trade.timestamp_ms - (trade.timestamp_ms % bar_interval_ms_);
+
+    // Bars are only emitted for intervals that saw trades. A late print for an
+    // already closed interval is folded into the current bar.
+    if (!tape.has_bar || bar_start > tape.current.open_time_ms) {
+        if (tape.has_bar) {
+            tape.bars.push_back(tape.current);
+        }
+        tape.current = OhlcvBar{};
+        tape.current.open_time_ms = bar_start;
+        tape.current.open = trade.price;
+        tape.current.high = trade.price;
+        tape.current.low = trade.price;
+        tape.has_bar = true;
+    }
+
+    OhlcvBar& bar = tape.current;
+    bar.high = std::max(bar.high, trade.price);
+    bar.low = std::min(bar.low, trade.price);
+    bar.close = trade.price;
+    bar.volume += trade.amount;
+    (trade.is_buy ? bar.buy_volume : bar.sell_volume) += trade.amount;
+    ++bar.trade_count;
+}
@@ -0,0 +1,110 @@
+#ifndef TRADE_AGGREGATOR_H
+#define TRADE_AGGREGATOR_H
+
+#include "ring_buffer.h"
+#include "message_arena.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// A single print from the trades.* channel
+struct TradeTick {
+    int64_t timestamp_ms;
+    double price;
+    double amount;
+    bool is_buy;
+};
+
+struct OhlcvBar {
+    int64_t open_time_ms = 0;
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    double volume = 0.0;
+    double buy_volume = 0.0;
+    double sell_volume = 0.0;
+    uint32_t trade_count = 0;
+};
+
+// Rolling-window figures for one instrument
+struct TradeWindowStats {
+    double vwap = 0.0;
+    double volume = 0.0;
+    double buy_volume = 0.0;
+    double sell_volume = 0.0;
+    double imbalance = 0.0;   // (buy - sell) / (buy + sell), in [-1, 1]
+    std::size_t trade_count = 0;
+    int64_t last_trade_ms = 0;
+    uint64_t overflowed = 0;  // trades pushed out early by a window at its largest
+};
+
+// Incrementally maintains rolling VWAP, buy/sell imbalance and OHLCV bars per
+// instrument. Every update is O(1) amortised over preallocated ring buffers.
+// A window that fills before its trades age out doubles, up to
+// max_window_capacity; past that the oldest trades leave early and are
+// counted. Running sums are recomputed from the window once per capacity's
+// worth of trades, so add/subtract rounding cannot build up on a busy tape.
+// Call expire periodically: trades otherwise only age out when the next
+// trade on the same instrument arrives.
+class TradeAggregator {
+public:
+    TradeAggregator(int64_t window_ms = 60000, int64_t bar_interval_ms = 1000,
+                    std::size_t window_capacity = 8192, std::size_t bar_history = 512,
+                    std::size_t max_window_capacity = 131072);
+
+    // Feed the "data" array of a trades.* notification (json or arena_json)
+    template <typename Json>
+    void handleTradeNotification(const Json& trades);
+    void onTrade(const std::string& instrument_name, const TradeTick& trade);
+
+    // Drop trades that fell out of the window as of now_ms (e.g. on a quiet tape)
+    void expire(int64_t now_ms);
+
+    // Preallocate state so the first trade on the hot path does not allocate
+    void reserveInstrument(const std::string& instrument_name);
+
+    bool hasInstrument(const std::string& instrument_name) const;
+    TradeWindowStats windowStats(const std::string& instrument_name) const;
+    OhlcvBar currentBar(const std::string& instrument_name) const;
+    // Most recent completed bars, oldest first
+    std::vector<OhlcvBar> completedBars(const std::string& instrument_name, std::size_t max_bars) const;
+
+private:
+    struct InstrumentTape {
+        InstrumentTape(std::size_t window_capacity, std::size_t bar_history)
+            : window(window_capacity), bars(bar_history) {}
+
+        RingBuffer<TradeTick> window;
+        double notional_sum = 0.0;
+        double volume_sum = 0.0;
+        double buy_sum = 0.0;
+        double sell_sum = 0.0;
+        int64_t last_trade_ms = 0;
+        uint64_t overflowed = 0;
+        std::size_t since_resum = 0;    // trades added since the sums were recomputed
+
+        OhlcvBar current;
+        bool has_bar = false;
+        RingBuffer<OhlcvBar> bars;
+    };
+
+    InstrumentTape& tapeFor(const std::string& instrument_name);
+    void evict(InstrumentTape& tape, int64_t now_ms);
+    void removeFromWindow(InstrumentTape& tape, const TradeTick& trade);
+    void resum(InstrumentTape& tape);
+    void updateBar(InstrumentTape& tape, const TradeTick& trade);
+
+    int64_t window_ms_;
+    int64_t bar_interval_ms_;
+    std::size_t window_capacity_;
+    std::size_t bar_history_;
+    std::size_t max_window_capacity_;
+    std::unordered_map<std::string, InstrumentTape> tapes_;
+};
+
+#endif // TRADE_AGGREGATOR_H
@@ -3,14 +3,47 @@
 #include <iostream>
 #include <stdexcept>
 #include "latency_module.h"
+#include <chrono>
+#include <iterator>
 
 std::atomic<int> TradeExecution::request_id{ 1 }; // Initialize static atomic counter
 
+namespace {
+
+constexpr int64_t kTradeExpiryMs = 250;     // how often quiet tapes age out
+const char* const kUserTradesChannel = "user.trades.any.any.raw";
+
+int64_t epochMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
 TradeExecution::TradeExecution(WebSocketHandler& websocket)
-    : websocket_(websocket) {}
+    : websocket_(websocket),
+      rpc_in_flight_(MetricsRegistry::instance().gauge(
+          "deribit_rpc_in_flight", "JSON-RPC requests sent and awaiting a reply")),
+      json_transport_(websocket),
+      order_transport_(&json_transport_) {
+    websocket_.set_failover_handler([this](WebSocketHandler::FailoverEvent event, const std::string& detail) {
+        std::function<void(WebSocketHandler::FailoverEvent, const std::string&)> handler;
+        {
+            std::lock_guard<std::mutex> lock(failover_mutex_);
+            handler = failover_handler_;
+        }
+        if (handler) handler(event, detail);
+        if (event == WebSocketHandler::FailoverEvent::Promoted) replaySubscriptions();
+    });
+    websocket_.set_notification_handler([this](const arena_json& message) { handleSubscriptionMessage(message); });
+}
 
 TradeExecution::~TradeExecution() {
     // Perform cleanup, such as clearing the subscribers
+    if (checkpoint_write_.valid()) checkpoint_write_.wait();
+    websocket_.set_failover_handler(nullptr);
+    websocket_.set_notification_handler(nullptr);
+    setFeedMonitor(nullptr);
     market_data_subscribers_.clear();
 }
 
@@ -19,6 +52,106 @@ int TradeExecution::getNextRequestId() {
     return request_id++;
 }
 
+json TradeExecution::rpcRequest(const std::string& method, json params) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", method},
+        {"params", std::move(params)}
+    };
+}
+
+// Send a JSON-RPC request and block for its reply. Notifications and late
+// replies read first go to handleSubscriptionMessage.
+json TradeExecution::sendRequest(const json& request) {
+    GaugeScope in_flight(rpc_in_flight_);
+    return websocket_.call(request["id"].get<int64_t>(), request.dump());
+}
+
+// Send a JSON-RPC request and suspend until its reply
+asio::awaitable<json> TradeExecution::asyncRequest(json request) {
+    GaugeScope in_flight(rpc_in_flight_);
+    int64_t id = request["id"].get<int64_t>();
+    std::string payload = request.dump();
+    co_return co_await websocket_.async_call(id, std::move(payload));
+}
+
+// Record what the ack tells the order trace: an immediate fill, and which
+// request created the order so later user.trades fills can be attributed to it
+void TradeExecution::recordOrderReply(int id, const json& response) {
+    if (response.contains("result") && response["result"].contains("order")) {
+        const auto& result = response["result"];
+        if (result.contains("trades") && !result["trades"].empty()) {
+            order_tracer_.stampOnce(id, OrderStage::FillReceived);
+        }
+        std::lock_guard<std::mutex> lock(order_requests_mutex_);
+        auto inserted = order_requests_.insert_or_assign(result["order"].value("order_id", std::string()), id);
+        if (inserted.second) order_request_ids_.push_back(inserted.first->first);
+        // Forget the oldest orders first; a late fill on one goes untimed
+        while (order_request_ids_.size() > kMaxTrackedOrders) {
+            order_requests_.erase(order_request_ids_.front());
+            order_request_ids_.pop_front();
+        }
+    }
+}
+
+void TradeExecution::setFeedMonitor(FeedMonitor* monitor) {
+    if (FeedMonitor* previous = feed_monitor_.exchange(monitor)) {
+        previous->setPinger(nullptr);
+        websocket_.set_pong_handler(nullptr);
+    }
+    if (!monitor) return;
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        for (const auto& subscription : subscriptions_) {
+            for (const auto& channel : subscription.second) monitor->watch(channel.get<std::string>());
+        }
+    }
+    websocket_.set_pong_handler([monitor](std::chrono::nanoseconds rtt) { monitor->onPong(rtt); });
+    monitor->setPinger([this]() { websocket_.send_ping(); });
+}
+
+void TradeExecution::startFeed(std::function<void(const char*, std::size_t)> sink) {
+    websocket_.start_feed(std::move(sink));
+    FeedMonitor* monitor = feed_monitor_.load();
+    if (!monitor) return;
+    monitor->start();
+    int interval = monitor->config().heartbeat_seconds;
+    if (interval <= 0) return;
+    heartbeats_ = true;
+    asio::co_spawn(websocket_.io_context(), asyncSetHeartbeat(interval), [](std::exception_ptr, json reply) {
+        if (!reply.contains("result")) std::cerr << "Heartbeats not enabled: " << reply.dump() << std::endl;
+    });
+}
+
+void TradeExecution::stopFeed() {
+    if (FeedMonitor* monitor = feed_monitor_.load()) monitor->stop();
+    std::future<void> stopped = websocket_.stop_feed();
+    // The reply to this completes the read in progress
+    if (heartbeats_) {
+        heartbeats_ = false;
+        websocket_.sendMessage(rpcRequest("public/disable_heartbeat", json::object()));
+    } else {
+        websocket_.sendMessage(rpcRequest("public/test", json::object()));
+    }
+    stopped.wait();
+
+    // Replies owed to requests sent outside the coroutine API are no longer
+    // looked for; a later gap may ask for a snapshot again
+    {
+        std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+        for (auto it = snapshot_requests_.begin(); it != snapshot_requests_.end();) {
+            it = it->second != 0 ? snapshot_requests_.erase(it) : std::next(it);
+        }
+    }
+    std::lock_guard<std::mutex> lock(heartbeat_requests_mutex_);
+    heartbeat_requests_.clear();
+}
+
+void TradeExecution::setOrderTransport(OrderTransport* transport) {
+    order_transport_ = transport ? transport : &json_transport_;
+}
+
 // Method to handle incoming market data and notify subscribers
 void TradeExecution::handleMarketData(const json& data) {
     if (data.contains("symbol")) {
@@ -39,27 +172,30 @@ void TradeExecution::handleMarketData(const json& data) {
 void TradeExecution::onMarketDataReceived(const json& market_data) {
     auto market_data_start = LatencyModule::start();  // Start the timer
     handleMarketData(market_data);
-    LatencyModule::end(market_data_start, "Market Data Processing Latency");  // Measure latency
+    static const LatencyModule::Action market_data_latency("Market Data Processing Latency");
+    LatencyModule::end(market_data_start, market_data_latency);  // Measure latency
+}
+
+json TradeExecution::authRequest(const std::string& client_id, const std::string& client_secret) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", "public/auth"},
+        {"params", {
+            {"grant_type", "client_credentials"},
+            {"client_id", client_id},
+            {"client_secret", client_secret}
+        }}
+    };
 }
 
 // Method to authenticate
 json TradeExecution::authenticate(const std::string& client_id, const std::string& client_secret) {
     try {
-        json auth_message = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "public/auth"},
-            {"params", {
-                {"grant_type", "client_credentials"},
-                {"client_id", client_id},
-                {"client_secret", client_secret}
-            }}
-        };
+        json auth_message = authRequest(client_id, client_secret);
         
         std::cout << "Sending auth message: " << auth_message.dump(2) << std::endl;
-        websocket_.sendMessage(auth_message);
-        
-        auto response = websocket_.readMessage();
+        auto response = sendRequest(auth_message);
         std::cout << "Received auth response: " << response.dump(2) << std::endl;  // Add this debug line
 
         if (!response.contains("result")) {
@@ -73,17 +209,58 @@ json TradeExecution::authenticate(const std::string& client_id, const std::strin
     }
 }
 
-// Method to get available instruments
-json TradeExecution::getInstruments(const std::string& currency, const std::string& kind, bool expired) {
-    try {
-        json request = {
+bool TradeExecution::prepareStandbyConnection(const std::string& client_id, const std::string& client_secret) {
+    return websocket_.prepare_standby(authRequest(client_id, client_secret));
+}
+
+// Subscribe and remember the request so it can be replayed on a promoted standby
+void TradeExecution::sendSubscription(const std::string& method, const json& channels) {
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        subscriptions_.emplace_back(method, channels);
+    }
+    if (FeedMonitor* monitor = feed_monitor_.load()) {
+        for (const auto& channel : channels) monitor->watch(channel.get<std::string>());
+    }
+    json subscribe_request = {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", method},
+        {"params", {{"channels", channels}}}
+    };
+    websocket_.sendMessage(subscribe_request);
+}
+
+void TradeExecution::replaySubscriptions() {
+    std::vector<std::pair<std::string, json>> subscriptions;
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        subscriptions = subscriptions_;
+    }
+    for (const auto& subscription : subscriptions) {
+        json subscribe_request = {
             {"jsonrpc", "2.0"},
             {"id", getNextRequestId()},
-            {"method", "public/get_instruments"},
-            {"params", {{"currency", currency}, {"kind", kind}, {"expired", expired}}}
+            {"method", subscription.first},
+            {"params", {{"channels", subscription.second}}}
         };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        websocket_.sendMessage(subscribe_request);
+    }
+    websocket_.report_failover(WebSocketHandler::FailoverEvent::Replayed,
+                               std::to_string(subscriptions.size()) + " subscriptions");
+}
+
+void TradeExecution::setFailoverHandler(
+    std::function<void(WebSocketHandler::FailoverEvent, const std::string&)> handler) {
+    std::lock_guard<std::mutex> lock(failover_mutex_);
+    failover_handler_ = std::move(handler);
+}
+
+// Method to get available instruments
+json TradeExecution::getInstruments(const std::string& currency, const std::string& kind, bool expired) {
+    try {
+        return sendRequest(rpcRequest("public/get_instruments",
+                                      {{"currency", currency}, {"kind", kind}, {"expired", expired}}));
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getInstruments: " << e.what() << std::endl;
@@ -94,21 +271,11 @@ json TradeExecution::getInstruments(const std::string& currency, const std::stri
 // Method to place a buy order
 json TradeExecution::placeBuyOrder(const std::string& instrument_name, double amount, double price) {
     try {
-        json buy_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/buy"},
-            {"params", {
-                {"instrument_name", instrument_name},
-                {"amount", amount},
-                {"type", "limit"},
-                {"price", price}
-            }}
-        };
-        
-        // Add timeout and error handling
-        websocket_.sendMessage(buy_request);
-        auto response = websocket_.readMessage();
+        int id = getNextRequestId();
+        order_tracer_.stamp(id, OrderStage::Created);
+        auto response = order_transport_->placeOrder(id, NewOrder{instrument_name, OrderSide::Buy, amount, price},
+                                                     order_tracer_);
+        recordOrderReply(id, response);
         
         if (response.empty()) {
             throw std::runtime_error("Empty response received from exchange");
@@ -121,17 +288,34 @@ json TradeExecution::placeBuyOrder(const std::string& instrument_name, double am
     }
 }
 
+// Method to place a sell order
+json TradeExecution::placeSellOrder(const std::string& instrument_name, double amount, double price) {
+    try {
+        int id = getNextRequestId();
+        order_tracer_.stamp(id, OrderStage::Created);
+        auto response = order_transport_->placeOrder(id, NewOrder{instrument_name, OrderSide::Sell, amount, price},
+                                                     order_tracer_);
+        recordOrderReply(id, response);
+
+        if (response.empty()) {
+            throw std::runtime_error("Empty response received from exchange");
+        }
+        return response;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in placeSellOrder: " << e.what() << std::endl;
+        throw;
+    }
+}
+
 // Method to cancel an order
 json TradeExecution::cancelOrder(const std::string& order_id) {
     try {
-        json cancel_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/cancel"},
-            {"params", {{"order_id", order_id}}}
-        };
-        websocket_.sendMessage(cancel_request);
-        return websocket_.readMessage();
+        int id = getNextRequestId();
+        order_tracer_.stamp(id, OrderStage::Created);
+        auto response = order_transport_->cancelOrder(id, order_id, order_tracer_);
+        recordOrderReply(id, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in cancelOrder: " << e.what() << std::endl;
@@ -142,19 +326,11 @@ json TradeExecution::cancelOrder(const std::string& order_id) {
 // Method to modify an order
 json TradeExecution::modifyOrder(const std::string& order_id, double new_price, double new_amount) {
     try {
-        json modify_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/edit"},
-            {"params", {
-                {"order_id", order_id},
-                {"new_price", new_price},
-                {"new_amount", new_amount},
-                {"contracts", new_amount}
-            }}
-        };
-        websocket_.sendMessage(modify_request);
-        return websocket_.readMessage();
+        int id = getNextRequestId();
+        order_tracer_.stamp(id, OrderStage::Created);
+        auto response = order_transport_->modifyOrder(id, order_id, new_price, new_amount, order_tracer_);
+        recordOrderReply(id, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in modifyOrder: " << e.what() << std::endl;
@@ -165,14 +341,11 @@ json TradeExecution::modifyOrder(const std::string& order_id, double new_price,
 // Method to get the order book for a specific instrument
 json TradeExecution::getOrderBook(const std::string& instrument_name) {
     try {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "public/get_order_book"},
-            {"params", {{"instrument_name", instrument_name}}}
-        };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        auto response = sendRequest(rpcRequest("public/get_order_book", {{"instrument_name", instrument_name}}));
+        if (response.contains("result")) {
+            order_books_.applySnapshot(response["result"]);
+        }
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getOrderBook: " << e.what() << std::endl;
@@ -183,14 +356,7 @@ json TradeExecution::getOrderBook(const std::string& instrument_name) {
 // Method to get current positions
 json TradeExecution::getPosition(const std::string& instrument_name) {
     try {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/get_position"},
-            {"params", {{"instrument_name", instrument_name}}}
-        };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        return sendRequest(rpcRequest("private/get_position", {{"instrument_name", instrument_name}}));
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getPosition: " << e.what() << std::endl;
@@ -198,6 +364,16 @@ json TradeExecution::getPosition(const std::string& instrument_name) {
     }
 }
 
+json TradeExecution::getOpenOrders(const std::string& instrument_name) {
+    try {
+        return sendRequest(rpcRequest("private/get_open_orders_by_instrument", {{"instrument_name", instrument_name}}));
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in getOpenOrders: " << e.what() << std::endl;
+        throw;
+    }
+}
+
 // Add a subscriber for real-time market data updates
 void TradeExecution::addMarketDataSubscriber(const std::string& symbol, std::function<void(const json&)> callback) {
     market_data_subscribers_[symbol] = callback;
@@ -205,17 +381,7 @@ void TradeExecution::addMarketDataSubscriber(const std::string& symbol, std::fun
 
 void TradeExecution::subscribeToOrderBook(const std::string& instrument_name, const std::string& interval) {
     try {
-        json subscribe_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/subscribe"},
-            {"params", {
-                {"channels", {
-                    "book." + instrument_name + "." + interval
-                }}
-            }}
-        };
-        websocket_.sendMessage(subscribe_request);
+        sendSubscription("private/subscribe", {"book." + instrument_name + "." + interval});
     }
     catch (const std::exception& e) {
         std::cerr << "Error subscribing to order book: " << e.what() << std::endl;
@@ -230,29 +396,189 @@ void TradeExecution::unsubscribeFromOrderBook(const std::string& instrument_name
             {"method", "public/unsubscribe_all"},
             {"params", {}}
         };
+        {
+            std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+            subscriptions_.clear();
+        }
+        if (FeedMonitor* monitor = feed_monitor_.load()) monitor->unwatchAll();
         websocket_.sendMessage(unsubscribe_request);
+        // unsubscribe_all takes the private channels with it
+        if (user_trades_) sendSubscription("private/subscribe", {kUserTradesChannel});
     }
     catch (const std::exception& e) {
         std::cerr << "Error unsubscribing: " << e.what() << std::endl;
     }
 }
 
-void TradeExecution::handleOrderBookUpdate(const json& update) {
+void TradeExecution::subscribeToUserTrades() {
     try {
-        if (update.contains("params") && update["params"].contains("data")) {
-            const auto& data = update["params"]["data"];
-            std::cout << "\nOrder Book Update:" << std::endl;
-            if (data.contains("bids")) {
-                std::cout << "Bids:" << std::endl;
-                for (const auto& bid : data["bids"]) {
-                    std::cout << "Price: " << bid[0] << ", Size: " << bid[1] << std::endl;
+        user_trades_ = true;
+        sendSubscription("private/subscribe", {kUserTradesChannel});
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error subscribing to user trades: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::subscribeToTrades(const std::string& instrument_name, const std::string& interval) {
+    try {
+        trade_aggregator_.reserveInstrument(instrument_name);
+        sendSubscription("public/subscribe", {"trades." + instrument_name + "." + interval});
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error subscribing to trades: " << e.what() << std::endl;
+    }
+}
+
+template <typename Json>
+void TradeExecution::handleTradeUpdate(const Json& update) {
+    if (update.contains("params") && update["params"].contains("data")) {
+        const auto& trades = update["params"]["data"];
+        {
+            std::lock_guard<std::mutex> lock(trades_mutex_);
+            trade_aggregator_.handleTradeNotification(trades);
+        }
+        if (tick_store_) {
+            std::lock_guard<std::mutex> lock(tick_store_mutex_);
+            for (const auto& t : trades) {
+                tick_store_->recordTrade(t["instrument_name"].template get_ref<const std::string&>(),
+                                         t.value("timestamp", int64_t{0}), t["price"].template get<double>(),
+                                         t["amount"].template get<double>(),
+                                         t.contains("direction") && t["direction"] == "buy");
+            }
+        }
+    }
+}
+
+json TradeExecution::loadOptionChain(const std::string& currency) {
+    auto response = getInstruments(currency, "option", false);
+    if (response.contains("result")) {
+        std::lock_guard<std::mutex> lock(options_mutex_);
+        options_analytics_.loadInstruments(response["result"]);
+    }
+    return response;
+}
+
+void TradeExecution::subscribeToOptionChain(const std::string& currency, const std::string& interval) {
+    try {
+        sendSubscription("public/subscribe", options_analytics_.channels(currency, interval));
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error subscribing to option chain: " << e.what() << std::endl;
+    }
+}
+
+template <typename Json>
+void TradeExecution::handleSubscriptionMessage(const Json& message) {
+    try {
+        if (handleSnapshotReply(message) || handleHeartbeatReply(message)) return;
+        if (message.contains("method") && message["method"] == "heartbeat") {
+            // Deribit drops the connection if a test request goes unanswered
+            if (message.contains("params") && message["params"].value("type", std::string()) == "test_request") {
+                answerHeartbeat();
+            }
+            return;
+        }
+        if (!message.contains("params") || !message["params"].contains("channel")) return;
+        const std::string& channel = message["params"]["channel"].template get_ref<const std::string&>();
+        if (FeedMonitor* monitor = feed_monitor_.load()) monitor->onUpdate(channel);
+
+        // Any notification ages out trade windows whose tape has gone quiet;
+        // one reader does it per interval
+        int64_t now_ms = epochMillis();
+        int64_t expired_ms = trades_expired_ms_.load(std::memory_order_relaxed);
+        if (now_ms - expired_ms >= kTradeExpiryMs
+            && trades_expired_ms_.compare_exchange_strong(expired_ms, now_ms, std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(trades_mutex_);
+            trade_aggregator_.expire(now_ms);
+        }
+
+        if (channel.rfind("book.", 0) == 0) {
+            handleOrderBookUpdate(message);
+        } else if (channel.rfind("trades.", 0) == 0) {
+            handleTradeUpdate(message);
+        } else if (channel.rfind("ticker.", 0) == 0) {
+            // A ticker revalues its own strike; an index tick moves every
+            // forward and revalues the chain as one batch
+            std::lock_guard<std::mutex> lock(options_mutex_);
+            options_analytics_.handleTicker(message["params"]["data"]);
+            options_analytics_.revalue(epochMillis());
+        } else if (channel.rfind("user.trades.", 0) == 0) {
+            handleUserTrades(message["params"]["data"]);
+        } else if (channel.rfind("deribit_price_index.", 0) == 0) {
+            std::lock_guard<std::mutex> lock(options_mutex_);
+            options_analytics_.handleIndexPrice(message["params"]["data"]);
+            options_analytics_.revalue(epochMillis());
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling subscription message: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::handleDroppedFrame(const char* data, std::size_t size) {
+    try {
+        json message = json::parse(data, data + size);
+        if (message.contains("method") && message["method"] == "heartbeat") {
+            if (message.contains("params") && message["params"].value("type", std::string()) == "test_request") {
+                answerHeartbeat();
+            }
+            return;
+        }
+
+        std::string instrument;
+        auto id = message.find("id");
+        if (id != message.end() && id->is_number_integer()) {
+            // A snapshot reply: forget the request so it can be made again
+            std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+            for (auto it = snapshot_requests_.begin(); it != snapshot_requests_.end(); ++it) {
+                if (it->second == id->get<int64_t>()) {
+                    instrument = it->first;
+                    snapshot_requests_.erase(it);
+                    break;
                 }
             }
-            if (data.contains("asks")) {
-                std::cout << "Asks:" << std::endl;
-                for (const auto& ask : data["asks"]) {
-                    std::cout << "Price: " << ask[0] << ", Size: " << ask[1] << std::endl;
+        } else if (message.contains("params") && message["params"].contains("channel")
+                   && message["params"]["channel"].get_ref<const std::string&>().rfind("book.", 0) == 0) {
+            instrument = message["params"]["data"].value("instrument_name", std::string());
+        }
+        if (!instrument.empty()) requestBookSnapshot(instrument, true);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling dropped frame: " << e.what() << std::endl;
+    }
+}
+
+template <typename Json>
+void TradeExecution::handleUserTrades(const Json& trades) {
+    std::lock_guard<std::mutex> lock(order_requests_mutex_);
+    for (const auto& trade : trades) {
+        if (!trade.contains("order_id")) continue;
+        auto it = order_requests_.find(trade["order_id"].template get_ref<const std::string&>());
+        if (it != order_requests_.end()) {
+            order_tracer_.stampOnce(it->second, OrderStage::FillReceived);
+        }
+    }
+}
+
+template <typename Json>
+void TradeExecution::handleOrderBookUpdate(const Json& update) {
+    try {
+        if (update.contains("params") && update["params"].contains("data")) {
+            const auto& data = update["params"]["data"];
+            BookUpdateResult result = order_books_.applyNotification(data);
+            if (result == BookUpdateResult::Gap) {
+                requestBookSnapshot(data["instrument_name"].template get<std::string>());
+            } else if (result != BookUpdateResult::Ignored) {
+                if (tick_store_) {
+                    std::lock_guard<std::mutex> lock(tick_store_mutex_);
+                    const std::string& name = data["instrument_name"].template get_ref<const std::string&>();
+                    const OrderBook* book = order_books_.book(name);
+                    tick_store_->recordQuote(name, book->timestamp(), book->bestPrice(BookSide::Bid),
+                                             book->bestSize(BookSide::Bid), book->bestPrice(BookSide::Ask),
+                                             book->bestSize(BookSide::Ask));
                 }
+                maybeCheckpointBooks();
             }
         }
     }
@@ -261,19 +587,281 @@ void TradeExecution::handleOrderBookUpdate(const json& update) {
     }
 }
 
-json TradeExecution::getOrderDetails(const std::string& order_id) {
+// One snapshot per broken book; changes keep reporting a gap until it lands.
+// On the io_context thread the request goes through the coroutine API,
+// unless through_feed asks for the reply to go to the feed sink like any
+// other frame; anywhere else (FeedPipeline workers, a blocking call) it is
+// sent as is and the reply reaches handleSubscriptionMessage through the
+// feed sink or the blocking call's reader.
+void TradeExecution::requestBookSnapshot(const std::string& instrument_name, bool through_feed) {
+    bool coroutine_reader = !through_feed && websocket_.io_context().get_executor().running_in_this_thread();
+    json request = rpcRequest("public/get_order_book", {{"instrument_name", instrument_name}});
+    {
+        std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+        if (snapshot_requests_.count(instrument_name)) return;
+        snapshot_requests_[instrument_name] = coroutine_reader ? 0 : request["id"].get<int64_t>();
+    }
+    std::cerr << "Order book gap for " << instrument_name << ", fetching a fresh snapshot" << std::endl;
+
+    if (coroutine_reader) {
+        asio::co_spawn(websocket_.io_context(), refreshBook(instrument_name), asio::detached);
+        return;
+    }
+    try {
+        websocket_.sendMessage(request);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error requesting order book snapshot: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+        snapshot_requests_.erase(instrument_name);
+    }
+}
+
+asio::awaitable<void> TradeExecution::refreshBook(std::string instrument_name) {
+    json response = co_await asyncGetOrderBook(instrument_name);
+    if (!response.contains("result")) {
+        std::cerr << "Order book snapshot for " << instrument_name << " failed: " << response.dump() << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+    snapshot_requests_.erase(instrument_name);
+}
+
+// Replies to snapshots requested from a blocking reader
+template <typename Json>
+bool TradeExecution::handleSnapshotReply(const Json& reply) {
+    auto id = reply.find("id");
+    if (id == reply.end() || !id->is_number_integer()) return false;
+    int64_t request = id->template get<int64_t>();
+    {
+        std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+        auto it = snapshot_requests_.begin();
+        while (it != snapshot_requests_.end() && it->second != request) ++it;
+        if (it == snapshot_requests_.end()) return false;
+        snapshot_requests_.erase(it);
+    }
+    if (reply.contains("result")) {
+        order_books_.applyNotification(reply["result"]);
+    } else {
+        std::cerr << "Order book snapshot failed: " << reply.dump() << std::endl;
+    }
+    return true;
+}
+
+// Answered like a snapshot request: through the coroutine API on the
+// io_context thread, otherwise sent here and matched when the reply comes
+// back through handleSubscriptionMessage
+void TradeExecution::answerHeartbeat() {
+    json request = rpcRequest("public/test", json::object());
+    if (websocket_.io_context().get_executor().running_in_this_thread()) {
+        asio::co_spawn(websocket_.io_context(), timeHeartbeatAnswer(std::move(request)), asio::detached);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(heartbeat_requests_mutex_);
+        heartbeat_requests_[request["id"].get<int64_t>()] = std::chrono::steady_clock::now();
+    }
     try {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/get_order_state"},
-            {"params", {{"order_id", order_id}}}
-        };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error answering heartbeat: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(heartbeat_requests_mutex_);
+        heartbeat_requests_.erase(request["id"].get<int64_t>());
+    }
+}
+
+asio::awaitable<void> TradeExecution::timeHeartbeatAnswer(json request) {
+    auto sent = std::chrono::steady_clock::now();
+    json response = co_await asyncRequest(std::move(request));
+    if (!response.contains("result")) {
+        std::cerr << "Heartbeat answer failed: " << response.dump() << std::endl;
+    } else if (FeedMonitor* monitor = feed_monitor_.load()) {
+        monitor->onHeartbeatRtt(std::chrono::steady_clock::now() - sent);
+    }
+}
+
+template <typename Json>
+bool TradeExecution::handleHeartbeatReply(const Json& reply) {
+    auto id = reply.find("id");
+    if (id == reply.end() || !id->is_number_integer()) return false;
+    std::chrono::steady_clock::time_point sent;
+    {
+        std::lock_guard<std::mutex> lock(heartbeat_requests_mutex_);
+        auto it = heartbeat_requests_.find(id->template get<int64_t>());
+        if (it == heartbeat_requests_.end()) return false;
+        sent = it->second;
+        heartbeat_requests_.erase(it);
+    }
+    FeedMonitor* monitor = feed_monitor_.load();
+    if (reply.contains("result") && monitor) {
+        monitor->onHeartbeatRtt(std::chrono::steady_clock::now() - sent);
+    }
+    return true;
+}
+
+std::vector<std::string> TradeExecution::restoreBookCheckpoint(const std::string& path, int64_t max_age_ms) {
+    return order_books_.loadCheckpoint(path, max_age_ms);
+}
+
+void TradeExecution::enableBookCheckpoints(const std::string& path, std::chrono::milliseconds interval) {
+    checkpoint_path_ = path;
+    checkpoint_interval_ = interval;
+    next_checkpoint_ = std::chrono::steady_clock::now() + interval;
+}
+
+// The image is taken here, between updates; the file write runs on its own
+// thread. A round is skipped while the previous write is still going.
+void TradeExecution::maybeCheckpointBooks() {
+    if (checkpoint_path_.empty()) return;
+    std::unique_lock<std::mutex> lock(checkpoint_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_checkpoint_) return;
+    if (checkpoint_write_.valid()
+        && checkpoint_write_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    next_checkpoint_ = now + checkpoint_interval_;
+    checkpoint_write_ = std::async(std::launch::async, &OrderBookEngine::writeCheckpointFile, checkpoint_path_,
+                                   order_books_.serializeCheckpoint());
+}
+
+bool TradeExecution::saveBookCheckpoint() {
+    if (checkpoint_path_.empty()) return false;
+    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+    if (checkpoint_write_.valid()) checkpoint_write_.wait();
+    return OrderBookEngine::writeCheckpointFile(checkpoint_path_, order_books_.serializeCheckpoint());
+}
+
+json TradeExecution::getOrderDetails(const std::string& order_id) {
+    try {
+        return sendRequest(rpcRequest("private/get_order_state", {{"order_id", order_id}}));
     }
     catch (const std::exception& e) {
         std::cerr << "Error getting order details: " << e.what() << std::endl;
         throw;
     }
-}
\ No newline at end of file
+}
+
+asio::awaitable<json> TradeExecution::asyncAuthenticate(std::string client_id, std::string client_secret) {
+    json request = authRequest(client_id, client_secret);
+    json response = co_await asyncRequest(std::move(request));
+    if (!response.contains("result")) {
+        throw std::runtime_error("Authentication failed: " + response.dump());
+    }
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncGetInstruments(std::string currency, std::string kind, bool expired) {
+    json request = rpcRequest("public/get_instruments", {{"currency", currency}, {"kind", kind}, {"expired", expired}});
+    co_return co_await asyncRequest(std::move(request));
+}
+
+asio::awaitable<json> TradeExecution::asyncPlaceBuyOrder(std::string instrument_name, double amount, double price) {
+    int id = getNextRequestId();
+    order_tracer_.stamp(id, OrderStage::Created);
+    NewOrder order{std::move(instrument_name), OrderSide::Buy, amount, price};
+    json response = co_await json_transport_.asyncPlaceOrder(id, std::move(order), order_tracer_);
+    recordOrderReply(id, response);
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncPlaceSellOrder(std::string instrument_name, double amount, double price) {
+    int id = getNextRequestId();
+    order_tracer_.stamp(id, OrderStage::Created);
+    NewOrder order{std::move(instrument_name), OrderSide::Sell, amount, price};
+    json response = co_await json_transport_.asyncPlaceOrder(id, std::move(order), order_tracer_);
+    recordOrderReply(id, response);
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncCancelOrder(std::string order_id) {
+    int id = getNextRequestId();
+    order_tracer_.stamp(id, OrderStage::Created);
+    json response = co_await json_transport_.asyncCancelOrder(id, std::move(order_id), order_tracer_);
+    recordOrderReply(id, response);
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncModifyOrder(std::string order_id, double new_price, double new_amount) {
+    int id = getNextRequestId();
+    order_tracer_.stamp(id, OrderStage::Created);
+    json response = co_await json_transport_.asyncModifyOrder(id, std::move(order_id), new_price, new_amount,
+                                                              order_tracer_);
+    recordOrderReply(id, response);
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncGetOrderBook(std::string instrument_name) {
+    json request = rpcRequest("public/get_order_book", {{"instrument_name", instrument_name}});
+    json response = co_await asyncRequest(std::move(request));
+    if (response.contains("result")) {
+        order_books_.applySnapshot(response["result"]);
+    }
+    co_return response;
+}
+
+asio::awaitable<json> TradeExecution::asyncGetPosition(std::string instrument_name) {
+    json request = rpcRequest("private/get_position", {{"instrument_name", instrument_name}});
+    co_return co_await asyncRequest(std::move(request));
+}
+
+asio::awaitable<json> TradeExecution::asyncGetOrderDetails(std::string order_id) {
+    json request = rpcRequest("private/get_order_state", {{"order_id", order_id}});
+    co_return co_await asyncRequest(std::move(request));
+}
+
+asio::awaitable<json> TradeExecution::asyncSetHeartbeat(int interval_seconds) {
+    json request = rpcRequest("public/set_heartbeat", {{"interval", interval_seconds}});
+    co_return co_await asyncRequest(std::move(request));
+}
+
+asio::awaitable<json> TradeExecution::asyncLoadOptionChain(std::string currency) {
+    std::string kind = "option";
+    json response = co_await asyncGetInstruments(std::move(currency), std::move(kind), false);
+    if (response.contains("result")) {
+        std::lock_guard<std::mutex> lock(options_mutex_);
+        options_analytics_.loadInstruments(response["result"]);
+    }
+    co_return response;
+}
+
+asio::awaitable<std::vector<json>> TradeExecution::whenAll(std::vector<asio::awaitable<json>> calls) {
+    struct State {
+        State(const asio::any_io_executor& executor, std::size_t n) : results(n), remaining(n), done(executor) {}
+        std::vector<json> results;
+        std::size_t remaining;      // plain: every completion runs on the one executor thread
+        asio::steady_timer done;    // cancelled by the last call to finish
+    };
+    auto executor = co_await asio::this_coro::executor;
+    auto state = std::make_shared<State>(executor, calls.size());
+    state->done.expires_at(asio::steady_timer::time_point::max());
+
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        asio::co_spawn(executor, std::move(calls[i]), [state, i](std::exception_ptr e, json result) {
+            if (e) {
+                try {
+                    std::rethrow_exception(e);
+                }
+                catch (const std::exception& err) {
+                    result = json{{"error", {{"message", err.what()}}}};
+                }
+                catch (...) {
+                    result = json{{"error", {{"message", "unknown error"}}}};
+                }
+            }
+            state->results[i] = std::move(result);
+            if (--state->remaining == 0) state->done.cancel();
+        });
+    }
+    if (state->remaining > 0) {
+        boost::system::error_code ec;
+        co_await state->done.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    }
+    co_return std::move(state->results);
+}
+
+template void TradeExecution::handleOrderBookUpdate<json>(const json&);
+template void TradeExecution::handleOrderBookUpdate<arena_json>(const arena_json&);
+template void TradeExecution::handleTradeUpdate<json>(const json&);
+template void TradeExecution::handleTradeUpdate<arena_json>(const arena_json&);
+template void TradeExecution::handleSubscriptionMessage<json>(const json&);
+template void TradeExecution::handleSubscriptionMessage<arena_json>(const arena_json&);
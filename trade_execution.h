@@ -2,11 +2,27 @@
 #define TRADE_EXECUTION_H
 
 #include "websocket_handler.h"
+#include "trade_aggregator.h"
+#include "order_book_engine.h"
+#include "options_analytics.h"
+#include "order_trace.h"
+#include "metrics.h"
+#include "order_transport.h"
+#include "tick_store.h"
+#include "feed_monitor.h"
+#include <boost/asio/awaitable.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <functional>
 #include <map>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Forward declaration to avoid circular dependency
 class WebSocketHandler;
@@ -21,15 +37,118 @@ public:
    
     json getOrderDetails(const std::string& order_id);
     json authenticate(const std::string& client_id, const std::string& client_secret);
+    // Open and authenticate a standby connection that takes over if the
+    // primary drops; subscriptions are replayed on it after promotion
+    bool prepareStandbyConnection(const std::string& client_id, const std::string& client_secret);
+    // Failover events from the WebSocketHandler, ending with Replayed once
+    // subscriptions are restored after a promotion; on the thread that saw
+    // the failure, often a background one
+    void setFailoverHandler(std::function<void(WebSocketHandler::FailoverEvent, const std::string&)> handler);
     json getInstruments(const std::string& currency, const std::string& kind, bool expired);
     json placeBuyOrder(const std::string& instrument_name, double amount, double price);
+    json placeSellOrder(const std::string& instrument_name, double amount, double price);
     json cancelOrder(const std::string& order_id);
     json modifyOrder(const std::string& order_id, double new_price, double new_amount);
     json getOrderBook(const std::string& instrument_name);
     json getPosition(const std::string& instrument_name);
+    json getOpenOrders(const std::string& instrument_name);
+
+    // Coroutine versions of the RPCs above, awaited from coroutines on the
+    // WebSocketHandler's io_context. One thread can keep many in flight by
+    // passing them to whenAll. Errors come back as {"error": {...}} replies;
+    // asyncAuthenticate throws like authenticate. Async order entry always
+    // goes over JSON-RPC, whatever setOrderTransport selected.
+    boost::asio::awaitable<json> asyncAuthenticate(std::string client_id, std::string client_secret);
+    boost::asio::awaitable<json> asyncGetInstruments(std::string currency, std::string kind, bool expired);
+    boost::asio::awaitable<json> asyncPlaceBuyOrder(std::string instrument_name, double amount, double price);
+    boost::asio::awaitable<json> asyncPlaceSellOrder(std::string instrument_name, double amount, double price);
+    boost::asio::awaitable<json> asyncCancelOrder(std::string order_id);
+    boost::asio::awaitable<json> asyncModifyOrder(std::string order_id, double new_price, double new_amount);
+    boost::asio::awaitable<json> asyncGetOrderBook(std::string instrument_name);
+    boost::asio::awaitable<json> asyncGetPosition(std::string instrument_name);
+    boost::asio::awaitable<json> asyncGetOrderDetails(std::string order_id);
+    boost::asio::awaitable<json> asyncLoadOptionChain(std::string currency);
+    // Ask for a heartbeat every interval_seconds (at least 10); each test
+    // request is answered with public/test, whose round trip is timed
+    boost::asio::awaitable<json> asyncSetHeartbeat(int interval_seconds);
+    // Run the calls concurrently and return their replies in the same order.
+    // The calls run on the awaiting coroutine's executor, which must only be
+    // run by one thread (as the WebSocketHandler's io_context is): completions
+    // are counted and the waiter woken without locking.
+    static boost::asio::awaitable<std::vector<json>> whenAll(std::vector<boost::asio::awaitable<json>> calls);
+
     void subscribeToOrderBook(const std::string& instrument_name, const std::string& interval = "agg2");
     void unsubscribeFromOrderBook(const std::string& instrument_name);
-    void handleOrderBookUpdate(const json& update);
+    template <typename Json>
+    void handleOrderBookUpdate(const Json& update);
+    const OrderBookEngine& orderBooks() const { return order_books_; }
+
+    // Trade tape aggregation (rolling VWAP, OHLCV bars, imbalance)
+    void subscribeToTrades(const std::string& instrument_name, const std::string& interval = "100ms");
+    template <typename Json>
+    void handleTradeUpdate(const Json& update);
+    const TradeAggregator& tradeAggregator() const { return trade_aggregator_; }
+
+    // Options chain analytics (implied vol and greeks across all strikes)
+    json loadOptionChain(const std::string& currency);
+    void subscribeToOptionChain(const std::string& currency, const std::string& interval = "100ms");
+    OptionsAnalyticsEngine& optionsAnalytics() { return options_analytics_; }
+
+    // Per-order stage timestamps for placeBuyOrder/cancelOrder/modifyOrder
+    OrderTracer& orderTracer() { return order_tracer_; }
+    // Own fills, which stamp FillReceived on the order that made them. A
+    // private channel, so call once authenticated; fills are only stamped
+    // when something reads the socket (a blocking call or the feed).
+    void subscribeToUserTrades();
+
+    // Route order entry over another transport (e.g. FIX); nullptr restores
+    // JSON-RPC over the WebSocket. The transport must outlive this object.
+    void setOrderTransport(OrderTransport* transport);
+    const char* orderTransportName() const { return order_transport_->name(); }
+
+    // Append top of book after each book update, and every trade, to a tick
+    // store; nullptr stops recording. The store must outlive this object.
+    void setTickStore(TickStoreWriter* store) { tick_store_ = store; }
+
+    // Report every subscribed channel's updates, WebSocket pongs and
+    // heartbeat round trips to a feed monitor, which pings through the
+    // WebSocketHandler; nullptr detaches it. Detach before either is destroyed.
+    void setFeedMonitor(FeedMonitor* monitor);
+
+    // Subscribed market data on a reader the io_context owns (see
+    // WebSocketHandler::start_feed); sink gets every frame on that thread.
+    // Only while it runs are heartbeats requested and the feed monitor
+    // started, since nothing else answers a test_request or sees a pong.
+    void startFeed(std::function<void(const char*, std::size_t)> sink);
+    // Stop the monitor and heartbeats and wait for the reader to hand the
+    // socket back to the blocking calls; unsubscribe first
+    void stopFeed();
+
+    // Order book checkpoints for warm restarts. restoreBookCheckpoint loads
+    // books saved less than max_age_ms ago without subscribing to them:
+    // nothing may be reading the socket yet. Subscribing to a restored
+    // book's channel later (subscribeToOrderBook) carries it on from its
+    // saved change_id if the first change links to it, and otherwise a fresh
+    // snapshot is fetched for that instrument alone. Returns the instruments
+    // restored.
+    std::vector<std::string> restoreBookCheckpoint(const std::string& path, int64_t max_age_ms);
+    // Write the checkpoint from the book update path at most once per interval
+    void enableBookCheckpoints(const std::string& path, std::chrono::milliseconds interval);
+    // Write it now; call once book updates have stopped, e.g. on shutdown
+    bool saveBookCheckpoint();
+
+    // Route a subscription notification to the book, trade or options handlers.
+    // Accepts json or an arena_json parsed by WebSocketHandler::readMessage.
+    // May run on several FeedPipeline workers at once, provided each
+    // instrument's messages stay on one of them.
+    template <typename Json>
+    void handleSubscriptionMessage(const Json& message);
+    // A frame a FeedPipeline had no room for, on the thread reading the
+    // socket. A dropped book change or snapshot reply is made good with a
+    // snapshot requested through the feed, so the worker that owns the
+    // instrument applies it; a dropped test request is still answered.
+    // Dropped trades are lost.
+    void handleDroppedFrame(const char* data, std::size_t size);
 
     // Market Data Handling
     void handleMarketData(const json& data);
@@ -42,8 +161,66 @@ private:
    WebSocketHandler& websocket_;
 
     std::map<std::string, std::function<void(const json&)>> market_data_subscribers_;
+    TradeAggregator trade_aggregator_;
+    OrderBookEngine order_books_;
+    OptionsAnalyticsEngine options_analytics_;
     static std::atomic<int> request_id;
     int getNextRequestId();
+
+    json rpcRequest(const std::string& method, json params);
+    json sendRequest(const json& request);
+    boost::asio::awaitable<json> asyncRequest(json request);
+    json authRequest(const std::string& client_id, const std::string& client_secret);
+    void sendSubscription(const std::string& method, const json& channels);
+    void replaySubscriptions();
+    void recordOrderReply(int id, const json& response);
+    template <typename Json>
+    void handleUserTrades(const Json& trades);
+    void requestBookSnapshot(const std::string& instrument_name, bool through_feed = false);
+    boost::asio::awaitable<void> refreshBook(std::string instrument_name);
+    template <typename Json>
+    bool handleSnapshotReply(const Json& reply);
+    void maybeCheckpointBooks();
+    void answerHeartbeat();
+    boost::asio::awaitable<void> timeHeartbeatAnswer(json request);
+    template <typename Json>
+    bool handleHeartbeatReply(const Json& reply);
+
+    static constexpr std::size_t kMaxTrackedOrders = 65536;
+    OrderTracer order_tracer_;
+    std::unordered_map<std::string, int64_t> order_requests_;   // order_id -> request id
+    std::deque<std::string> order_request_ids_;                 // its keys, oldest first
+    bool user_trades_ = false;          // subscribeToUserTrades, renewed after unsubscribe_all
+    std::mutex order_requests_mutex_;
+    Gauge& rpc_in_flight_;
+    std::vector<std::pair<std::string, json>> subscriptions_;   // method, channels
+    std::mutex subscriptions_mutex_;
+    std::function<void(WebSocketHandler::FailoverEvent, const std::string&)> failover_handler_;
+    std::mutex failover_mutex_;
+    JsonRpcOrderTransport json_transport_;
+    OrderTransport* order_transport_;
+    TickStoreWriter* tick_store_ = nullptr;
+    std::atomic<FeedMonitor*> feed_monitor_{nullptr};   // set from the menu, read by feed readers
+    bool heartbeats_ = false;           // requested by startFeed
+    // public/test answers sent by a blocking reader: request id -> send time
+    std::unordered_map<int64_t, std::chrono::steady_clock::time_point> heartbeat_requests_;
+    std::mutex heartbeat_requests_mutex_;
+
+    // Snapshots requested after a gap: instrument -> request id, or 0 when
+    // the request went through the coroutine API
+    std::unordered_map<std::string, int64_t> snapshot_requests_;
+    std::mutex snapshot_requests_mutex_;
+    std::string checkpoint_path_;
+    std::chrono::milliseconds checkpoint_interval_{0};
+    std::chrono::steady_clock::time_point next_checkpoint_{};
+    std::future<bool> checkpoint_write_;
+    std::mutex checkpoint_mutex_;       // one worker starts each checkpoint
+
+    // State shared across instruments, locked for FeedPipeline workers
+    std::mutex tick_store_mutex_;       // the store takes one producer at a time
+    std::mutex trades_mutex_;
+    std::mutex options_mutex_;
+    std::atomic<int64_t> trades_expired_ms_{0};    // last TradeAggregator::expire, epoch ms
 };
 
 #endif // TRADE_EXECUTION_H
@@ -1,22 +1,326 @@
 #include "websocket_handler.h"
 #include "latency_module.h"
+#include <algorithm>
+#include <ctime>
 #include <iostream>
+#include <string_view>
+
+namespace {
+
+// CPU time of the calling thread; blocking in a read costs none of it
+int64_t threadCpuNs() {
+#if defined(_WIN32)
+    return -1;
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return -1;
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+}
+
+} // namespace
 
 WebSocketHandler::WebSocketHandler(asio::io_context& ioc, const std::string& host, 
                                  const std::string& port, const std::string& endpoint)
     : ioc_(ioc),
-      ctx_(ssl::context::tlsv12_client),
+      ctx_(ssl::context::tls_client),
       resolver_(ioc_),
-      websocket_(ioc_, ctx_),
       host_(host),
-      endpoint_(endpoint) {
+      port_(port),
+      endpoint_(endpoint),
+      rpc_frames_(MetricsRegistry::instance().counter(
+          "deribit_frames_total", "WebSocket frames received by channel family", "channel=\"rpc\"")),
+      reconnects_(MetricsRegistry::instance().counter(
+          "deribit_reconnects_total", "WebSocket connections made after the first")),
+      tls_resumptions_(MetricsRegistry::instance().counter(
+          "deribit_tls_resumptions_total", "TLS handshakes that resumed a cached session")),
+      failovers_(MetricsRegistry::instance().counter(
+          "deribit_failovers_total", "Standby connections promoted after a primary failure")),
+      standby_failures_(MetricsRegistry::instance().counter(
+          "deribit_standby_failures_total", "Standby connections that failed to connect or authenticate")),
+      standby_ready_(MetricsRegistry::instance().gauge(
+          "deribit_standby_ready", "1 while an authenticated standby connection is held")),
+      outbound_depth_(MetricsRegistry::instance().gauge(
+          "deribit_outbound_queue_depth", "Frames queued or being written to the socket")),
+      parse_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_parse_seconds", "Time to parse one inbound frame")),
+      payload_bytes_(MetricsRegistry::instance().counter(
+          "deribit_ws_payload_bytes_total", "Inbound WebSocket message bytes after inflate")),
+      wire_bytes_(MetricsRegistry::instance().counter(
+          "deribit_ws_wire_bytes_total", "Inbound TLS bytes carrying WebSocket frames")),
+      read_cpu_seconds_(MetricsRegistry::instance().histogram(
+          "deribit_ws_read_cpu_seconds", "Thread CPU time of one blocking read: decrypt, unmask and inflate")) {
     
     ctx_.set_verify_mode(ssl::verify_peer);
     ctx_.set_default_verify_paths();
+
+    // Keep session tickets so reconnects and the standby resume instead of
+    // running a full handshake. The callback also catches TLS 1.3 tickets,
+    // which arrive after the handshake completes.
+    SSL_CTX* native = ctx_.native_handle();
+    SSL_CTX_set_min_proto_version(native, TLS1_2_VERSION);
+    SSL_CTX_set_ex_data(native, tls_owner_index(), this);
+    SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(native, &WebSocketHandler::on_new_tls_session);
+
+    websocket_ = make_stream();
+}
+
+WebSocketHandler::~WebSocketHandler() {
+    if (standby_build_.valid()) standby_build_.wait();
+    std::lock_guard<std::mutex> lock(tls_session_mutex_);
+    if (tls_session_) SSL_SESSION_free(tls_session_);
+}
+
+// asio's ssl::context keeps its verify callback in the SSL_CTX app data and
+// deletes it on destruction, so the owner pointer needs its own slot
+int WebSocketHandler::tls_owner_index() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int WebSocketHandler::on_new_tls_session(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<WebSocketHandler*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), tls_owner_index()));
+    if (!self) return 0;
+    std::lock_guard<std::mutex> lock(self->tls_session_mutex_);
+    if (self->tls_session_) SSL_SESSION_free(self->tls_session_);
+    self->tls_session_ = session;
+    return 1;   // we keep the reference
+}
+
+bool WebSocketHandler::session_resumed(Stream& ws) {
+    return SSL_session_reused(ws.next_layer().native_handle()) == 1;
 }
+
+std::shared_ptr<WebSocketHandler::Stream> WebSocketHandler::stream() const {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    return websocket_;
+}
+
+std::shared_ptr<WebSocketHandler::Stream> WebSocketHandler::make_stream() {
+    auto ws = std::make_shared<Stream>(ioc_, ctx_);
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        ws->set_option(deflate_.options());
+    }
+    ws->control_callback([this](beast::websocket::frame_type kind, beast::string_view payload) {
+        on_control_frame(kind, payload);
+    });
+    SSL* native = ws->next_layer().native_handle();
+    SSL_set_tlsext_host_name(native, host_.c_str());
+    std::lock_guard<std::mutex> lock(tls_session_mutex_);
+    if (tls_session_) SSL_set_session(native, tls_session_);
+    return ws;
+}
+
+tcp::resolver::results_type WebSocketHandler::cached_endpoints() {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    if (endpoints_.empty()) {
+        tcp::resolver resolver(ioc_);
+        endpoints_ = resolver.resolve(host_, port_);
+    }
+    return endpoints_;
+}
+
+void WebSocketHandler::forget_endpoints() {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    endpoints_ = tcp::resolver::results_type();
+}
+
+// Blocking connect, TLS and WebSocket handshakes on a fresh stream. A cached
+// address that no longer answers is re-resolved once.
+void WebSocketHandler::connect_stream(Stream& ws) {
+    boost::system::error_code ec;
+    asio::connect(ws.next_layer().next_layer(), cached_endpoints(), ec);
+    if (ec) {
+        forget_endpoints();
+        asio::connect(ws.next_layer().next_layer(), cached_endpoints(), ec);
+        if (ec) {
+            // Resolve again on the next attempt rather than retry this answer
+            forget_endpoints();
+            throw boost::system::system_error(ec);
+        }
+    }
+    ws.next_layer().next_layer().set_option(tcp::no_delay(true));
+    ws.next_layer().handshake(ssl::stream_base::client);
+    beast::websocket::response_type response;
+    ws.handshake(response, host_, endpoint_);
+    note_handshake(response);
+    if (session_resumed(ws)) tls_resumptions_.inc();
+}
+
+void WebSocketHandler::set_deflate(const DeflateConfig& config) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    deflate_ = config;
+    websocket_->set_option(config.options());
+}
+
+void WebSocketHandler::note_handshake(const beast::websocket::response_type& response) {
+    auto extensions = response[beast::http::field::sec_websocket_extensions];
+    deflate_negotiated_ = extensions.find("permessage-deflate") != beast::string_view::npos;
+}
+
+// Everything the TLS engine has taken off the socket, including records it
+// has not decrypted yet
+uint64_t WebSocketHandler::tls_bytes_read(Stream& ws) {
+    return BIO_number_read(SSL_get_rbio(ws.next_layer().native_handle()));
+}
+
+void WebSocketHandler::count_read(uint64_t wire_bytes, std::size_t payload_bytes, int64_t cpu_ns) {
+    in_messages_.fetch_add(1, std::memory_order_relaxed);
+    in_payload_bytes_.fetch_add(payload_bytes, std::memory_order_relaxed);
+    in_wire_bytes_.fetch_add(wire_bytes, std::memory_order_relaxed);
+    payload_bytes_.inc(payload_bytes);
+    wire_bytes_.inc(wire_bytes);
+    if (cpu_ns >= 0) {
+        read_cpu_ns_.fetch_add(cpu_ns, std::memory_order_relaxed);
+        cpu_reads_.fetch_add(1, std::memory_order_relaxed);
+        read_cpu_seconds_.observe(cpu_ns * 1e-9);
+    }
+}
+
+CompressionStats WebSocketHandler::compression_stats() const {
+    CompressionStats stats;
+    stats.negotiated = deflate_negotiated_;
+    stats.messages = in_messages_.load(std::memory_order_relaxed);
+    stats.payload_bytes = in_payload_bytes_.load(std::memory_order_relaxed);
+    stats.wire_bytes = in_wire_bytes_.load(std::memory_order_relaxed);
+    stats.read_cpu_seconds = read_cpu_ns_.load(std::memory_order_relaxed) * 1e-9;
+    stats.cpu_messages = cpu_reads_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void WebSocketHandler::install_primary(const std::shared_ptr<Stream>& ws) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    websocket_ = ws;
+}
+
+void WebSocketHandler::report_failover(FailoverEvent event, const std::string& detail) {
+    std::function<void(FailoverEvent, const std::string&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        handler = failover_handler_;
+    }
+    if (handler) handler(event, detail);
+}
+
+bool WebSocketHandler::promote_standby(const std::shared_ptr<Stream>& failed) {
+    std::shared_ptr<Stream> old;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        // Another thread may already have failed over from this stream
+        if (failed != websocket_ || !standby_) return false;
+        old = websocket_;
+        websocket_ = standby_;
+        standby_.reset();
+    }
+    promotions_.fetch_add(1, std::memory_order_acq_rel);
+    boost::system::error_code ignored;
+    old->next_layer().next_layer().close(ignored);
+    failovers_.inc();
+    standby_ready_.set(0);
+
+    report_failover(FailoverEvent::Promoted);
+
+    // Replace the standby we just used
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    if (!standby_build_.valid() || standby_build_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        standby_build_ = std::async(std::launch::async, &WebSocketHandler::build_standby, this);
+    }
+    return true;
+}
+
+bool WebSocketHandler::build_standby() {
+    json auth;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        auth = standby_auth_;
+    }
+    try {
+        auto ws = make_stream();
+        connect_stream(*ws);
+        bool resumed = session_resumed(*ws);
+
+        ws->write(asio::buffer(auth.dump()));
+        beast::flat_buffer buffer;
+        ws->read(buffer);
+        const char* begin = static_cast<const char*>(buffer.data().data());
+        json reply = json::parse(begin, begin + buffer.size());
+        if (!reply.contains("result")) {
+            standby_failures_.inc();
+            report_failover(FailoverEvent::StandbyFailed, "authentication failed: " + reply.dump());
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stream_mutex_);
+            standby_ = ws;
+        }
+        standby_ready_.set(1);
+        report_failover(FailoverEvent::StandbyReady, resumed ? "TLS session resumed" : "");
+        return true;
+    }
+    catch (const std::exception& e) {
+        standby_failures_.inc();
+        report_failover(FailoverEvent::StandbyFailed, e.what());
+        return false;
+    }
+}
+
+bool WebSocketHandler::prepare_standby(const json& auth_request) {
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        standby_auth_ = auth_request;
+    }
+    return build_standby();
+}
+
+bool WebSocketHandler::has_standby() const {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    return standby_ != nullptr;
+}
+
+void WebSocketHandler::set_failover_handler(std::function<void(FailoverEvent, const std::string&)> handler) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    failover_handler_ = std::move(handler);
+}
+
+// Channel family: the channel name up to the instrument, e.g. "book" for
+// book.BTC-PERPETUAL.100ms and "user.trades" for user.trades.BTC-PERPETUAL.raw.
+// Keeps the label set small when thousands of option tickers are subscribed.
+template <typename Json>
+void WebSocketHandler::countFrame(const Json& message) {
+    if (!message.contains("params") || !message["params"].contains("channel")) {
+        rpc_frames_.inc();
+        return;
+    }
+    const std::string& channel = message["params"]["channel"].template get_ref<const std::string&>();
+    std::size_t end = channel.find('.');
+    if (end != std::string::npos && channel.compare(0, end, "user") == 0) {
+        end = channel.find('.', end + 1);
+    }
+    std::string family = channel.substr(0, end);
+
+    auto it = channel_frames_.find(family);
+    if (it == channel_frames_.end()) {
+        Counter& counter = MetricsRegistry::instance().counter(
+            "deribit_frames_total", "WebSocket frames received by channel family", "channel=\"" + family + "\"");
+        it = channel_frames_.emplace(family, &counter).first;
+    }
+    it->second->inc();
+}
+
+void WebSocketHandler::countConnect() {
+    if (connects_++ > 0) reconnects_.inc();
+}
+
 void WebSocketHandler::onMessage(const std::string& message) {
     try {
-        json data = json::parse(message);
+        ArenaScope scope(reader_arena());
+        auto parse_start = std::chrono::steady_clock::now();
+        arena_json data = arena_json::parse(message);
+        parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+        countFrame(data);
         
         // Handle subscription messages
         if (data.contains("method") && data["method"] == "subscription") {
@@ -33,19 +337,13 @@ void WebSocketHandler::onMessage(const std::string& message) {
 
 void WebSocketHandler::connect() {
     try {
-        // Resolve the host and port
-        auto const results = resolver_.resolve(host_, "443");
-
-        // Connect to the server
-        asio::connect(websocket_.next_layer().next_layer(), results.begin(), results.end());
+        auto ws = make_stream();
+        connect_stream(*ws);
+        install_primary(ws);
+        countConnect();
 
-        // Perform the SSL handshake
-        websocket_.next_layer().handshake(ssl::stream_base::client);
-
-        // Perform the WebSocket handshake
-        websocket_.handshake(host_, endpoint_);
-
-        std::cout << "WebSocket connected successfully!" << std::endl;
+        std::cout << "WebSocket connected successfully!"
+                  << (session_resumed(*ws) ? " (TLS session resumed)" : "") << std::endl;
     }
     catch (const std::exception& e) {
         std::cerr << "Error during WebSocket connection: " << e.what() << std::endl;
@@ -63,7 +361,7 @@ void WebSocketHandler::sendMessage(const json& message) {
     try {
         // Serialize the JSON message and send it
         std::string message_str = message.dump();
-        websocket_.write(asio::buffer(message_str));
+        sendText(message_str);
 
         // std::cout << "Sent message: " << message_str << std::endl;
     }
@@ -72,21 +370,56 @@ void WebSocketHandler::sendMessage(const json& message) {
     }
 }
 
+void WebSocketHandler::sendText(const std::string& payload) {
+    // A reader on the io_context owns the stream, so the write goes there too
+    if (io_owns_stream_.load(std::memory_order_acquire)) {
+        queue_write(payload);
+        return;
+    }
+    auto ws = stream();
+    try {
+        GaugeScope queued(outbound_depth_);
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        ws->write(asio::buffer(payload));
+    }
+    catch (const boost::system::system_error& e) {
+        std::cerr << "Error sending message: " << e.what() << std::endl;
+        promote_standby(ws);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error sending message: " << e.what() << std::endl;
+    }
+}
+
 json WebSocketHandler::readMessage() {
+    auto ws = stream();
     try {
         auto read_start = LatencyModule::start();  // Start timer for WebSocket message read
 
         beast::flat_buffer buffer;
-        websocket_.read(buffer);
-
-        // Parse the received message as JSON
-        std::string message_str = beast::buffers_to_string(buffer.data());
-        // std::cout << "Received message: " << message_str << std::endl;
+        uint64_t wire_start = tls_bytes_read(*ws);
+        int64_t cpu_start = threadCpuNs();
+        ws->read(buffer);
+        int64_t cpu_end = threadCpuNs();
+        count_read(tls_bytes_read(*ws) - wire_start, buffer.size(),
+                   cpu_start < 0 || cpu_end < 0 ? -1 : cpu_end - cpu_start);
 
         // End the timer and log the latency
-        LatencyModule::end(read_start, "WebSocket Read Latency");
+        static const LatencyModule::Action read_latency("WebSocket Read Latency");
+        LatencyModule::end(read_start, read_latency);
 
-        return json::parse(message_str);
+        // Parse straight from the frame buffer instead of copying it to a string
+        const char* begin = static_cast<const char*>(buffer.data().data());
+        auto parse_start = std::chrono::steady_clock::now();
+        json message = json::parse(begin, begin + buffer.size());
+        parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+        countFrame(message);
+        return message;
+    }
+    catch (const boost::system::system_error& e) {
+        std::cerr << "Error reading message: " << e.what() << std::endl;
+        promote_standby(ws);
+        return json();
     }
     catch (const std::exception& e) {
         std::cerr << "Error reading message: " << e.what() << std::endl;
@@ -94,9 +427,105 @@ json WebSocketHandler::readMessage() {
     }
 }
 
+json WebSocketHandler::call(int64_t id, const std::string& payload, std::function<void()> on_written,
+                            std::chrono::milliseconds timeout) {
+    uint64_t failovers = promotions_.load(std::memory_order_acquire);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    sendText(payload);
+    if (on_written) on_written();
+    return readReply(id, failovers, deadline);
+}
+
+json WebSocketHandler::readReply(int64_t id, uint64_t failovers, std::chrono::steady_clock::time_point deadline) {
+    auto read_start = LatencyModule::start();
+    json reply;
+    bool matched = false;
+    while (!matched) {
+        // The request went out on a connection that has since been replaced
+        if (promotions_.load(std::memory_order_acquire) != failovers) {
+            std::cerr << "Connection failed over before the reply to request " << id << std::endl;
+            return json();
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            std::cerr << "Timed out waiting for the reply to request " << id << std::endl;
+            return json();
+        }
+        bool got_frame = false;
+        readFrame([&](const char* data, std::size_t size) {
+            got_frame = true;
+            try {
+                if (is_notification(data, size)) {
+                    dispatch_notification(data, size);
+                    return;
+                }
+                auto parse_start = std::chrono::steady_clock::now();
+                json message = json::parse(data, data + size);
+                parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+                countFrame(message);
+                auto it = message.find("id");
+                if (it != message.end() && it->is_number_integer() && it->get<int64_t>() == id) {
+                    reply = std::move(message);
+                    matched = true;
+                } else {
+                    dispatch_notification(data, size, false);
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error handling message: " << e.what() << std::endl;
+            }
+        });
+        if (!got_frame) return json();
+    }
+    static const LatencyModule::Action read_latency("WebSocket Read Latency");
+    LatencyModule::end(read_start, read_latency);
+    return reply;
+}
+
+bool WebSocketHandler::readMessage(const std::function<void(const arena_json&)>& dispatch) {
+    return readFrame([this, &dispatch](const char* begin, std::size_t size) {
+        parse_frame(begin, size, dispatch);
+    });
+}
+
+bool WebSocketHandler::readFrame(const std::function<void(const char*, std::size_t)>& sink) {
+    auto ws = stream();
+    try {
+        read_buffer_.consume(read_buffer_.size());
+        uint64_t wire_start = tls_bytes_read(*ws);
+        int64_t cpu_start = threadCpuNs();
+        ws->read(read_buffer_);
+        int64_t cpu_end = threadCpuNs();
+        count_read(tls_bytes_read(*ws) - wire_start, read_buffer_.size(),
+                   cpu_start < 0 || cpu_end < 0 ? -1 : cpu_end - cpu_start);
+
+        sink(static_cast<const char*>(read_buffer_.data().data()), read_buffer_.size());
+        return true;
+    }
+    catch (const boost::system::system_error& e) {
+        std::cerr << "Error reading message: " << e.what() << std::endl;
+        return promote_standby(ws);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error reading message: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 void WebSocketHandler::close() {
+    if (standby_build_.valid()) standby_build_.wait();
+    std::shared_ptr<Stream> standby;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        standby.swap(standby_);
+        standby_auth_ = json();
+    }
+    standby_ready_.set(0);
+    if (standby) {
+        boost::system::error_code ignored;
+        standby->next_layer().next_layer().close(ignored);
+    }
     try {
-        websocket_.close(beast::websocket::close_code::normal);
+        stream()->close(beast::websocket::close_code::normal);
         std::cout << "WebSocket connection closed." << std::endl;
     }
     catch (const std::exception& e) {
@@ -104,7 +533,8 @@ void WebSocketHandler::close() {
     }
 }
 
-void WebSocketHandler::handleOrderBookUpdate(const json& data) {
+template <typename Json>
+void WebSocketHandler::handleOrderBookUpdate(const Json& data) {
     try {
         if (data.contains("params") && data["params"].contains("data")) {
             const auto& orderBook = data["params"]["data"];
@@ -152,6 +582,9 @@ void WebSocketHandler::handleOrderBookUpdate(const json& data) {
     }
 }
 
+template void WebSocketHandler::handleOrderBookUpdate<json>(const json&);
+template void WebSocketHandler::handleOrderBookUpdate<arena_json>(const arena_json&);
+
 void WebSocketHandler::subscribe(const std::string& channel) {
     json sub_message = {
         {"jsonrpc", "2.0"},
@@ -178,71 +611,357 @@ void WebSocketHandler::unsubscribe(const std::string& channel) {
 
 
 void WebSocketHandler::async_connect(std::function<void(boost::system::error_code)> callback) {
+    asio::co_spawn(ioc_, co_connect(), [callback](std::exception_ptr e) {
+        boost::system::error_code ec;
+        if (e) {
+            try {
+                std::rethrow_exception(e);
+            }
+            catch (const boost::system::system_error& err) {
+                ec = err.code();
+                std::cerr << "WebSocket connect failed: " << err.what() << std::endl;
+            }
+            catch (const std::exception& err) {
+                ec = boost::system::errc::make_error_code(boost::system::errc::operation_canceled);
+                std::cerr << "Exception in async_connect: " << err.what() << std::endl;
+            }
+        }
+        if (callback) callback(ec);
+    });
+}
+
+asio::awaitable<void> WebSocketHandler::co_connect() {
+    std::cout << "Starting async connection to: " << host_ << std::endl;
+    auto ws = make_stream();
+    auto connect_start = LatencyModule::start();
+
+    // Resolve once and reuse the answer until a connect to it fails
+    tcp::resolver::results_type endpoints;
+    {
+        std::lock_guard<std::mutex> lock(endpoints_mutex_);
+        endpoints = endpoints_;
+    }
+    if (endpoints.empty()) {
+        endpoints = co_await resolver_.async_resolve(host_, port_, asio::use_awaitable);
+        std::lock_guard<std::mutex> lock(endpoints_mutex_);
+        endpoints_ = endpoints;
+    }
+
     try {
-        std::cout << "Starting async connection to: " << host_ << std::endl;
-        
-        // Start the resolver
-        resolver_.async_resolve(
-            host_,
-            "443",
-            [this, callback](boost::system::error_code ec, tcp::resolver::results_type results) {
-                if(ec) {
-                    std::cerr << "Resolution failed: " << ec.message() << std::endl;
-                    if(callback) callback(ec);
-                    return;
-                }
+        co_await asio::async_connect(ws->next_layer().next_layer(), endpoints, asio::use_awaitable);
+    }
+    catch (const boost::system::system_error&) {
+        forget_endpoints();
+        throw;
+    }
+    boost::system::error_code ignored;
+    ws->next_layer().next_layer().set_option(tcp::no_delay(true), ignored);
 
-                // Once resolved, initiate async connect
-                asio::async_connect(
-                    websocket_.next_layer().next_layer(),
-                    results,
-                    [this, callback](boost::system::error_code ec, const tcp::endpoint&) {
-                        if(ec) {
-                            std::cerr << "Connect failed: " << ec.message() << std::endl;
-                            if(callback) callback(ec);
-                            return;
-                        }
+    co_await ws->next_layer().async_handshake(ssl::stream_base::client, asio::use_awaitable);
+    beast::websocket::response_type response;
+    co_await ws->async_handshake(response, host_, endpoint_, asio::use_awaitable);
+    note_handshake(response);
 
-                        // After connection, perform SSL handshake
-                        websocket_.next_layer().async_handshake(
-                            ssl::stream_base::client,
-                            [this, callback](boost::system::error_code ec) {
-                                if(ec) {
-                                    std::cerr << "SSL handshake failed: " << ec.message() << std::endl;
-                                    if(callback) callback(ec);
-                                    return;
-                                }
-
-                                // Finally, perform WebSocket handshake
-                                websocket_.async_handshake(
-                                    host_,
-                                    endpoint_,
-                                    [this, callback](boost::system::error_code ec) {
-                                        if(ec) {
-                                            std::cerr << "WebSocket handshake failed: " << ec.message() << std::endl;
-                                        } else {
-                                            std::cout << "WebSocket connected successfully!" << std::endl;
-                                        }
-                                        if(callback) callback(ec);
-                                    });
-                            });
-                    });
-            });
+    bool resumed = session_resumed(*ws);
+    if (resumed) tls_resumptions_.inc();
+    install_primary(ws);
+    countConnect();
+    static const LatencyModule::Action connect_latency("WebSocket Connect");
+    LatencyModule::end(connect_start, connect_latency);
+    std::cout << "WebSocket connected successfully!"
+              << (resumed ? " (TLS session resumed)" : "") << std::endl;
+}
+
+std::shared_ptr<WebSocketHandler::PendingCall> WebSocketHandler::start_call(int64_t id, std::string payload,
+                                                                            std::function<void()> on_written) {
+    auto call = std::make_shared<PendingCall>(ioc_, id);
+    call->timer.expires_at(asio::steady_timer::time_point::max());
+    pending_calls_[id] = call;
+
+    outbound_depth_.add(1);
+    write_queue_.push_back(QueuedWrite{std::move(payload), std::move(on_written)});
+    start_write_loop();
+    if (!reading_) {
+        reading_ = true;
+        io_owns_stream_.store(true, std::memory_order_release);
+        asio::co_spawn(ioc_, read_loop(), asio::detached);
     }
-    catch (const std::exception& e) {
-        std::cerr << "Exception in async_connect: " << e.what() << std::endl;
-        if(callback) {
-            callback(boost::system::errc::make_error_code(
-                boost::system::errc::operation_canceled));
+    return call;
+}
+
+asio::awaitable<json> WebSocketHandler::await_reply(std::shared_ptr<PendingCall> call,
+                                                    std::chrono::milliseconds timeout) {
+    if (!call->done) {
+        call->timer.expires_after(timeout);
+        boost::system::error_code ec;
+        co_await call->timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    }
+    if (!call->done) {
+        pending_calls_.erase(call->id);
+        co_return json{{"error", {{"message", "timed out waiting for reply"}}}};
+    }
+    co_return std::move(call->reply);
+}
+
+asio::awaitable<json> WebSocketHandler::async_call(int64_t id, std::string payload) {
+    auto call = start_call(id, std::move(payload));
+    co_return co_await await_reply(std::move(call));
+}
+
+void WebSocketHandler::set_notification_handler(std::function<void(const arena_json&)> handler) {
+    notification_handler_ = std::move(handler);
+}
+
+void WebSocketHandler::send_ping() {
+    auto sent = std::chrono::steady_clock::now().time_since_epoch();
+    std::string payload = std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(sent).count());
+    asio::post(ioc_, [this, payload = std::move(payload)]() mutable {
+        if (!reading_) return;
+        QueuedWrite item{std::move(payload), nullptr};
+        item.ping = true;
+        write_queue_.push_back(std::move(item));
+        start_write_loop();
+    });
+}
+
+void WebSocketHandler::queue_write(std::string payload) {
+    outbound_depth_.add(1);
+    auto enqueue = [this, payload = std::move(payload)]() mutable {
+        write_queue_.push_back(QueuedWrite{std::move(payload), nullptr});
+        start_write_loop();
+    };
+    if (ioc_.get_executor().running_in_this_thread()) {
+        enqueue();
+    } else {
+        asio::post(ioc_, std::move(enqueue));
+    }
+}
+
+void WebSocketHandler::start_write_loop() {
+    if (writing_) return;
+    writing_ = true;
+    io_owns_stream_.store(true, std::memory_order_release);
+    asio::co_spawn(ioc_, write_loop(), asio::detached);
+}
+
+// Once neither loop runs, the blocking API may use the stream again
+void WebSocketHandler::release_stream() {
+    if (reading_ || writing_) return;
+    io_owns_stream_.store(false, std::memory_order_release);
+    if (feed_stopped_) {
+        feed_stopped_->set_value();
+        feed_stopped_.reset();
+    }
+}
+
+void WebSocketHandler::start_feed(std::function<void(const char*, std::size_t)> sink) {
+    io_owns_stream_.store(true, std::memory_order_release);
+    asio::post(ioc_, [this, sink = std::move(sink)]() mutable {
+        feed_sink_ = std::move(sink);
+        if (!reading_) {
+            reading_ = true;
+            asio::co_spawn(ioc_, read_loop(), asio::detached);
+        }
+    });
+}
+
+std::future<void> WebSocketHandler::stop_feed() {
+    auto stopped = std::make_unique<std::promise<void>>();
+    std::future<void> result = stopped->get_future();
+    asio::post(ioc_, [this, stopped = std::move(stopped)]() mutable {
+        feed_sink_ = nullptr;
+        if (reading_ || writing_) {
+            feed_stopped_ = std::move(stopped);
+        } else {
+            stopped->set_value();
+        }
+    });
+    return result;
+}
+
+void WebSocketHandler::parse_frame(const char* data, std::size_t size,
+                                   const std::function<void(const arena_json&)>& dispatch) {
+    ArenaScope scope(reader_arena());
+    auto parse_start = std::chrono::steady_clock::now();
+    arena_json message = arena_json::parse(data, data + size);
+    parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+    countFrame(message);
+    dispatch(message);
+}
+
+MessageArena& WebSocketHandler::reader_arena() {
+    return ioc_.get_executor().running_in_this_thread() ? io_arena_ : blocking_arena_;
+}
+
+ArenaStats WebSocketHandler::arenaStats() const {
+    ArenaStats io = io_arena_.stats();
+    ArenaStats blocking = blocking_arena_.stats();
+    io.messages += blocking.messages;
+    io.allocations += blocking.allocations;
+    io.bytes += blocking.bytes;
+    io.heap_blocks += blocking.heap_blocks;
+    io.peak_message_bytes = std::max(io.peak_message_bytes, blocking.peak_message_bytes);
+    return io;
+}
+
+void WebSocketHandler::set_pong_handler(std::function<void(std::chrono::nanoseconds)> handler) {
+    std::lock_guard<std::mutex> lock(pong_mutex_);
+    pong_handler_ = std::move(handler);
+}
+
+// Pongs echo the send time send_ping put in the ping. Unsolicited pongs, and
+// ones to pings from elsewhere, carry no number and are ignored.
+void WebSocketHandler::on_control_frame(beast::websocket::frame_type kind, beast::string_view payload) {
+    if (kind != beast::websocket::frame_type::pong || payload.empty()) return;
+    int64_t sent = 0;
+    for (char c : payload) {
+        if (c < '0' || c > '9') return;
+        sent = sent * 10 + (c - '0');
+    }
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    std::chrono::nanoseconds rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(now) - std::chrono::nanoseconds(sent);
+    std::lock_guard<std::mutex> lock(pong_mutex_);
+    if (pong_handler_ && rtt.count() >= 0) pong_handler_(rtt);
+}
+
+void WebSocketHandler::fail_pending(const std::string& reason) {
+    auto pending = std::move(pending_calls_);
+    pending_calls_.clear();
+    for (auto& entry : pending) {
+        entry.second->reply = json{{"error", {{"message", reason}}}};
+        entry.second->done = true;
+        entry.second->timer.cancel();
+    }
+}
+
+// Writes queued frames one at a time; a websocket stream allows only one
+// outstanding write
+asio::awaitable<void> WebSocketHandler::write_loop() {
+    while (!write_queue_.empty()) {
+        QueuedWrite item = std::move(write_queue_.front());
+        write_queue_.pop_front();
+        auto ws = stream();
+        if (item.ping) {
+            // Without a reader here a blocking one may own the stream
+            if (!reading_) continue;
+            try {
+                beast::websocket::ping_data data(item.payload.c_str());
+                co_await ws->async_ping(data, asio::use_awaitable);
+            }
+            catch (const boost::system::system_error& e) {
+                std::cerr << "Error sending ping: " << e.what() << std::endl;
+            }
+            continue;
+        }
+        try {
+            co_await ws->async_write(asio::buffer(item.payload), asio::use_awaitable);
+            outbound_depth_.add(-1);
+            if (item.on_written) item.on_written();
+        }
+        catch (const boost::system::system_error& e) {
+            outbound_depth_.add(-1);
+            std::cerr << "Error sending message: " << e.what() << std::endl;
+            promote_standby(ws);
+        }
+    }
+    writing_ = false;
+    release_stream();
+}
+
+// Reads frames for as long as calls are outstanding or a feed runs, then
+// hands the socket back to the blocking API
+asio::awaitable<void> WebSocketHandler::read_loop() {
+    while (!pending_calls_.empty() || feed_sink_) {
+        auto ws = stream();
+        std::string failure;
+        try {
+            call_buffer_.consume(call_buffer_.size());
+            uint64_t wire_start = tls_bytes_read(*ws);
+            co_await ws->async_read(call_buffer_, asio::use_awaitable);
+            // Other handlers share this thread, so only bytes are counted here
+            count_read(tls_bytes_read(*ws) - wire_start, call_buffer_.size(), -1);
+        }
+        catch (const boost::system::system_error& e) {
+            failure = e.what();
+        }
+        if (!failure.empty()) {
+            // Replies owed on the failed connection will never arrive
+            std::cerr << "Error reading message: " << failure << std::endl;
+            fail_pending(failure);
+            // A feed carries on from the promoted standby
+            if (!promote_standby(ws) || !feed_sink_) break;
+            continue;
+        }
+        dispatch_frame(static_cast<const char*>(call_buffer_.data().data()), call_buffer_.size());
+    }
+    reading_ = false;
+    release_stream();
+}
+
+// Notifications go to the feed sink, or else through the arena to the
+// notification handler; replies are parsed into a json that outlives the
+// frame and complete their call
+void WebSocketHandler::dispatch_frame(const char* data, std::size_t size) {
+    try {
+        if (is_notification(data, size)) {
+            if (feed_sink_) {
+                feed_sink_(data, size);
+            } else {
+                dispatch_notification(data, size);
+            }
+            return;
+        }
+
+        auto parse_start = std::chrono::steady_clock::now();
+        json message = json::parse(data, data + size);
+        parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+        countFrame(message);
+        auto id = message.find("id");
+        auto it = id != message.end() && id->is_number_integer() ? pending_calls_.find(id->get<int64_t>())
+                                                                 : pending_calls_.end();
+        if (it == pending_calls_.end()) {
+            // Replies to requests sent outside the coroutine API, e.g. from
+            // FeedPipeline workers, are matched by whoever handles the feed
+            if (feed_sink_) feed_sink_(data, size);
+            return;
         }
+        auto call = it->second;
+        pending_calls_.erase(it);
+        call->reply = std::move(message);
+        call->done = true;
+        call->timer.cancel();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling message: " << e.what() << std::endl;
     }
 }
 
+// Pushed by the exchange rather than answering a request; the method comes
+// first in these, so the head of the frame says
+bool WebSocketHandler::is_notification(const char* data, std::size_t size) {
+    std::string_view head(data, std::min<std::size_t>(size, 64));
+    return head.find("\"subscription\"") != std::string_view::npos || head.find("\"heartbeat\"") != std::string_view::npos;
+}
+
+// Parsed into the arena for the notification handler; count is false for a
+// frame already parsed and counted once
+void WebSocketHandler::dispatch_notification(const char* data, std::size_t size, bool count) {
+    ArenaScope scope(reader_arena());
+    auto parse_start = std::chrono::steady_clock::now();
+    arena_json message = arena_json::parse(data, data + size);
+    if (count) {
+        parse_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count());
+        countFrame(message);
+    }
+    if (notification_handler_) notification_handler_(message);
+}
+
 void WebSocketHandler::start_read() {
     auto self = shared_from_this();
-    websocket_.async_read(
+    auto ws = stream();
+    ws->async_read(
         buffer_,
-        [this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
+        [this, self, ws](boost::system::error_code ec, std::size_t bytes_transferred) {
             if (!ec) {
                 std::string msg = beast::buffers_to_string(buffer_.data());
                 buffer_.consume(buffer_.size());
@@ -258,23 +977,8 @@ void WebSocketHandler::set_message_handler(std::function<void(const std::string&
 
 void WebSocketHandler::close_connection() {
     try {
-        websocket_.close(beast::websocket::close_code::normal);
+        stream()->close(beast::websocket::close_code::normal);
     } catch (const std::exception& e) {
         std::cerr << "Error closing WebSocket: " << e.what() << std::endl;
     }
 }
-
-// void WebSocketHandler::start_ping_timer() {
-//     auto timer = std::make_shared<boost::asio::steady_timer>(ioc_);
-//     timer->expires_after(std::chrono::seconds(30));
-//     timer->async_wait([this, timer](boost::system::error_code ec) {
-//         if (!ec) {
-//             try {
-//                 websocket_.ping();
-//                 start_ping_timer();  // Schedule next ping
-//             } catch (const std::exception& e) {
-//                 std::cerr << "Ping error: " << e.what() << std::endl;
-//             }
-//         }
-//     });
-// }
@@ -10,8 +10,19 @@
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <string>
-#include "trade_execution.h"  // Include the TradeExecution header for access
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "message_arena.h"
+#include "metrics.h"
+#include "ws_compression.h"
 
 namespace beast = boost::beast;
 namespace asio = boost::asio;
@@ -24,14 +35,36 @@ public:
     // Constructor now includes TradeExecution reference
     WebSocketHandler(asio::io_context& ioc, const std::string& host, 
                     const std::string& port, const std::string& endpoint);
+    ~WebSocketHandler();
     void subscribe(const std::string& channel);
     void unsubscribe(const std::string& channel);
     // Add this to the public section of the WebSocketHandler class
-    void handleOrderBookUpdate(const json& data);
+    template <typename Json>
+    void handleOrderBookUpdate(const Json& data);
     void connect();
     void onMessage(const std::string& message); // Declare the onMessage function
     void sendMessage(const json& message);
+    // Send an already serialised JSON-RPC message
+    void sendText(const std::string& payload);
     json readMessage();
+    // Send payload, a JSON-RPC request whose "id" is id, and block until its
+    // reply. on_written runs once the frame has been handed to the socket.
+    // Frames read before the reply (notifications, heartbeats, late replies
+    // to other requests) go to the notification handler rather than being
+    // taken for it. Empty on a read error, once timeout has passed, or when
+    // the connection fails over first: the request is not sent again, since
+    // an order may already have reached the exchange. The timeout is checked
+    // as frames arrive, so a silent socket still blocks until the next one.
+    json call(int64_t id, const std::string& payload, std::function<void()> on_written = nullptr,
+              std::chrono::milliseconds timeout = std::chrono::seconds(10));
+    // Read one frame, parse it into the per-message arena and hand it to
+    // dispatch; the DOM is released when dispatch returns. False on error.
+    bool readMessage(const std::function<void(const arena_json&)>& dispatch);
+    // Read one frame and hand its bytes to sink unparsed, e.g. to a
+    // FeedPipeline; they are valid until sink returns. False on error.
+    bool readFrame(const std::function<void(const char*, std::size_t)>& sink);
+    // Both readers' arenas together; peak is the larger of the two
+    ArenaStats arenaStats() const;
     void close();
 
     
@@ -40,19 +73,187 @@ public:
     void close_connection();  // renamed from close() to avoid confusion
     void async_connect(std::function<void(boost::system::error_code)> callback = nullptr);
 
+    // Coroutine API. Everything below must be awaited from coroutines running
+    // on the io_context passed to the constructor (one thread runs it), so the
+    // call table and write queue need no locks. While any call is outstanding
+    // a reader coroutine owns the socket; do not use the blocking
+    // readMessage() overloads at the same time.
+    //
+    // Resolve (cached), TCP connect, TLS and WebSocket handshakes; throws
+    // boost::system::system_error on failure
+    asio::awaitable<void> co_connect();
+
+    struct PendingCall {
+        explicit PendingCall(asio::io_context& ioc, int64_t call_id) : id(call_id), timer(ioc) {}
+        int64_t id;
+        asio::steady_timer timer;   // cancelled when the reply arrives
+        bool done = false;
+        json reply;
+    };
+    // Queue a JSON-RPC request whose "id" is id and return its reply slot.
+    // on_written runs once the frame has been handed to the socket. Start
+    // several calls before awaiting any of them to keep them all in flight.
+    std::shared_ptr<PendingCall> start_call(int64_t id, std::string payload,
+                                            std::function<void()> on_written = nullptr);
+    // The reply, or {"error": {"message": ...}} on timeout or connection loss
+    asio::awaitable<json> await_reply(std::shared_ptr<PendingCall> call,
+                                      std::chrono::milliseconds timeout = std::chrono::seconds(10));
+    asio::awaitable<json> async_call(int64_t id, std::string payload);
+    // Subscription notifications that arrive while the reader coroutine runs,
+    // and any frame a blocking call reads before its reply
+    void set_notification_handler(std::function<void(const arena_json&)> handler);
+    // Queue a WebSocket ping carrying its send time; safe from any thread.
+    // Only sent while a reader runs on the io_context (a feed or a call), as
+    // a blocking reader on another thread may own the stream; the pong is
+    // seen by that reader.
+    void send_ping();
+    // Called with the round trip when a pong to send_ping arrives, on the
+    // thread reading the socket
+    void set_pong_handler(std::function<void(std::chrono::nanoseconds)> handler);
+
+    // Hot standby: a second connection, authenticated with auth_request, that
+    // replaces the primary as soon as a read or write on it fails. A new
+    // standby is built in the background after each promotion.
+    bool prepare_standby(const json& auth_request);
+    bool has_standby() const;
+    enum class FailoverEvent {
+        Promoted,       // the standby replaced a failed primary
+        StandbyReady,   // a replacement standby is connected and authenticated
+        StandbyFailed,  // building a standby failed; detail says why
+        Replayed        // the handler's owner restored its state on the new primary
+    };
+    // Failover status, on whichever thread caused it (a background thread for
+    // replacement standbys). Nothing is printed; after Promoted the handler
+    // should e.g. replay subscriptions on the new primary and report that
+    // as Replayed through report_failover.
+    void set_failover_handler(std::function<void(FailoverEvent, const std::string& detail)> handler);
+    void report_failover(FailoverEvent event, const std::string& detail = std::string());
+
+    // Market data feed: a reader on the io_context hands every frame that is
+    // not the reply to a call to sink, on that thread, until stop_feed. While
+    // it runs, sendText queues frames for the io_context to write too, so
+    // reads, writes, pings and the pongs Beast answers with all stay on one
+    // thread. Call from any thread but the io_context's.
+    void start_feed(std::function<void(const char*, std::size_t)> sink);
+    // Stop handing frames to the sink. The read in progress only completes
+    // when the next frame arrives, so send something that is answered (e.g.
+    // an unsubscribe) and wait on the future before using the blocking API.
+    std::future<void> stop_feed();
+    // Parse a feed frame into the per-message arena and hand it to dispatch;
+    // on the io_context, from a start_feed sink
+    void parse_frame(const char* data, std::size_t size, const std::function<void(const arena_json&)>& dispatch);
+
+    asio::io_context& io_context() { return ioc_; }
+
+    // Offer permessage-deflate on connections made from now on, including
+    // the standby; call before connect
+    void set_deflate(const DeflateConfig& config);
+    CompressionStats compression_stats() const;
+
 private:
+    using Stream = beast::websocket::stream<ssl::stream<tcp::socket>>;
+
+    std::shared_ptr<Stream> stream() const;
+    std::shared_ptr<Stream> make_stream();
+    tcp::resolver::results_type cached_endpoints();
+    void forget_endpoints();
+    void connect_stream(Stream& ws);
+    void install_primary(const std::shared_ptr<Stream>& ws);
+    bool promote_standby(const std::shared_ptr<Stream>& failed);
+    bool build_standby();
+    json readReply(int64_t id, uint64_t failovers, std::chrono::steady_clock::time_point deadline);
+    static bool session_resumed(Stream& ws);
+    void note_handshake(const beast::websocket::response_type& response);
+    static uint64_t tls_bytes_read(Stream& ws);
+    void count_read(uint64_t wire_bytes, std::size_t payload_bytes, int64_t cpu_ns);
+    asio::awaitable<void> read_loop();
+    asio::awaitable<void> write_loop();
+    void dispatch_frame(const char* data, std::size_t size);
+    static bool is_notification(const char* data, std::size_t size);
+    void dispatch_notification(const char* data, std::size_t size, bool count = true);
+    void on_control_frame(beast::websocket::frame_type kind, beast::string_view payload);
+    void fail_pending(const std::string& reason);
+    void queue_write(std::string payload);
+    void start_write_loop();
+    void release_stream();
+    static int tls_owner_index();
+    static int on_new_tls_session(SSL* ssl, SSL_SESSION* session);
+
     asio::io_context& ioc_;
     ssl::context ctx_;
     tcp::resolver resolver_;
-    beast::websocket::stream<ssl::stream<tcp::socket>> websocket_;
+    mutable std::mutex stream_mutex_;       // guards websocket_, standby_ and failover state
+    std::shared_ptr<Stream> websocket_;     // primary; callers hold a copy for the duration of an I/O
+    std::shared_ptr<Stream> standby_;
+    json standby_auth_;
+    std::future<bool> standby_build_;
+    std::function<void(FailoverEvent, const std::string&)> failover_handler_;
+    std::atomic<uint64_t> promotions_{0};   // bumped as each standby takes over
+    std::mutex endpoints_mutex_;
+    tcp::resolver::results_type endpoints_; // cached DNS answer, dropped when a connect fails
+    std::mutex tls_session_mutex_;
+    SSL_SESSION* tls_session_ = nullptr;    // latest ticket, offered on every new connection
+    std::mutex write_mutex_;                // blocking writes
+    std::mutex pong_mutex_;
+    std::function<void(std::chrono::nanoseconds)> pong_handler_;
     std::string host_;
+    std::string port_;
     std::string endpoint_;
+    DeflateConfig deflate_;                 // guarded by stream_mutex_
     // TradeExecution& trade_execution_;  // Reference to TradeExecution object
     // In websocket_handler.h
     void start_read();
     std::function<void(const std::string&)> message_handler_;
     beast::flat_buffer buffer_;
     std::function<void(boost::system::error_code)> connect_callback_;
+    beast::flat_buffer read_buffer_;
+    // One arena per reader: the io_context thread (read_loop and feed sinks)
+    // and whichever thread makes blocking calls
+    MessageArena io_arena_;
+    MessageArena blocking_arena_;
+    MessageArena& reader_arena();
+
+    // Coroutine API state, io_context thread only
+    struct QueuedWrite {
+        std::string payload;
+        std::function<void()> on_written;
+        bool ping = false;          // payload is the ping data
+    };
+    std::unordered_map<int64_t, std::shared_ptr<PendingCall>> pending_calls_;
+    std::deque<QueuedWrite> write_queue_;
+    bool writing_ = false;
+    bool reading_ = false;
+    std::function<void(const char*, std::size_t)> feed_sink_;
+    std::unique_ptr<std::promise<void>> feed_stopped_;  // set once both loops have exited
+    std::atomic<bool> io_owns_stream_{false};   // read_loop or write_loop runs; sendText must queue
+    beast::flat_buffer call_buffer_;
+    std::function<void(const arena_json&)> notification_handler_;
+
+    // Metrics. channel_frames_ is only touched by the thread reading the socket.
+    template <typename Json>
+    void countFrame(const Json& message);
+    void countConnect();
+    std::unordered_map<std::string, Counter*> channel_frames_;
+    Counter& rpc_frames_;
+    Counter& reconnects_;
+    Counter& tls_resumptions_;
+    Counter& failovers_;
+    Counter& standby_failures_;
+    Gauge& standby_ready_;
+    Gauge& outbound_depth_;
+    LatencyHistogram& parse_seconds_;
+    int connects_ = 0;
+
+    // Compression stats, updated by whichever thread reads the socket
+    std::atomic<bool> deflate_negotiated_{false};
+    std::atomic<uint64_t> in_messages_{0};
+    std::atomic<uint64_t> in_payload_bytes_{0};
+    std::atomic<uint64_t> in_wire_bytes_{0};
+    std::atomic<int64_t> read_cpu_ns_{0};
+    std::atomic<uint64_t> cpu_reads_{0};
+    Counter& payload_bytes_;
+    Counter& wire_bytes_;
+    LatencyHistogram& read_cpu_seconds_;
 };
 
 #endif // WEBSOCKET_HANDLER_H
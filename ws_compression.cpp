@@ -0,0 +1,168 @@
+#include "ws_compression.h"
+#include <boost/beast/zlib/deflate_stream.hpp>
+#include <boost/beast/zlib/inflate_stream.hpp>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+namespace zlib = boost::beast::zlib;
+
+boost::beast::websocket::permessage_deflate DeflateConfig::options() const {
+    boost::beast::websocket::permessage_deflate options;
+    options.client_enable = enabled;
+    options.client_max_window_bits = client_max_window_bits;
+    options.server_max_window_bits = server_max_window_bits;
+    options.client_no_context_takeover = client_no_context_takeover;
+    options.server_no_context_takeover = server_no_context_takeover;
+    options.compLevel = compression_level;
+    options.memLevel = memory_level;
+    return options;
+}
+
+std::string DeflateConfig::describe() const {
+    if (!enabled) return "off";
+    std::ostringstream out;
+    out << "client_window=" << client_max_window_bits << ",server_window=" << server_max_window_bits
+        << ",level=" << compression_level << ",mem=" << memory_level;
+    if (client_no_context_takeover) out << ",client_no_takeover";
+    if (server_no_context_takeover) out << ",server_no_takeover";
+    return out.str();
+}
+
+DeflateConfig DeflateConfig::parse(const std::string& spec) {
+    DeflateConfig config;
+    if (spec == "off") return config;
+    config.enabled = true;
+    if (spec == "on") return config;
+
+    auto number = [&spec](const std::string& value, int low, int high) {
+        std::size_t used = 0;
+        int parsed = 0;
+        try {
+            parsed = std::stoi(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != value.size() || parsed < low || parsed > high) {
+            throw std::invalid_argument("Bad deflate setting in '" + spec + "'");
+        }
+        return parsed;
+    };
+
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : item.substr(equals + 1);
+        if (key == "window") {
+            config.client_max_window_bits = config.server_max_window_bits = number(value, 9, 15);
+        } else if (key == "client_window") {
+            config.client_max_window_bits = number(value, 9, 15);
+        } else if (key == "server_window") {
+            config.server_max_window_bits = number(value, 9, 15);
+        } else if (key == "level") {
+            config.compression_level = number(value, 0, 9);
+        } else if (key == "mem") {
+            config.memory_level = number(value, 1, 9);
+        } else if (item == "no_takeover") {
+            config.client_no_context_takeover = config.server_no_context_takeover = true;
+        } else if (item == "client_no_takeover") {
+            config.client_no_context_takeover = true;
+        } else if (item == "server_no_takeover") {
+            config.server_no_context_takeover = true;
+        } else {
+            throw std::invalid_argument("Unknown deflate setting '" + item + "'");
+        }
+    }
+    return config;
+}
+
+double DeflateBenchResult::breakEvenBitsPerSecond() const {
+    if (compressed_bytes >= raw_bytes) return 0.0;
+    double seconds = deflate_seconds + inflate_seconds;
+    double saved_bits = 8.0 * static_cast<double>(raw_bytes - compressed_bytes);
+    return seconds > 0.0 ? saved_bits / seconds : 0.0;
+}
+
+// Frames as Beast builds them for a server message: a sync flush whose
+// trailing 00 00 ff ff is dropped on the wire and put back before inflating
+DeflateBenchResult benchmarkDeflate(const std::vector<std::string>& messages, const DeflateConfig& config) {
+    using clock = std::chrono::steady_clock;
+    DeflateBenchResult result;
+    result.config = config;
+    result.messages = messages.size();
+
+    zlib::deflate_stream deflater;
+    deflater.reset(config.compression_level, config.server_max_window_bits, config.memory_level,
+                   zlib::Strategy::normal);
+    std::vector<std::string> frames;
+    frames.reserve(messages.size());
+    auto deflate_start = clock::now();
+    for (const auto& message : messages) {
+        std::string frame(deflater.upper_bound(message.size()) + 16, '\0');
+        zlib::z_params zs;
+        zs.next_in = message.data();
+        zs.avail_in = message.size();
+        zs.next_out = &frame[0];
+        zs.avail_out = frame.size();
+        boost::system::error_code ec;
+        deflater.write(zs, zlib::Flush::sync, ec);
+        if (ec || zs.avail_in != 0 || zs.total_out < 4) {
+            throw std::runtime_error("Deflate failed: " + (ec ? ec.message() : std::string("output too small")));
+        }
+        frame.resize(zs.total_out - 4);
+        frames.push_back(std::move(frame));
+        if (config.server_no_context_takeover) deflater.reset();
+    }
+    result.deflate_seconds = std::chrono::duration<double>(clock::now() - deflate_start).count();
+
+    static const unsigned char empty_block[4] = {0x00, 0x00, 0xff, 0xff};
+    zlib::inflate_stream inflater;
+    inflater.reset(config.server_max_window_bits);
+    std::string out;
+    bool intact = true;
+    auto inflate_start = clock::now();
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        out.resize(messages[i].size() + 64);
+        zlib::z_params zs;
+        zs.next_out = &out[0];
+        zs.avail_out = out.size();
+        boost::system::error_code ec;
+        zs.next_in = frames[i].data();
+        zs.avail_in = frames[i].size();
+        inflater.write(zs, zlib::Flush::sync, ec);
+        if (!ec) {
+            zs.next_in = empty_block;
+            zs.avail_in = sizeof(empty_block);
+            inflater.write(zs, zlib::Flush::sync, ec);
+        }
+        if (ec && ec != zlib::error::need_buffers) {
+            throw std::runtime_error("Inflate failed: " + ec.message());
+        }
+        intact = intact && zs.total_out == messages[i].size() && out.compare(0, zs.total_out, messages[i]) == 0;
+        if (config.server_no_context_takeover) inflater.clear();
+        result.raw_bytes += messages[i].size();
+        result.compressed_bytes += frames[i].size();
+    }
+    result.inflate_seconds = std::chrono::duration<double>(clock::now() - inflate_start).count();
+    if (!intact) throw std::runtime_error("Inflated messages differ from the originals");
+    return result;
+}
+
+std::vector<DeflateConfig> deflateBenchGrid() {
+    std::vector<DeflateConfig> grid;
+    for (int window : {15, 12, 9}) {
+        for (bool takeover : {true, false}) {
+            for (int level : {1, 6}) {
+                DeflateConfig config;
+                config.enabled = true;
+                config.client_max_window_bits = config.server_max_window_bits = window;
+                config.client_no_context_takeover = config.server_no_context_takeover = !takeover;
+                config.compression_level = level;
+                grid.push_back(config);
+            }
+        }
+    }
+    return grid;
+}
@@ -0,0 +1,66 @@
+#ifndef WS_COMPRESSION_H
+#define WS_COMPRESSION_H
+
+#include <boost/beast/websocket/option.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// permessage-deflate (RFC 7692) settings offered on new connections. The
+// server picks its own compression level; ours only applies to what we send.
+// Window bits bound the memory each side's inflater needs, and turning off
+// context takeover trades ratio for a compressor reset after every message.
+struct DeflateConfig {
+    bool enabled = false;
+    int client_max_window_bits = 15;        // 9..15, our compressor
+    int server_max_window_bits = 15;        // 9..15, the server's compressor and our inflater
+    bool client_no_context_takeover = false;
+    bool server_no_context_takeover = false;
+    int compression_level = 6;              // 0..9
+    int memory_level = 8;                   // 1..9
+
+    boost::beast::websocket::permessage_deflate options() const;
+    // "off", or as parse accepts it
+    std::string describe() const;
+    // "off", "on", or comma separated window=N (both sides), client_window=N,
+    // server_window=N, level=N, mem=N, no_takeover (both sides),
+    // client_no_takeover, server_no_takeover. Anything but "off" enables it.
+    // Throws std::invalid_argument on a malformed spec.
+    static DeflateConfig parse(const std::string& spec);
+};
+
+// Inbound traffic on one WebSocketHandler since it was created
+struct CompressionStats {
+    bool negotiated = false;        // the last handshake accepted permessage-deflate
+    uint64_t messages = 0;
+    uint64_t payload_bytes = 0;     // after inflate
+    uint64_t wire_bytes = 0;        // TLS records, so framing and TLS overhead included
+    double read_cpu_seconds = 0.0;  // thread CPU in blocking reads: decrypt, unmask and inflate
+    uint64_t cpu_messages = 0;      // reads read_cpu_seconds covers
+
+    double ratio() const { return wire_bytes ? static_cast<double>(payload_bytes) / wire_bytes : 0.0; }
+};
+
+// One setting replayed over recorded server messages: the server's deflate
+// and our inflate, with the compressor and decompressor kept or reset between
+// messages as the setting says
+struct DeflateBenchResult {
+    DeflateConfig config;
+    uint64_t messages = 0;
+    uint64_t raw_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    double deflate_seconds = 0.0;
+    double inflate_seconds = 0.0;
+
+    double ratio() const { return compressed_bytes ? static_cast<double>(raw_bytes) / compressed_bytes : 0.0; }
+    // Link speed below which the bytes saved arrive sooner than deflate and
+    // inflate cost; 0 if compression saves nothing
+    double breakEvenBitsPerSecond() const;
+};
+
+// Throws std::runtime_error if a message does not inflate back to itself
+DeflateBenchResult benchmarkDeflate(const std::vector<std::string>& messages, const DeflateConfig& config);
+// The settings --deflate-bench compares against uncompressed
+std::vector<DeflateConfig> deflateBenchGrid();
+
+#endif // WS_COMPRESSION_H